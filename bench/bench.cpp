@@ -0,0 +1,344 @@
+// Benchmark and profiling harness covering every stage of the pipeline on synthetic data:
+// csv parsing, the rolling K-max/K-min kernels, getTradeSignals, the Backtest evaluation, weekly resampling and the
+// full Driver run.
+// Each benchmark reports its throughput, the heap allocations it made (operator new is counted) and the peak RSS of
+// the process, and the whole report is printed as JSON so runs can be compared over time.
+//
+// Usage: bench/bench [--rows 1e3,1e4,1e5,1e6] [--symbols 1,10,100,1000] [--rows-per-symbol 2500]
+//                    [--dir /tmp/tf_bench] [--out file.json]
+// Row counts up to 1e8 and symbol counts up to 1e4 are supported; large values need matching disk and memory
+// (a 1e8 row csv is about 7 GB and its columns 3.6 GB).
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/data.h"
+#include "../src/strategy.h"
+#include "../src/backtest.h"
+#include "../src/driver.h"
+#include "../src/results_sink.h"
+#include "../src/resample.h"
+
+// Every heap allocation of the process goes through these, so a benchmark can count the allocations it makes.
+static std::atomic<long long> allocationCount(0);
+static std::atomic<long long> allocatedBytes(0);
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add((long long)size, std::memory_order_relaxed);
+    void *pointer = malloc(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// Results of the measured code are folded into this, so the compiler cannot drop the work.
+static volatile float benchmarkSink = 0;
+
+// Define a C++ struct named 'BenchResult' to store one line of the report.
+struct BenchResult
+{
+    std::string name;
+    long long rows;        // Stores the rows processed per iteration.
+    int symbols;           // Stores the symbols processed per iteration.
+    int iterations;
+    double seconds;        // Stores the mean seconds per iteration.
+    double rowsPerSecond;
+    double backtestsPerSecond; // Stores 0 for stages that do not run backtests.
+    double allocationsPerIteration;
+    double allocatedBytesPerIteration;
+    long peakRssKb;        // Stores the peak resident set size of the process after this benchmark.
+};
+
+static long getPeakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // Kilobytes on Linux.
+}
+
+// Function 'measure' runs 'body' until at least 'minSeconds' elapsed (and at least once) and fills a BenchResult.
+template <typename Body>
+static BenchResult measure(const std::string &name, long long rows, int symbols, int backtestsPerIteration, Body body, double minSeconds = 0.25)
+{
+    BenchResult result;
+    result.name = name;
+    result.rows = rows;
+    result.symbols = symbols;
+
+    long long allocationsBefore = allocationCount.load(), bytesBefore = allocatedBytes.load();
+    Clock::time_point start = Clock::now();
+    int iterations = 0;
+    double elapsed = 0;
+    do
+    {
+        body();
+        iterations++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+
+    result.iterations = iterations;
+    result.seconds = elapsed / iterations;
+    result.rowsPerSecond = double(rows) / result.seconds;
+    result.backtestsPerSecond = backtestsPerIteration / result.seconds;
+    result.allocationsPerIteration = double(allocationCount.load() - allocationsBefore) / iterations;
+    result.allocatedBytesPerIteration = double(allocatedBytes.load() - bytesBefore) / iterations;
+    result.peakRssKb = getPeakRssKb();
+
+    fprintf(stderr, "%-22s rows=%-10lld symbols=%-6d %12.0f rows/s %10.0f backtests/s %10.1f allocs/iter\n", name.c_str(), rows, symbols,
+            result.rowsPerSecond, result.backtestsPerSecond, result.allocationsPerIteration);
+    return result;
+}
+
+// Function 'generateColumns' builds a geometric random walk of 'rows' daily bars.
+static std::shared_ptr<DataColumns> generateColumns(long long rows, unsigned seed)
+{
+    std::shared_ptr<DataColumns> columns = std::make_shared<DataColumns>();
+    columns->resize(size_t(rows));
+
+    std::mt19937 generator(seed);
+    std::normal_distribution<float> returns(0.0003f, 0.02f);
+    std::uniform_real_distribution<float> range(0.0f, 0.01f);
+    float close = 50;
+    int64_t date = CsvParser::daysFromCivil(1980, 1, 1) * 86400;
+
+    for (long long i = 0; i < rows; i++)
+    {
+        CsvRow row;
+        float open = close;
+        close = std::max(0.01f, close * (1 + returns(generator)));
+        row.date = date + i * 86400;
+        row.openPrice = open;
+        row.closePrice = close;
+        row.highPrice = std::max(open, close) * (1 + range(generator));
+        row.lowPrice = std::min(open, close) * (1 - range(generator));
+        row.adjClosePrice = close;
+        row.volume = 1000000 + (long long)(generator() % 1000000);
+        columns->set(size_t(i), row);
+    }
+    return columns;
+}
+
+// Function 'writeCsv' writes columns in the Yahoo Finance csv layout the loader expects.
+static bool writeCsv(const std::string &fileName, const DataColumns &columns)
+{
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (!file)
+        return false;
+
+    fputs("Date,Open,High,Low,Close,Adj Close,Volume\n", file);
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        fprintf(file, "%s,%.6f,%.6f,%.6f,%.6f,%.6f,%lld\n", CsvParser::formatDate(columns.date[i]).c_str(), columns.openPrice[i],
+                columns.highPrice[i], columns.lowPrice[i], columns.closePrice[i], columns.adjClosePrice[i], columns.volume[i]);
+    }
+    return fclose(file) == 0;
+}
+
+// Function 'parseList' parses "1e3,1e4,100" into numbers.
+static std::vector<long long> parseList(const std::string &text)
+{
+    std::vector<long long> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+            values.push_back((long long)atof(item.c_str()));
+    }
+    return values;
+}
+
+static void writeJson(std::ostream &out, const std::vector<BenchResult> &results)
+{
+    char timestamp[32];
+    time_t now = time(nullptr);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    out << "{\n  \"timestamp\": \"" << timestamp << "\",\n  \"compiler\": \"" << __VERSION__ << "\",\n";
+    out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"peak_rss_kb\": " << getPeakRssKb() << ",\n  \"benchmarks\": [\n";
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        const BenchResult &result = results[r];
+        out << "    {\"name\": \"" << result.name << "\", \"rows\": " << result.rows << ", \"symbols\": " << result.symbols
+            << ", \"iterations\": " << result.iterations << ", \"seconds_per_iteration\": " << result.seconds
+            << ", \"rows_per_second\": " << result.rowsPerSecond << ", \"backtests_per_second\": " << result.backtestsPerSecond
+            << ", \"allocations_per_iteration\": " << result.allocationsPerIteration
+            << ", \"allocated_bytes_per_iteration\": " << result.allocatedBytesPerIteration << ", \"peak_rss_kb\": " << result.peakRssKb
+            << "}" << (r + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<long long> rowCounts = parseList("1e3,1e4,1e5,1e6");
+    std::vector<long long> symbolCounts = parseList("1,10,100,1000");
+    long long rowsPerSymbol = 2500;
+    std::string directory = "/tmp/tf_bench", outFile;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if (option == "--rows")
+            rowCounts = parseList(argv[i + 1]);
+        else if (option == "--symbols")
+            symbolCounts = parseList(argv[i + 1]);
+        else if (option == "--rows-per-symbol")
+            rowsPerSymbol = (long long)atof(argv[i + 1]);
+        else if (option == "--dir")
+            directory = argv[i + 1];
+        else if (option == "--out")
+            outFile = argv[i + 1];
+    }
+
+    std::string command = "rm -rf '" + directory + "' && mkdir -p '" + directory + "'";
+    if (system(command.c_str()) != 0)
+    {
+        std::cerr << "Unable to create " << directory << "\n";
+        return 1;
+    }
+
+    // The benchmarks measure parsing, so the binary column cache is switched off.
+    ColumnCache::setEnabled(false);
+    std::vector<BenchResult> results;
+
+    for (size_t r = 0; r < rowCounts.size(); r++)
+    {
+        long long rows = rowCounts[r];
+        std::shared_ptr<DataColumns> columns = generateColumns(rows, 7);
+        std::string csvFile = directory + "/rows.csv";
+        if (!writeCsv(csvFile, *columns))
+        {
+            std::cerr << "Unable to write " << csvFile << "\n";
+            return 1;
+        }
+
+        results.push_back(measure("csv_parse", rows, 1, 0, [&]()
+                                  { Data data("bench", csvFile); }));
+
+        Data data("bench", columns);
+        TrendFollowingStrategy strategy("Trend Following Strategy");
+        std::vector<float> kmax(size_t(rows) + 1), kmin(size_t(rows) + 1);
+
+        results.push_back(measure("kmax_kmin_fused", rows, 1, 0, [&]()
+                                  {
+                                      TrendFollowingStrategy::getKMaxMin(data, 90, kmax.data(), kmin.data());
+                                      benchmarkSink = benchmarkSink + kmax[size_t(rows) - 1];
+                                  }));
+        results.push_back(measure("kmax_kmin_allocating", rows, 1, 0, [&]()
+                                  {
+                                      delete[] TrendFollowingStrategy::getKMax(data, 90);
+                                      delete[] TrendFollowingStrategy::getKMin(data, 90);
+                                  }));
+        results.push_back(measure("get_trade_signals", rows, 1, 1, [&]()
+                                  { delete[] strategy.getTradeSignals(data); }));
+
+        std::unique_ptr<int8_t[]> signals(strategy.getTradeSignals(data));
+        results.push_back(measure("evaluate_results", rows, 1, 1, [&]()
+                                  {
+                                      BacktestResult result = Backtest::evaluateSignals(data, signals.get());
+                                      benchmarkSink = benchmarkSink + result.totalProfitPercent;
+                                  }));
+        results.push_back(measure("resample_weekly", rows, 1, 0, [&]()
+                                  {
+                                      std::shared_ptr<DataColumns> weekly = Resampler::resample(data, Timeframe(Timeframe::WEEKS, 1));
+                                      benchmarkSink = benchmarkSink + weekly->closePrice.back();
+                                  }));
+    }
+
+    // Full Driver pipeline (load csv, signals, evaluation, results sink) over universes of increasing size.
+    std::shared_ptr<DataColumns> symbolColumns = generateColumns(rowsPerSymbol, 11);
+    std::string symbolFile = directory + "/symbol.csv";
+    writeCsv(symbolFile, *symbolColumns);
+
+    for (size_t s = 0; s < symbolCounts.size(); s++)
+    {
+        int numOfSymbols = int(symbolCounts[s]);
+        std::vector<std::string> files;
+        for (int i = 0; i < numOfSymbols; i++)
+        {
+            files.push_back(directory + "/symbol" + std::to_string(i) + ".csv");
+            std::ifstream fin(symbolFile.c_str(), std::ios::binary);
+            std::ofstream fout(files.back().c_str(), std::ios::binary);
+            fout << fin.rdbuf();
+        }
+
+        TrendFollowingStrategy strategy("Trend Following Strategy");
+        std::ostream nullStream(nullptr);
+
+        results.push_back(measure("driver_pipeline", rowsPerSymbol * numOfSymbols, numOfSymbols, numOfSymbols, [&]()
+                                  {
+                                      std::queue<std::pair<std::string, std::string>> inputs;
+                                      for (int i = 0; i < numOfSymbols; i++)
+                                          inputs.push(std::make_pair("S" + std::to_string(i), files[i]));
+
+                                      ResultsSink sink(nullStream, RESULTS_TEXT);
+                                      Driver driver;
+                                      driver.setSymbolInputs(inputs);
+                                      driver.setStrategyInstance(&strategy);
+                                      driver.setResultsSink(&sink);
+                                      driver.runBacktest();
+                                      sink.close();
+                                  }));
+
+        for (int i = 0; i < numOfSymbols; i++)
+            remove(files[i].c_str());
+    }
+
+    command = "rm -rf '" + directory + "'";
+    if (system(command.c_str()) != 0)
+        std::cerr << "Unable to remove " << directory << "\n";
+
+    writeJson(std::cout, results);
+    if (!outFile.empty())
+    {
+        std::ofstream fout(outFile.c_str());
+        writeJson(fout, results);
+        std::cerr << "Report written to " << outFile << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Benchmark reporting cold vs warm load times of the binary column cache for a synthetic universe.
+// The universe is made of copies of the bundled csv files, so every symbol has its own source file and cache file.
+//
+// Usage: bench/cache_bench [--symbols N] [--dir path]   (defaults to 500 symbols under /tmp/tf_cache_bench)
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/data.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Function 'loadUniverse' loads every file once and returns the elapsed seconds.
+static double loadUniverse(const std::vector<std::string> &files, long long &rows)
+{
+    rows = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        Data data("bench", files[i]);
+        rows += data.numberOfRows;
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int numOfSymbols = 500;
+    std::string directory = "/tmp/tf_cache_bench";
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::string(argv[i]) == "--symbols")
+            numOfSymbols = atoi(argv[i + 1]);
+        else if (std::string(argv[i]) == "--dir")
+            directory = argv[i + 1];
+    }
+
+    const char *sources[] = {"data/AAPL.csv", "data/AMZN.csv", "data/GOOG.csv", "data/META.csv",
+                             "data/NFLX.csv", "data/TSLA.csv"};
+    const int numOfSources = sizeof(sources) / sizeof(sources[0]);
+
+    // Build the universe: one csv copy per symbol.
+    std::string csvDirectory = directory + "/csv";
+    std::string command = "rm -rf '" + directory + "' && mkdir -p '" + csvDirectory + "'";
+    if (system(command.c_str()) != 0)
+    {
+        std::cerr << "Unable to create " << csvDirectory << "\n";
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    for (int s = 0; s < numOfSymbols; s++)
+    {
+        std::ifstream fin(sources[s % numOfSources], std::ios::binary);
+        char fileName[64];
+        snprintf(fileName, sizeof(fileName), "/SYM%05d.csv", s);
+        std::ofstream fout((csvDirectory + fileName).c_str(), std::ios::binary);
+        fout << fin.rdbuf();
+        files.push_back(csvDirectory + fileName);
+    }
+
+    ColumnCache::setDirectory(directory + "/cache");
+    long long rows;
+
+    ColumnCache::setEnabled(false);
+    double parseSeconds = loadUniverse(files, rows);
+
+    ColumnCache::setEnabled(true);
+    double coldSeconds = loadUniverse(files, rows);
+    double warmSeconds = loadUniverse(files, rows);
+
+    printf("symbols: %d, rows: %lld\n", numOfSymbols, rows);
+    printf("csv parse only      : %9.2f ms (%8.3f ms/symbol)\n", parseSeconds * 1e3, parseSeconds * 1e3 / numOfSymbols);
+    printf("cold (parse + write): %9.2f ms (%8.3f ms/symbol)\n", coldSeconds * 1e3, coldSeconds * 1e3 / numOfSymbols);
+    printf("warm (mmap cache)   : %9.2f ms (%8.3f ms/symbol)\n", warmSeconds * 1e3, warmSeconds * 1e3 / numOfSymbols);
+    printf("warm speedup vs csv : %9.2fx\n", parseSeconds / warmSeconds);
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Benchmark comparing the memory-mapped csv loader in Data::parseData against the original
+// ifstream + stringstream + stof parser it replaced. It also checks that both produce identical rows.
+//
+// Usage: bench/parse_bench [--repeat N] [file.csv ...]   (defaults to every data/*.csv file)
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/data.h"
+
+// The row type and parser as they were before the mmap loader, kept here as the benchmark baseline.
+struct LegacyDataPoint
+{
+    std::string date;
+    float openPrice;
+    float closePrice;
+    long long int volume;
+
+    void setData(const std::string &line)
+    {
+        std::string word;
+        std::stringstream s(line);
+        int column = 0;
+
+        while (getline(s, word, ','))
+        {
+            if (column == 0)
+                date = word;
+            if (column == 1)
+                openPrice = stof(word);
+            if (column == 4)
+                closePrice = stof(word);
+            if (column == 6)
+                volume = stoll(word);
+
+            column++;
+        }
+    }
+};
+
+static std::vector<LegacyDataPoint> legacyParseData(const std::string &fileName)
+{
+    std::vector<LegacyDataPoint> symbolData;
+    std::fstream fin;
+    fin.open(fileName, std::ios::in);
+    std::string temp;
+
+    while (fin >> temp)
+    {
+        LegacyDataPoint row;
+        row.setData(temp);
+        symbolData.push_back(row);
+    }
+
+    return symbolData;
+}
+
+// Function 'countMismatches' compares the rows produced by both parsers field by field (floats bitwise).
+static int countMismatches(const std::vector<LegacyDataPoint> &legacy, const Data &data)
+{
+    if (int(legacy.size()) != data.numberOfRows)
+        return int(legacy.size() > size_t(data.numberOfRows) ? legacy.size() - data.numberOfRows : data.numberOfRows - legacy.size());
+
+    int mismatches = 0;
+    for (int i = 0; i < data.numberOfRows; i++)
+    {
+        DataPoint point = data.getRow(i);
+        if (legacy[i].date != CsvParser::formatDate(point.date) ||
+            memcmp(&legacy[i].openPrice, &point.openPrice, sizeof(float)) != 0 ||
+            memcmp(&legacy[i].closePrice, &point.closePrice, sizeof(float)) != 0 ||
+            legacy[i].volume != point.volume)
+            mismatches++;
+    }
+    return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+    int repeat = 20;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--repeat" && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else
+            files.push_back(argv[i]);
+    }
+
+    if (files.empty())
+    {
+        const char *defaults[] = {"data/AAPL.csv", "data/AMZN.csv", "data/GOOG.csv", "data/META.csv",
+                                  "data/NFLX.csv", "data/TSLA.csv", "data/TSLA2.csv"};
+        files.assign(defaults, defaults + sizeof(defaults) / sizeof(defaults[0]));
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    double totalLegacySeconds = 0, totalMappedSeconds = 0;
+    long long totalRows = 0;
+    int totalMismatches = 0;
+
+    std::cout << "file                rows    legacy rows/s    mmap rows/s   speedup  mismatches\n";
+
+    for (size_t f = 0; f < files.size(); f++)
+    {
+        std::vector<LegacyDataPoint> legacy;
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < repeat; r++)
+            legacy = legacyParseData(files[f]);
+        double legacySeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        Data data("bench", files[f]);
+        start = Clock::now();
+        for (int r = 0; r < repeat; r++)
+            data.parseData(files[f]);
+        double mappedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        long long rows = (long long)data.numberOfRows * repeat;
+        int mismatches = countMismatches(legacy, data);
+
+        totalLegacySeconds += legacySeconds;
+        totalMappedSeconds += mappedSeconds;
+        totalRows += rows;
+        totalMismatches += mismatches;
+
+        printf("%-16s %7d %16.0f %14.0f %8.2fx %11d\n", files[f].c_str(), data.numberOfRows,
+               rows / legacySeconds, rows / mappedSeconds, legacySeconds / mappedSeconds, mismatches);
+    }
+
+    printf("%-16s %7lld %16.0f %14.0f %8.2fx %11d\n", "total", totalRows / (repeat > 0 ? repeat : 1),
+           totalRows / totalLegacySeconds, totalRows / totalMappedSeconds, totalLegacySeconds / totalMappedSeconds, totalMismatches);
+
+    // The legacy rows kept 4 fields in a padded struct with an inline std::string; the columns keep all 7 fields.
+    printf("\nbytes per row: legacy %zu (date, open, close, volume), columnar %zu (all 7 csv columns)\n",
+           sizeof(LegacyDataPoint), Data::getBytesPerRow());
+
+    return totalMismatches == 0 ? 0 : 1;
+}
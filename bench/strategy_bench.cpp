@@ -0,0 +1,146 @@
+// Benchmark of the per-bar cost of the TrendFollowingStrategy signal loop. It compares the original loop, which
+// looked every threshold up in the strategyParams map (building a std::string key) on every bar, with the
+// resolved TrendFollowingParams struct and the compile-time FixedTrendFollowingStrategy, and checks that all
+// of them produce identical signals. The K-max/K-min windows are computed once up front so only the signal
+// loop is timed; the last rows time the whole getTradeSignals call through the virtual Strategy interface.
+//
+// Usage: bench/strategy_bench [--repeat N] [file.csv]   (defaults to data/AAPL.csv)
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../src/strategy.h"
+
+// The original signal loop (strategyParams map lookups on every bar), kept here as the benchmark baseline.
+static void legacyTradeSignals(std::map<std::string, int> &strategyParams, const Data &data, const float *kmax, const float *kmin, int8_t *signals)
+{
+    const float *closePrices = data.closePrices().data();
+    TrendFollowingStrategy::TradeState state = TrendFollowingStrategy::NO_POSITION;
+    int tradePrice = 0;
+
+    for (int i = 0; i < data.numberOfRows; i++)
+    {
+        int maxPercentIncrease = Strategy::findPercentageChange(kmin[i], closePrices[i]);
+        int maxPercentDecrease = -1 * Strategy::findPercentageChange(kmax[i], closePrices[i]);
+        signals[i] = 0;
+
+        if (state == TrendFollowingStrategy::NO_POSITION)
+        {
+            if (maxPercentIncrease >= strategyParams["ENTER_TRIGGER_PERCENTAGE"])
+            {
+                state = TrendFollowingStrategy::LONG_POSITION;
+                signals[i] = 1;
+                tradePrice = closePrices[i];
+            }
+            else if (maxPercentDecrease >= strategyParams["ENTER_TRIGGER_PERCENTAGE"])
+            {
+                state = TrendFollowingStrategy::SHORT_POSITION;
+                signals[i] = 2;
+                tradePrice = closePrices[i];
+            }
+        }
+        else if (state == TrendFollowingStrategy::LONG_POSITION)
+        {
+            if (Strategy::findPercentageChange(tradePrice, closePrices[i]) >= strategyParams["TARGET_PERCENTAGE"] ||
+                maxPercentDecrease >= strategyParams["EXIT_TRIGGER_PERCENTAGE"] ||
+                (-1 * Strategy::findPercentageChange(tradePrice, closePrices[i]) >= strategyParams["STOP_LOSS_PERCENTAGE"]))
+            {
+                state = TrendFollowingStrategy::NO_POSITION;
+                signals[i] = -1;
+            }
+        }
+        else if (state == TrendFollowingStrategy::SHORT_POSITION)
+        {
+            if ((-1 * Strategy::findPercentageChange(tradePrice, closePrices[i])) >= strategyParams["TARGET_PERCENTAGE"] ||
+                maxPercentIncrease >= strategyParams["EXIT_TRIGGER_PERCENTAGE"] ||
+                (Strategy::findPercentageChange(tradePrice, closePrices[i]) >= strategyParams["STOP_LOSS_PERCENTAGE"]))
+            {
+                state = TrendFollowingStrategy::NO_POSITION;
+                signals[i] = -2;
+            }
+        }
+    }
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// Function 'timePerBar' runs 'kernel' 'repeat' times and returns the mean ns per bar.
+template <typename Kernel>
+static double timePerBar(int numberOfRows, int repeat, Kernel kernel)
+{
+    kernel(); // Warm up caches and the scratch arena.
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeat; r++)
+        kernel();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (double(repeat) * numberOfRows);
+}
+
+static void printRow(const char *name, double nsPerBar, double baselineNs)
+{
+    printf("%-40s %10.2f %10.1fM %9.2fx\n", name, nsPerBar, 1e3 / nsPerBar, baselineNs / nsPerBar);
+}
+
+int main(int argc, char **argv)
+{
+    int repeat = 200;
+    std::string fileName = "data/AAPL.csv";
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--repeat" && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else
+            fileName = argv[i];
+    }
+
+    Data data("AAPL", fileName);
+    if (data.numberOfRows == 0)
+    {
+        fprintf(stderr, "No rows loaded from %s\n", fileName.c_str());
+        return 1;
+    }
+
+    TrendFollowingStrategy dynamicStrategy("Trend Following Strategy");
+    DefaultTrendFollowingStrategy fixedStrategy("Trend Following Strategy");
+    const int N = data.numberOfRows;
+
+    std::vector<float> kmax(N), kmin(N);
+    TrendFollowingStrategy::getKMaxMin(data, 90, kmax.data(), kmin.data());
+    std::vector<int8_t> legacySignals(N), structSignals(N), fixedSignals(N);
+
+    std::map<std::string, int> legacyParams = dynamicStrategy.strategyParams;
+    double legacyNs = timePerBar(N, repeat, [&]()
+                                 { legacyTradeSignals(legacyParams, data, kmax.data(), kmin.data(), legacySignals.data()); });
+    double structNs = timePerBar(N, repeat, [&]()
+                                 { TrendFollowingStrategy::computeSignals(data, kmax.data(), kmin.data(), dynamicStrategy.getParams(), structSignals.data()); });
+    double fixedNs = timePerBar(N, repeat, [&]()
+                                { TrendFollowingStrategy::computeSignals(data, kmax.data(), kmin.data(), DefaultTrendFollowingStrategy::Params(), fixedSignals.data()); });
+
+    // The whole call (windows + signals + allocation) through Strategy*, as the Driver makes it.
+    Strategy *strategies[] = {&dynamicStrategy, &fixedStrategy};
+    double virtualNs[2];
+    bool identical = legacySignals == structSignals && legacySignals == fixedSignals;
+    for (int s = 0; s < 2; s++)
+    {
+        Strategy *strategy = strategies[s];
+        virtualNs[s] = timePerBar(N, repeat, [&]()
+                                  { delete[] strategy->getTradeSignals(data); });
+        int8_t *signals = strategy->getTradeSignals(data);
+        identical = identical && memcmp(signals, legacySignals.data(), N) == 0;
+        delete[] signals;
+    }
+
+    printf("%s: %d bars, %d repeats\n\n", fileName.c_str(), N, repeat);
+    printf("%-40s %10s %11s %10s\n", "signal loop", "ns/bar", "bars/s", "speedup");
+    printRow("legacy (map lookups per bar)", legacyNs, legacyNs);
+    printRow("TrendFollowingParams struct", structNs, legacyNs);
+    printRow("FixedTrendFollowingParams<90,5,5,20,10>", fixedNs, legacyNs);
+    printf("\n%-40s %10s %11s %10s\n", "getTradeSignals via Strategy*", "ns/bar", "bars/s", "vs legacy");
+    printRow("TrendFollowingStrategy", virtualNs[0], legacyNs);
+    printRow("DefaultTrendFollowingStrategy", virtualNs[1], legacyNs);
+    printf("\n%s\n", identical ? "All signal arrays identical" : "MISMATCH between signal arrays");
+
+    return identical ? 0 : 1;
+}
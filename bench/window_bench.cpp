@@ -0,0 +1,120 @@
+// Micro-benchmark of the rolling max/min kernels over a sweep of window sizes K and series lengths N.
+// It compares the original two-pass std::deque implementation of getKMax/getKMin with the fused ring buffer
+// and van Herk/Gil-Werman kernels in RollingWindow, and checks that all of them return identical windows.
+//
+// Usage: bench/window_bench [--max-rows N]   (defaults to 1000000)
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/rolling_window.h"
+
+// The original kernels (two separate passes, std::deque, raw new[]), kept here as the benchmark baseline.
+static float *legacyKMax(const float *closePrices, int N, int K)
+{
+    std::deque<int> Qi(K);
+    float *kmax = new float[N];
+    for (int i = 0; i < N; ++i)
+    {
+        while ((!Qi.empty()) && Qi.front() <= i - K)
+            Qi.pop_front();
+        while ((!Qi.empty()) && closePrices[i] >= closePrices[Qi.back()])
+            Qi.pop_back();
+        Qi.push_back(i);
+        kmax[i] = closePrices[Qi.front()];
+    }
+    return kmax;
+}
+
+static float *legacyKMin(const float *closePrices, int N, int K)
+{
+    std::deque<int> Qi(K);
+    float *kmin = new float[N];
+    for (int i = 0; i < N; ++i)
+    {
+        while ((!Qi.empty()) && Qi.front() <= i - K)
+            Qi.pop_front();
+        while ((!Qi.empty()) && closePrices[i] <= closePrices[Qi.back()])
+            Qi.pop_back();
+        Qi.push_back(i);
+        kmin[i] = closePrices[Qi.front()];
+    }
+    return kmin;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// Function 'timeKernel' runs 'kernel' until at least ~20M elements were processed and returns ns per element.
+template <typename Kernel>
+static double timeKernel(int N, Kernel kernel)
+{
+    int repeat = std::max(1, 20000000 / std::max(1, N));
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeat; r++)
+        kernel();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (double(repeat) * N);
+}
+
+int main(int argc, char **argv)
+{
+    int maxRows = 1000000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::string(argv[i]) == "--max-rows")
+            maxRows = atoi(argv[i + 1]);
+    }
+
+    // A geometric random walk looks enough like a price series for the deque to behave realistically.
+    std::vector<float> prices(size_t(std::max(1, maxRows)));
+    std::mt19937 generator(7);
+    std::normal_distribution<float> returns(0.0f, 0.02f);
+    float price = 100;
+    for (size_t i = 0; i < prices.size(); i++)
+        prices[i] = price *= (1 + returns(generator));
+
+    const int windowSizes[] = {2, 5, 10, 20, 50, 90, 200, 500, 2000, 10000};
+    std::vector<float> kmax(prices.size()), kmin(prices.size());
+    int failures = 0;
+
+    printf("%9s %6s  %12s %12s %12s  (ns per element, max and min together)\n", "N", "K", "legacy", "ring", "blocked");
+
+    for (int N = 1000; N <= maxRows; N *= 10)
+    {
+        for (size_t k = 0; k < sizeof(windowSizes) / sizeof(windowSizes[0]); k++)
+        {
+            int K = windowSizes[k];
+            if (K > N)
+                continue;
+
+            float *expectedMax = legacyKMax(prices.data(), N, K);
+            float *expectedMin = legacyKMin(prices.data(), N, K);
+
+            double legacyNs = timeKernel(N, [&]()
+                                         {
+                                             delete[] legacyKMax(prices.data(), N, K);
+                                             delete[] legacyKMin(prices.data(), N, K);
+                                         });
+
+            double ringNs = timeKernel(N, [&]()
+                                       { RollingWindow::computeRing(prices.data(), N, K, kmax.data(), kmin.data()); });
+            failures += memcmp(kmax.data(), expectedMax, N * sizeof(float)) != 0 || memcmp(kmin.data(), expectedMin, N * sizeof(float)) != 0;
+
+            double blockedNs = timeKernel(N, [&]()
+                                          { RollingWindow::computeBlocked(prices.data(), N, K, kmax.data(), kmin.data()); });
+            failures += memcmp(kmax.data(), expectedMax, N * sizeof(float)) != 0 || memcmp(kmin.data(), expectedMin, N * sizeof(float)) != 0;
+
+            printf("%9d %6d  %12.2f %12.2f %12.2f\n", N, K, legacyNs, ringNs, blockedNs);
+
+            delete[] expectedMax;
+            delete[] expectedMin;
+        }
+    }
+
+    printf(failures ? "MISMATCH: %d kernel runs differ from the legacy windows\n" : "All kernels match the legacy windows\n", failures);
+    return failures ? 1 : 0;
+}
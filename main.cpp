@@ -1,557 +1,937 @@
-#include <iostream>
-#include <vector>
-#include <queue>
-#include <map>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <iostream>
 #include <string>
-#include <sstream>
-#include <thread>
-#include <mutex>
-#include <memory>
 
-#define DEBUG false
+#include <sys/resource.h>
+
+#include "src/common.h"
+#include "src/cli.h"
+#include "src/data.h"
+#include "src/strategy.h"
+#include "src/backtest.h"
+#include "src/driver.h"
+#include "src/sweep.h"
+#include "src/streaming.h"
+#include "src/portfolio.h"
+#include "src/results_sink.h"
+#include "src/walk_forward.h"
+#include "src/chunked.h"
+#include "src/metrics.h"
+#include "src/symbol_store.h"
+#include "src/universe.h"
+#include "src/shard.h"
+#include "src/indicators.h"
+#include "src/multi_strategy.h"
+#include "src/instrumentation.h"
+
+// Function 'setSweepRanges' reads the --lookback/--enter/--exit/--target/--stop "start:end:step" ranges into 'sweep'.
+
+bool setSweepRanges(const CommandLine &commandLine, ParameterSweep &sweep)
+{
+    static const char *rangeOptions[ParameterSweep::NUM_OF_PARAMS] = {"lookback", "enter", "exit", "target", "stop"};
 
-std::mutex stdOutMutex;
+    for (int p = 0; p < ParameterSweep::NUM_OF_PARAMS; p++)
+    {
+        if (!commandLine.has(rangeOptions[p]))
+            continue;
 
-template <typename T>
-// This function prints a message to the standard output with an optional newline character.
-void printMessage(T msg, bool nextLine = true)
-{
-    // Lock a mutex to ensure thread safety when printing.
-    stdOutMutex.lock();
+        ParameterRange range;
+        if (!ParameterRange::parse(commandLine.getString(rangeOptions[p], ""), range))
+        {
+            printMessage(std::string("Invalid range for --") + rangeOptions[p] + ", expected start:end:step");
+            return false;
+        }
+        sweep.setRange(p, range);
+    }
+
+    return true;
+}
 
-    // Print the message to the standard output.
-    std::cout << msg;
+// Function 'setExecutionSettings' reads --fill close|intrabar, --tie stop|target|nearest, --slippage PCT and
+// --commission PCT (per fill) into 'execution'.
 
-    // Check if the 'nextLine' flag is set to true.
-    if (nextLine)
+bool setExecutionSettings(const CommandLine &commandLine, ExecutionSettings &execution)
+{
+    if (!ExecutionSettings::parseFillModel(commandLine.getString("fill", "close"), execution.fillModel))
     {
-        // If true, add a newline character to the end of the message.
-        std::cout << std::endl;
+        printMessage("Unknown --fill '" + commandLine.getString("fill", "") + "'. Available models: close, intrabar");
+        return false;
     }
-    else
+    if (!ExecutionSettings::parseTieBreak(commandLine.getString("tie", "stop"), execution.tieBreak))
     {
-        // If false, add a space character to the end of the message.
-        std::cout << " ";
+        printMessage("Unknown --tie '" + commandLine.getString("tie", "") + "'. Available rules: stop, target, nearest");
+        return false;
     }
-
-    // Unlock the mutex to release the lock for other threads.
-    stdOutMutex.unlock();
+    execution.slippagePercent = float(commandLine.getDouble("slippage", 0));
+    execution.commissionPercent = float(commandLine.getDouble("commission", 0));
+    return true;
 }
 
-// Define a C++ struct named 'DataPoint' to store financial data.
-struct DataPoint
+// Function 'getTimeframe' reads --timeframe (native, daily, weekly, monthly, 5m, 1h, 2w, 3mo, ...) into 'timeframe'.
+
+bool getTimeframe(const CommandLine &commandLine, Timeframe &timeframe)
 {
-    std::string date;     // Stores the date associated with the data point.
-    float openPrice;      // Stores the opening price of the instrument.
-    float closePrice;     // Stores the closing price of the instrument.
-    long long int volume; // Stores the trading volume associated with the data point.
+    if (Timeframe::parse(commandLine.getString("timeframe", "native"), timeframe))
+        return true;
 
-    // Member function to set the data members of the struct from a comma-separated string.
-    void setData(const std::string &line)
-    {
-        std::string word;
-        std::stringstream s(line);
-        int column = 0;
+    printMessage("Unknown --timeframe '" + commandLine.getString("timeframe", "") + "'. Use native, daily, weekly, monthly or <N>m|h|d|w|mo");
+    return false;
+}
 
-        // Tokenize the input line using a comma as the delimiter.
-        while (getline(s, word, ','))
-        {
-            // Check the column position to determine which member to assign the value to.
-            if (column == 0)
-                date = word; // Assign the first column (date) to 'date'.
-            if (column == 1)
-                openPrice = stof(word); // Assign the second column (openPrice) to 'openPrice'.
-            if (column == 4)
-                closePrice = stof(word); // Assign the fifth column (closePrice) to 'closePrice'.
-            if (column == 6)
-                volume = stoll(word); // Assign the seventh column (volume) to 'volume'.
-
-            column++; // Move to the next column in the input line.
-        }
-    }
-};
+// Function 'getSymbolInputs' reads the symbols to run into 'symbolInputs': the universe named by --universe (a
+// directory, glob pattern, csv file or manifest), else the --symbols list, else the csv files bundled in data/.
+// Universe files that fail validation are reported and left out; it returns false when no symbol is left.
 
-// Define a C++ class named 'Data' to handle financial data.
-class Data
+bool getSymbolInputs(const CommandLine &commandLine, std::vector<std::pair<std::string, std::string>> &symbolInputs)
 {
-public:
-    std::string symbolName;            // Stores the symbol name associated with the data.
-    std::vector<DataPoint> symbolData; // Stores a collection of DataPoint objects.
-    int numberOfRows;                  // Stores the number of rows in the data.
-
-    // Constructor that takes symbol name and a file name to parse data.
-    Data(std::string symbolName, std::string fileName)
-        : symbolName(symbolName), numberOfRows(0)
+    if (!commandLine.has("universe"))
     {
-        parseData(fileName); // Call the parseData function to initialize the data.
+        symbolInputs = commandLine.getSymbolInputs(Driver::getDefaultSymbolInputs());
+        return true;
     }
 
-    // Member function to parse data from a file and populate the symbolData vector.
-    void parseData(const std::string &fileName)
+    std::vector<std::string> problems;
+    symbolInputs = SymbolUniverse::discover(commandLine.getString("universe", ""), problems);
+    for (size_t i = 0; i < problems.size(); i++)
+        printMessage("Skipping " + problems[i]);
+
+    if (symbolInputs.empty())
     {
-        numberOfRows = 0;   // Initialize the row count to 0.
-        symbolData.clear(); // Clear any existing data.
+        printMessage("No valid csv file in --universe '" + commandLine.getString("universe", "") + "'");
+        return false;
+    }
+    return true;
+}
 
-        std::fstream fin;                 // Create a file stream object.
-        fin.open(fileName, std::ios::in); // Open the file for reading.
-        std::string temp, line;
+// Function 'getIntList' reads the comma separated positive integers of option 'key' (e.g. --lookbacks 30,60,90)
+// into 'values'; a missing option leaves it empty. It returns false (after printing why) on anything else.
 
-        // Loop to read data from the file.
-        while (fin >> temp)
+bool getIntList(const CommandLine &commandLine, const std::string &key, std::vector<int> &values)
+{
+    std::string list = commandLine.getString(key, "");
+    for (const char *cursor = list.c_str(); *cursor;)
+    {
+        char *end = nullptr;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor || value <= 0 || value > 1000000 || (*end && *end != ','))
         {
-            DataPoint row;             // Create a DataPoint object to store a row of data.
-            row.setData(temp);         // Parse and set data for the row.
-            symbolData.push_back(row); // Add the row to the symbolData vector.
-            numberOfRows++;            // Increment the row count.
+            printMessage("Invalid --" + key + " '" + list + "'. Use a comma separated list such as 1,2,4");
+            return false;
         }
+        values.push_back(int(value));
+        cursor = *end ? end + 1 : end;
     }
+    return true;
+}
+
+// Function 'configureSweep' reads the symbols, grid, sampling, execution model, timeframe and ranking options
+// shared by the sweep and shard modes into 'sweep'. It returns false (after printing why) on an invalid option.
 
-    // Member function to print the stored data to the console.
-    void printData()
+bool configureSweep(const CommandLine &commandLine, ParameterSweep &sweep)
+{
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+    if (!getSymbolInputs(commandLine, symbolInputs))
+        return false;
+    sweep.setSymbolInputs(symbolInputs);
+    sweep.setNumOfThreads(int(commandLine.getInt("threads", 0)));
+    sweep.setSampling(commandLine.getInt("sample", 0), (unsigned int)commandLine.getInt("seed", 42));
+    sweep.setScalarReference(commandLine.has("scalar"));
+
+    ExecutionSettings execution;
+    if (!setExecutionSettings(commandLine, execution))
+        return false;
+    sweep.setExecution(execution);
+
+    Timeframe timeframe;
+    if (!getTimeframe(commandLine, timeframe))
+        return false;
+    sweep.setTimeframe(timeframe);
+
+    MetricsRank rank;
+    if (!MetricsEngine::parseRank(commandLine.getString("rank", "profit"), rank))
     {
-        for (int row = 0; row < numberOfRows; row++)
-        {
-            std::cout << symbolData[row].date << ", " << symbolData[row].openPrice << ", " << symbolData[row].closePrice << ", " << symbolData[row].volume << std::endl;
-        }
+        printMessage("Unknown --rank '" + commandLine.getString("rank", "") + "'. Use profit, sharpe, sortino, cagr, calmar or profit-factor");
+        return false;
     }
-
-    // Destructor for the class.
-    ~Data()
+    if (rank != RANK_PROFIT && !execution.isCloseOnly())
     {
-        // If DEBUG flag is set, print a message indicating deconstruction.
-        if (DEBUG)
-            printMessage("Deconstructing Data Object");
+        printMessage("--rank " + commandLine.getString("rank", "") + " measures close fills and cannot be combined with --fill intrabar, --slippage or --commission");
+        return false;
     }
-};
+    sweep.setRank(rank);
+
+    return setSweepRanges(commandLine, sweep);
+}
 
-// Define a C++ class named 'Strategy' for implementing trading strategies.
-class Strategy
+// Function 'runSweepMode' grids TrendFollowingStrategy over the parameter ranges given on the command line.
+// Usage: main sweep [--lookback 30:120:30] [--enter 3:7:1] [--exit 3:7:1] [--target 10:30:5] [--stop 5:15:5]
+//                   [--sample N] [--seed S] [--threads N] [--symbols Name=path,... | --universe dir|glob|manifest] [--out file.csv] [--top N] [--stats]
+//                   [--scalar]   (evaluate one parameter set at a time instead of in SIMD lanes)
+//                   [--fill close|intrabar] [--tie stop|target|nearest] [--slippage PCT] [--commission PCT]
+//                   [--timeframe weekly|monthly|5m|...] [--rank profit|sharpe|sortino|cagr|calmar|profit-factor]
+
+int runSweepMode(const CommandLine &commandLine)
 {
-public:
-    std::string strategyName;                  // Stores the name of the strategy.
-    std::map<std::string, int> strategyParams; // Stores strategy-specific parameters.
+    ParameterSweep sweep;
+    if (!configureSweep(commandLine, sweep))
+        return 1;
 
-    // Pure virtual function to get trade signals based on financial data.
-    virtual int8_t *getTradeSignals(const Data &data) = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sweep.run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-    // Static function to calculate and return the percentage change between two values.
-    static float findPercentageChange(const float &startValue, const float &endValue)
+    std::string outFile = commandLine.getString("out", "sweep_results.csv");
+    if (!sweep.writeResults(outFile))
     {
-        return ((endValue - startValue) * 100) / startValue;
+        printMessage("Unable to write sweep results to " + outFile);
+        return 1;
     }
 
-    // Virtual destructor for the class.
-    virtual ~Strategy()
+    sweep.printTopResults(int(commandLine.getInt("top", 10)));
+
+    size_t numOfBacktests = sweep.getResults().size();
+    std::cout << "\nParameter sets: " << sweep.getParameterSets().size() << " (grid size " << sweep.getGridSize() << ")\n";
+    std::cout << "Backtests: " << numOfBacktests << " in " << seconds << " s (" << numOfBacktests / seconds << " backtests/s)\n";
+    std::cout << "Ranked results written to " << outFile << std::endl;
+
+    if (commandLine.has("stats"))
+        WorkStealingPool::printStats(sweep.getWorkerStats());
+
+    return 0;
+}
+
+// Function 'runShardMode' runs the sweep on local worker processes. Units of work are journaled to the checkpoint
+// as they complete, so rerunning the same command after a crash only evaluates the missing units; the checkpoint is
+// removed once the results are written. --scaling runs the sweep once per worker count and reports the speedup.
+// Usage: main shard [--workers N] [--unit-sets 64] [--checkpoint shard_checkpoint.bin|none] [--fresh] [--scaling 1,2,4]
+//                   [--stats] plus every sweep option (ranges, --symbols/--universe, --out, --top, --rank, ...)
+
+int runShardMode(const CommandLine &commandLine)
+{
+    ParameterSweep sweep;
+    if (!configureSweep(commandLine, sweep))
+        return 1;
+
+    int numOfWorkers = int(commandLine.getInt("workers", std::max(1u, std::thread::hardware_concurrency())));
+    int unitSets = int(commandLine.getInt("unit-sets", 64));
+    std::string error;
+
+    std::vector<int> scaling;
+    if (!getIntList(commandLine, "scaling", scaling))
+        return 1;
+    if (!scaling.empty())
     {
-        // Destructor is empty here; it can be overridden in derived classes.
+        // Each worker count runs the whole sweep without a checkpoint; speedup is relative to the first count.
+        printf("%8s %10s %14s %9s %11s\n", "workers", "seconds", "backtests/s", "speedup", "efficiency");
+        double baseline = 0;
+        for (size_t i = 0; i < scaling.size(); i++)
+        {
+            ShardCoordinator coordinator(sweep, scaling[i], unitSets);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            if (!coordinator.run(true, error))
+            {
+                printMessage("Shard run failed: " + error);
+                return 1;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (i == 0)
+                baseline = seconds;
+            double speedup = baseline / seconds;
+            printf("%8d %10.3f %14.0f %8.2fx %10.1f%%\n", scaling[i], seconds, sweep.getResults().size() / seconds, speedup,
+                   100 * speedup * scaling[0] / scaling[i]);
+        }
+        printf("Hardware threads: %u\n", std::thread::hardware_concurrency());
+        return 0;
     }
-};
 
-class TrendFollowingStrategy : public Strategy
-{
-public:
-    TrendFollowingStrategy(std::string strategyName)
+    ShardCoordinator coordinator(sweep, numOfWorkers, unitSets);
+    std::string checkpointFile = commandLine.getString("checkpoint", "shard_checkpoint.bin");
+    if (checkpointFile != "none")
+        coordinator.setCheckpointFile(checkpointFile);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!coordinator.run(commandLine.has("fresh"), error))
     {
-        this->strategyName = strategyName;
-        strategyParams["LOOKBACK_PERIOD"] = 90;
-        strategyParams["ENTER_TRIGGER_PERCENTAGE"] = 5;
-        strategyParams["EXIT_TRIGGER_PERCENTAGE"] = 5;
-        strategyParams["TARGET_PERCENTAGE"] = 20;
-        strategyParams["STOP_LOSS_PERCENTAGE"] = 10;
+        printMessage("Shard run failed: " + error);
+        return 1;
     }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-    TrendFollowingStrategy(std::string strategyName, int lookBackPeriod, int entryTrigger, int exitTrigger, int targetPercentage, int stopLoss)
+    std::string outFile = commandLine.getString("out", "sweep_results.csv");
+    if (!sweep.writeResults(outFile))
     {
-        this->strategyName = strategyName;
-        strategyParams["LOOKBACK_PERIOD"] = lookBackPeriod;
-        strategyParams["ENTER_TRIGGER_PERCENTAGE"] = entryTrigger;
-        strategyParams["EXIT_TRIGGER_PERCENTAGE"] = exitTrigger;
-        strategyParams["TARGET_PERCENTAGE"] = targetPercentage;
-        strategyParams["STOP_LOSS_PERCENTAGE"] = stopLoss;
+        printMessage("Unable to write sweep results to " + outFile);
+        return 1;
     }
+    if (checkpointFile != "none")
+        unlink(checkpointFile.c_str());
 
-    // Function 'getKMax' calculates the maximum closing prices within a sliding window of size K
-    // and returns an array of those maximum values.
+    sweep.printTopResults(int(commandLine.getInt("top", 10)));
 
-    // Parameters:
-    // - 'data': The financial data containing historical closing prices.
-    // - 'K': The size of the sliding window.
+    size_t numOfBacktests = sweep.getResults().size();
+    std::cout << "\nParameter sets: " << sweep.getParameterSets().size() << " (grid size " << sweep.getGridSize() << ")\n";
+    std::cout << "Units: " << coordinator.getNumOfUnits() << " (" << coordinator.getResumedUnits() << " resumed from the checkpoint) on "
+              << numOfWorkers << " worker processes\n";
+    std::cout << "Backtests: " << numOfBacktests << " in " << seconds << " s (" << numOfBacktests / seconds << " backtests/s)\n";
+    std::cout << "Ranked results written to " << outFile << std::endl;
 
-    // Returns:
-    // - A dynamically allocated array of floats containing the K-maximum closing prices.
+    if (commandLine.has("stats"))
+        coordinator.printStats();
 
-    static float *getKMax(const Data &data, int K)
-    {
-        std::deque<int> Qi(K); // Create a deque to store indices within the sliding window.
-        int i, N = data.numberOfRows;
-        float mx = INT_MIN;         // Initialize a variable to track the maximum value.
-        float *kmax = new float[N]; // Allocate memory for the K-maximum array.
+    return 0;
+}
 
-        for (i = 0; i < N; ++i)
-        {
-            // Remove elements from the front of the deque if they are outside the window.
-            while ((!Qi.empty()) && Qi.front() <= i - K)
-                Qi.pop_front();
+// Function 'verifyBatchLanes' checks every lane of BatchSignals<LANES> against 'expected' (the results of
+// getTradeSignals + Backtest::evaluateSignals) for one lookback group and returns the number of mismatching lanes.
 
-            // Remove elements from the back of the deque if they are less than the current closing price.
-            while ((!Qi.empty()) && data.symbolData[i].closePrice >= data.symbolData[Qi.back()].closePrice)
-                Qi.pop_back();
+template <int LANES>
+int verifyBatchLanes(const Data &data, const float *kmax, const float *kmin, const std::vector<ThresholdSet> &sets,
+                     const std::vector<BacktestResult> &expected, bool scalarReference)
+{
+    int mismatches = 0;
+    BacktestResult results[LANES];
 
-            Qi.push_back(i); // Add the current index to the deque.
+    for (size_t begin = 0; begin < sets.size(); begin += LANES)
+    {
+        int count = int(std::min(sets.size() - begin, size_t(LANES)));
+        if (scalarReference)
+            BatchSignals<LANES>::evaluateScalar(data, kmax, kmin, &sets[begin], count, results);
+        else
+            BatchSignals<LANES>::evaluate(data, kmax, kmin, &sets[begin], count, results);
 
-            kmax[i] = data.symbolData[Qi.front()].closePrice; // Store the maximum value at the current index.
+        for (int lane = 0; lane < count; lane++)
+        {
+            const BacktestResult &a = results[lane], &b = expected[begin + lane];
+            if (a.totalTrades != b.totalTrades || a.numOfProfitableTrades != b.numOfProfitableTrades ||
+                memcmp(&a.totalProfitPercent, &b.totalProfitPercent, sizeof(float)) != 0)
+                mismatches++;
         }
-
-        return kmax; // Return the array of K-maximum closing prices.
     }
 
-    // Function 'getKMin' calculates the minimum closing prices within a sliding window of size K
-    // and returns an array of those minimum values.
-
-    // Parameters:
-    // - 'data': The financial data containing historical closing prices.
-    // - 'K': The size of the sliding window.
+    return mismatches;
+}
 
-    // Returns:
-    // - A dynamically allocated array of floats containing the K-minimum closing prices.
+// Function 'runVerifyBatchMode' backtests every parameter set of the sweep grid on every symbol with
+// TrendFollowingStrategy, then checks that the scalar reference and the 8 and 16 lane SIMD kernels of BatchSignals
+// produce bitwise identical results for every lane.
+// Usage: main verify-batch [--lookback 30:120:30] [--enter 3:7:1] [--exit 3:7:1] [--target 10:30:5] [--stop 5:15:5]
+//                          [--symbols Name=path,... | --universe dir|glob|manifest]
 
-    static float *getKMin(const Data &data, int K)
+int runVerifyBatchMode(const CommandLine &commandLine)
+{
+    ParameterSweep sweep;
+    if (!setSweepRanges(commandLine, sweep))
+        return 1;
+    sweep.buildParameterSets();
+    const std::vector<std::vector<int>> &parameterSets = sweep.getParameterSets();
+
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+    if (!getSymbolInputs(commandLine, symbolInputs))
+        return 1;
+    long long lanesChecked = 0, mismatches = 0;
+
+    for (size_t s = 0; s < symbolInputs.size(); s++)
     {
-        std::deque<int> Qi(K); // Create a deque to store indices within the sliding window.
-        int i, N = data.numberOfRows;
-        float mn = INT_MAX;         // Initialize a variable to track the minimum value.
-        float *kmin = new float[N]; // Allocate memory for the K-minimum array.
+        Data data(symbolInputs[s].first, symbolInputs[s].second);
+        std::vector<float> kmax(size_t(data.numberOfRows) + 1), kmin(size_t(data.numberOfRows) + 1);
 
-        for (i = 0; i < N; ++i)
+        for (size_t groupBegin = 0; groupBegin < parameterSets.size();)
         {
-            // Remove elements from the front of the deque if they are outside the window.
-            while ((!Qi.empty()) && Qi.front() <= i - K)
-                Qi.pop_front();
+            size_t groupEnd = groupBegin;
+            while (groupEnd < parameterSets.size() && parameterSets[groupEnd][0] == parameterSets[groupBegin][0])
+                groupEnd++;
 
-            // Remove elements from the back of the deque if they are greater than the current closing price.
-            while ((!Qi.empty()) && data.symbolData[i].closePrice <= data.symbolData[Qi.back()].closePrice)
-                Qi.pop_back();
+            TrendFollowingStrategy::getKMaxMin(data, parameterSets[groupBegin][0], kmax.data(), kmin.data());
 
-            Qi.push_back(i); // Add the current index to the deque.
+            std::vector<ThresholdSet> sets;
+            std::vector<BacktestResult> expected;
+            for (size_t p = groupBegin; p < groupEnd; p++)
+            {
+                const std::vector<int> &params = parameterSets[p];
+                TrendFollowingStrategy strategy("Trend Following Strategy", params[0], params[1], params[2], params[3], params[4]);
+                std::unique_ptr<int8_t[]> signals(strategy.getTradeSignals(data, kmax.data(), kmin.data()));
+                expected.push_back(Backtest::evaluateSignals(data, signals.get()));
 
-            kmin[i] = data.symbolData[Qi.front()].closePrice; // Store the minimum value at the current index.
-        }
+                ThresholdSet set = {params[1], params[2], params[3], params[4]};
+                sets.push_back(set);
+            }
 
-        return kmin; // Return the array of K-minimum closing prices.
-    }
+            mismatches += verifyBatchLanes<8>(data, kmax.data(), kmin.data(), sets, expected, true);
+            mismatches += verifyBatchLanes<8>(data, kmax.data(), kmin.data(), sets, expected, false);
+            mismatches += verifyBatchLanes<16>(data, kmax.data(), kmin.data(), sets, expected, false);
+            lanesChecked += 3 * (long long)sets.size();
 
-    // Function 'getTradeSignals' calculates trading signals based on a trend-following strategy.
-    // It evaluates historical data to determine buy (1) and sell (-1) signals for long and short positions.
+            groupBegin = groupEnd;
+        }
+    }
 
-    // Parameters:
-    // - 'data': The financial data containing historical closing prices and volume.
+    std::cout << "Lanes checked: " << lanesChecked << " (" << parameterSets.size() << " parameter sets x "
+              << symbolInputs.size() << " symbols x 3 kernels), mismatches: " << mismatches << std::endl;
+    printMessage(mismatches ? "SIMD batch results differ from TrendFollowingStrategy" : "SIMD batch results identical to TrendFollowingStrategy");
+    return mismatches ? 1 : 0;
+}
 
-    // Returns:
-    // - A dynamically allocated array of int8_t values representing trading signals:
-    //   - 1: Buy signal (long position)
-    //   - -1: Sell signal (exit long position)
-    //   - 2: Short signal (short position)
-    //   - -2: Cover signal (exit short position)
-    //   - 0: No action
+// Function 'runWalkForwardMode' optimizes TrendFollowingStrategy on rolling train windows (or k-fold train sets),
+// evaluates the winner on the following test window and reports the stitched out-of-sample results.
+// Usage: main walk-forward [--train 1000] [--test 250] [--step N] [--anchored] [--folds K]
+//                          [--lookback 30:120:30] [--enter 3:7:1] [--exit 3:7:1] [--target 10:30:5] [--stop 5:15:5]
+//                          [--threads N] [--symbols Name=path,... | --universe dir|glob|manifest] [--out walk_forward.csv] [--stats] [--timeframe weekly|...]
 
-    int8_t *getTradeSignals(const Data &data)
+int runWalkForwardMode(const CommandLine &commandLine)
+{
+    WalkForwardSettings settings;
+    settings.trainBars = int(commandLine.getInt("train", settings.trainBars));
+    settings.testBars = int(commandLine.getInt("test", settings.testBars));
+    settings.stepBars = int(commandLine.getInt("step", 0));
+    settings.anchored = commandLine.has("anchored");
+    settings.folds = int(commandLine.getInt("folds", 0));
+    if (settings.folds == 1 || settings.folds < 0 || (settings.folds == 0 && (settings.trainBars <= 0 || settings.testBars <= 0)))
     {
-        // Define trade states as an enum.
-        enum TradeState
-        {
-            NO_POSITION = 0,
-            LONG_POSITION = 1,
-            SHORT_POSITION = -1
-        };
-
-        int8_t *signals = new int8_t[data.numberOfRows]; // Allocate memory for the signals.
-        TradeState state = NO_POSITION;                  // Initialize the trade state to no position.
-        int tradePrice = 0;                              // Initialize the trade price.
+        printMessage("Invalid walk-forward settings: --train and --test must be positive, --folds at least 2");
+        return 1;
+    }
 
-        // Calculate K-maximum and K-minimum arrays using trend-following strategy functions.
-        float *kmax = TrendFollowingStrategy::getKMax(data, strategyParams["LOOKBACK_PERIOD"]);
-        float *kmin = TrendFollowingStrategy::getKMin(data, strategyParams["LOOKBACK_PERIOD"]);
+    WalkForward walkForward;
+    walkForward.setSettings(settings);
+    walkForward.setNumOfThreads(int(commandLine.getInt("threads", 0)));
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+    if (!getSymbolInputs(commandLine, symbolInputs))
+        return 1;
+    walkForward.setSymbolInputs(symbolInputs);
 
-        for (int i = 0; i < data.numberOfRows; i++)
-        {
-            int maxPercentIncrease = findPercentageChange(kmin[i], data.symbolData[i].closePrice);
-            int maxPercentDecrease = -1 * findPercentageChange(kmax[i], data.symbolData[i].closePrice);
+    Timeframe timeframe;
+    if (!getTimeframe(commandLine, timeframe))
+        return 1;
+    walkForward.setTimeframe(timeframe);
 
-            if (state == NO_POSITION)
-            {
-                if (maxPercentIncrease >= strategyParams["ENTER_TRIGGER_PERCENTAGE"])
-                {
-                    state = LONG_POSITION;
-                    signals[i] = 1; // Set a buy signal for a long position.
-                    tradePrice = data.symbolData[i].closePrice;
-                }
-                else if (maxPercentDecrease >= strategyParams["ENTER_TRIGGER_PERCENTAGE"])
-                {
-                    state = SHORT_POSITION;
-                    signals[i] = 2; // Set a short signal for a short position.
-                    tradePrice = data.symbolData[i].closePrice;
-                }
-                else
-                {
-                    signals[i] = 0; // No action.
-                }
-            }
-            else if (state == LONG_POSITION)
-            {
-                if (findPercentageChange(tradePrice, data.symbolData[i].closePrice) >= strategyParams["TARGET_PERCENTAGE"] ||
-                    maxPercentDecrease >= strategyParams["EXIT_TRIGGER_PERCENTAGE"] ||
-                    (-1 * findPercentageChange(tradePrice, data.symbolData[i].closePrice) >= strategyParams["STOP_LOSS_PERCENTAGE"]))
-                {
-                    state = NO_POSITION;
-                    signals[i] = -1; // Set a sell signal to exit the long position.
-                }
-                else
-                {
-                    signals[i] = 0; // No action.
-                }
-            }
-            else if (state == SHORT_POSITION)
-            {
-                if ((-1 * findPercentageChange(tradePrice, data.symbolData[i].closePrice)) >= strategyParams["TARGET_PERCENTAGE"] ||
-                    maxPercentIncrease >= strategyParams["EXIT_TRIGGER_PERCENTAGE"] ||
-                    (findPercentageChange(tradePrice, data.symbolData[i].closePrice) >= strategyParams["STOP_LOSS_PERCENTAGE"]))
-                {
-                    state = NO_POSITION;
-                    signals[i] = -2; // Set a cover signal to exit the short position.
-                }
-                else
-                {
-                    signals[i] = 0; // No action.
-                }
-            }
-        }
+    if (!setSweepRanges(commandLine, walkForward.getGrid()))
+        return 1;
 
-        delete[] kmax; // Deallocate memory for the K-maximum array.
-        delete[] kmin; // Deallocate memory for the K-minimum array.
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    walkForward.run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-        return signals; // Return the array of trading signals.
+    std::string outFile = commandLine.getString("out", "walk_forward.csv");
+    if (!walkForward.writeResults(outFile))
+    {
+        printMessage("Unable to write walk-forward results to " + outFile);
+        return 1;
     }
 
-    ~TrendFollowingStrategy()
+    printf("%-10s %6s %12s %12s %12s %12s %12s\n", "symbol", "splits", "IS trades", "IS total%", "OOS trades", "OOS total%", "OOS avg%");
+    size_t numOfSplits = 0;
+    for (size_t i = 0; i < walkForward.getSymbolInputs().size(); i++)
     {
-        strategyParams.clear();
-        if (DEBUG)
-            printMessage("Deconstructing Strategy Object");
+        BacktestResult inSample = walkForward.getInSampleResult(int(i));
+        BacktestResult outOfSample = walkForward.getStitchedResult(int(i));
+        numOfSplits += walkForward.getResults()[i].size();
+        printf("%-10s %6d %12d %12.2f %12d %12.2f %12.4f\n", walkForward.getSymbolInputs()[i].first.c_str(), int(walkForward.getResults()[i].size()),
+               inSample.totalTrades, inSample.totalProfitPercent, outOfSample.totalTrades, outOfSample.totalProfitPercent,
+               outOfSample.averageProfitPercent());
     }
-};
 
-class Backtest
+    std::cout << "\nSplits: " << numOfSplits << ", parameter sets per split: " << walkForward.getNumOfParameterSets() << ", time: " << seconds << " s\n";
+    std::cout << "Per-split results written to " << outFile << std::endl;
+
+    if (commandLine.has("stats"))
+        WorkStealingPool::printStats(walkForward.getWorkerStats());
+
+    return 0;
+}
+
+// Function 'runReplayMode' replays every symbol bar by bar through IncrementalTrendFollowingStrategy, checks that
+// each signal matches the batch TrendFollowingStrategy and reports per-bar latency percentiles.
+// Usage: main replay [--lookback 90] [--enter 5] [--exit 5] [--target 20] [--stop 10] [--symbols Name=path,... | --universe dir|glob|manifest]
+
+int runReplayMode(const CommandLine &commandLine)
 {
-    Strategy *strategyInstance;
-    std::shared_ptr<Data> dataInstance;
-    int8_t *tradeSignals;
+    TrendFollowingStrategy batchStrategy("Trend Following Strategy", int(commandLine.getInt("lookback", 90)),
+                                         int(commandLine.getInt("enter", 5)), int(commandLine.getInt("exit", 5)),
+                                         int(commandLine.getInt("target", 20)), int(commandLine.getInt("stop", 10)));
+    IncrementalTrendFollowingStrategy streamingStrategy(batchStrategy);
+
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+    if (!getSymbolInputs(commandLine, symbolInputs))
+        return 1;
+    int totalMismatches = 0;
+
+    printf("%-10s %7s %10s %9s %9s %9s %9s %9s\n", "symbol", "bars", "mismatches", "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns");
+    for (size_t s = 0; s < symbolInputs.size(); s++)
+    {
+        Data data(symbolInputs[s].first, symbolInputs[s].second);
+        ReplayReport report = ReplayHarness::replay(data, batchStrategy, streamingStrategy);
+        totalMismatches += report.mismatches;
+
+        printf("%-10s %7d %10d %9.0f %9.0f %9.0f %9.0f %9.0f\n", report.symbolName.c_str(), report.bars, report.mismatches,
+               report.latencyNs[0], report.latencyNs[1], report.latencyNs[2], report.latencyNs[3], report.latencyNs[4]);
+    }
+
+    printf(totalMismatches ? "Streaming signals differ from the batch signals\n" : "Streaming signals identical to the batch signals\n");
+    return totalMismatches ? 1 : 0;
+}
+
+// Function 'runPortfolioMode' trades every symbol's TrendFollowingStrategy signals out of one shared cash account
+// and writes the resulting equity curve.
+// Usage: main portfolio [--capital 100000] [--position-fraction 0.1] [--max-positions 10] [--lookback 90] [--enter 5]
+//                       [--exit 5] [--target 20] [--stop 10] [--threads N] [--symbols Name=path,... | --universe dir|glob|manifest] [--out file.csv]
+//                       [--timeframe weekly|monthly|5m|...]
 
-public:
-    Backtest(Strategy *strategyInstance, std::shared_ptr<Data> dataInstance)
-        : strategyInstance(strategyInstance), dataInstance(dataInstance), tradeSignals(nullptr)
+int runPortfolioMode(const CommandLine &commandLine)
+{
+    TrendFollowingStrategy strategy("Trend Following Strategy", int(commandLine.getInt("lookback", 90)),
+                                    int(commandLine.getInt("enter", 5)), int(commandLine.getInt("exit", 5)),
+                                    int(commandLine.getInt("target", 20)), int(commandLine.getInt("stop", 10)));
+
+    PortfolioSettings settings;
+    settings.initialCapital = commandLine.getDouble("capital", settings.initialCapital);
+    settings.positionFraction = commandLine.getDouble("position-fraction", settings.positionFraction);
+    settings.maxPositions = int(commandLine.getInt("max-positions", settings.maxPositions));
+    if (settings.initialCapital <= 0 || settings.positionFraction <= 0 || settings.positionFraction > 1 || settings.maxPositions < 1)
     {
+        printMessage("Invalid portfolio settings: --capital must be positive, --position-fraction in (0, 1], --max-positions at least 1");
+        return 1;
     }
 
-    void printResults(const int &totalTrades, const int &numOfProfitableTrades, const float &totalProfitPercent)
+    PortfolioBacktest portfolio(&strategy, settings, int(commandLine.getInt("threads", 0)));
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+    if (!getSymbolInputs(commandLine, symbolInputs))
+        return 1;
+    portfolio.setSymbolInputs(symbolInputs);
+
+    Timeframe timeframe;
+    if (!getTimeframe(commandLine, timeframe))
+        return 1;
+    portfolio.setTimeframe(timeframe);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    portfolio.run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string outFile = commandLine.getString("out", "equity_curve.csv");
+    if (!portfolio.writeEquityCurve(outFile))
     {
-        stdOutMutex.lock();
-        std::cout << "\n*************************************************************\n";
-        std::cout << "Symbol: " << dataInstance->symbolName << std::endl;
-        std::cout << "Strategy: " << strategyInstance->strategyName << std::endl;
-        std::cout << "Total Trades Taken: " << totalTrades << std::endl;
-        std::cout << "Number Of Profitable Trades: " << numOfProfitableTrades << std::endl;
-        std::cout << "Total Profit Percentage: " << totalProfitPercent << std::endl;
-        std::cout << "Average Profit Percentage Per Trade: " << float(totalProfitPercent) / float(totalTrades) << std::endl;
-        std::cout << "*************************************************************\n";
-        stdOutMutex.unlock();
+        printMessage("Unable to write the equity curve to " + outFile);
+        return 1;
     }
 
-    // Function 'evaluateResults' calculates and prints trading strategy evaluation results.
-    // It computes total profit percentage, the number of profitable trades, and total trades.
+    const PortfolioSummary &summary = portfolio.getSummary();
+    std::cout << "Initial capital: " << settings.initialCapital << "\n";
+    std::cout << "Final equity: " << summary.finalEquity << "\n";
+    std::cout << "Total return: " << summary.totalReturnPercent << "%\n";
+    std::cout << "Max drawdown: " << summary.maxDrawdownPercent << "%\n";
+    std::cout << "Trades taken: " << summary.tradesTaken << " (closed " << summary.tradesClosed << ", still open " << summary.openPositionsAtEnd << ")\n";
+    std::cout << "Entries rejected: " << summary.entriesRejected << "\n";
+    std::cout << "Peak open positions: " << summary.maxOpenPositions << "\n";
+    std::cout << "Events merged: " << summary.eventsMerged << " of " << portfolio.getTotalRows() << " bars in " << seconds << " s\n";
+    std::cout << "Equity curve written to " << outFile << std::endl;
+
+    return 0;
+}
+
+// Function 'runChunkedMode' backtests csv files block by block with bounded memory, for series larger than RAM.
+// --verify also runs the in-memory path and checks that both give identical results.
+// Usage: main chunked [--block-rows 262144] [--lookback 90] [--enter 5] [--exit 5] [--target 20] [--stop 10]
+//                     [--symbols Name=path,... | --universe dir|glob|manifest] [--verify]
 
-    void evaluateResults()
+int runChunkedMode(const CommandLine &commandLine)
+{
+    TrendFollowingStrategy strategy("Trend Following Strategy", int(commandLine.getInt("lookback", 90)),
+                                    int(commandLine.getInt("enter", 5)), int(commandLine.getInt("exit", 5)),
+                                    int(commandLine.getInt("target", 20)), int(commandLine.getInt("stop", 10)));
+    int blockRows = int(commandLine.getInt("block-rows", 1 << 18));
+    bool verify = commandLine.has("verify");
+
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+    if (!getSymbolInputs(commandLine, symbolInputs))
+        return 1;
+    int mismatches = 0;
+
+    printf("%-10s %10s %7s %7s %12s %10s %9s\n", "symbol", "rows", "blocks", "trades", "profit %", "buffer MB", "ms");
+    for (size_t s = 0; s < symbolInputs.size(); s++)
     {
-        float openPrice;
-        float totalProfitPercent = 0;
-        int numOfProfitableTrades = 0, totalTrades = 0;
+        ChunkedBacktest chunked(strategy.getParams(), blockRows);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        BacktestResult result = chunked.run(symbolInputs[s].second);
+        double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const ChunkedStats &stats = chunked.getStats();
 
-        for (int i = 0; i < dataInstance->numberOfRows; i++)
+        printf("%-10s %10lld %7d %7d %12.4f %10.1f %9.1f\n", symbolInputs[s].first.c_str(), stats.rows, stats.blocks, result.totalTrades,
+               result.totalProfitPercent, stats.bufferBytes / 1048576.0, elapsedMs);
+
+        if (verify)
         {
-            if (tradeSignals[i] == 1)
-            {
-                openPrice = dataInstance->symbolData[i].closePrice; // Record the opening price for a long position.
-            }
-            else if (tradeSignals[i] == -1)
+            std::shared_ptr<Data> data = std::make_shared<Data>(symbolInputs[s].first, symbolInputs[s].second);
+            BacktestResult expected = Backtest(&strategy, data).evaluate();
+            if (expected.totalTrades != result.totalTrades || expected.numOfProfitableTrades != result.numOfProfitableTrades ||
+                expected.totalProfitPercent != result.totalProfitPercent)
             {
-                // Calculate profit for exiting a long position.
-                float profit = Strategy::findPercentageChange(openPrice, dataInstance->symbolData[i].closePrice);
-                totalProfitPercent += profit; // Accumulate the total profit.
-                totalTrades += 1;             // Increment the total trades count.
-                if (profit > 0)
-                    numOfProfitableTrades += 1; // Increment the profitable trades count if the trade was profitable.
-            }
-            else if (tradeSignals[i] == 2)
-            {
-                openPrice = dataInstance->symbolData[i].closePrice; // Record the opening price for a short position.
-            }
-            else if (tradeSignals[i] == -2)
-            {
-                // Calculate profit for exiting a short position.
-                float profit = Strategy::findPercentageChange(dataInstance->symbolData[i].closePrice, openPrice);
-                totalProfitPercent += profit; // Accumulate the total profit.
-                totalTrades += 1;             // Increment the total trades count.
-                if (profit > 0)
-                    numOfProfitableTrades += 1; // Increment the profitable trades count if the trade was profitable.
+                printMessage("Mismatch for " + symbolInputs[s].first);
+                mismatches++;
             }
         }
-
-        // Print the evaluation results.
-        printResults(totalTrades, numOfProfitableTrades, totalProfitPercent);
     }
 
-    void runBacktest()
-    {
-        tradeSignals = strategyInstance->getTradeSignals(*dataInstance);
-        evaluateResults();
-    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("Peak RSS: %.1f MB\n", usage.ru_maxrss / 1024.0);
 
-    ~Backtest()
-    {
-        delete tradeSignals;
-        if (DEBUG)
-            printMessage("Deconstructing Backtest Object");
-    }
-};
-
-class Driver
-{
-    int NUM_OF_THREADS;
-    std::queue<std::pair<std::string, std::string>> symbolInputs;
+    if (verify)
+        printf(mismatches ? "Chunked results differ from the in-memory backtest\n" : "Chunked results identical to the in-memory backtest\n");
+    return mismatches ? 1 : 0;
+}
 
-public:
-    std::mutex queueMutex;
-    Strategy *strategyInstance;
+// Function 'runMetricsMode' backtests TrendFollowingStrategy on every symbol and prints its risk and performance
+// metrics. --equity-out also writes each symbol's equity curve (1 = starting capital) as csv.
+// Usage: main metrics [--lookback 90] [--enter 5] [--exit 5] [--target 20] [--stop 10] [--symbols Name=path,... | --universe dir|glob|manifest]
+//                     [--timeframe weekly|monthly|5m|...] [--equity-out equity.csv]
 
-    Driver()
-        : NUM_OF_THREADS(5)
+int runMetricsMode(const CommandLine &commandLine)
+{
+    TrendFollowingStrategy strategy("Trend Following Strategy", int(commandLine.getInt("lookback", 90)),
+                                    int(commandLine.getInt("enter", 5)), int(commandLine.getInt("exit", 5)),
+                                    int(commandLine.getInt("target", 20)), int(commandLine.getInt("stop", 10)));
+    TrendFollowingParams params = strategy.getParams();
+
+    Timeframe timeframe;
+    if (!getTimeframe(commandLine, timeframe))
+        return 1;
+
+    std::string equityFile = commandLine.getString("equity-out", "");
+    std::ofstream equityOut;
+    if (!equityFile.empty())
     {
+        equityOut.open(equityFile.c_str());
+        if (!equityOut)
+        {
+            printMessage("Unable to write the equity curves to " + equityFile);
+            return 1;
+        }
+        equityOut << "symbol,date,equity\n";
     }
 
-    Driver(int NUM_OF_THREADS)
-        : NUM_OF_THREADS(NUM_OF_THREADS)
-    {
-    }
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+    if (!getSymbolInputs(commandLine, symbolInputs))
+        return 1;
+    std::vector<double> equityCurve;
 
-    void setStrategyInstance(Strategy *strategyInstance)
+    printf("%-8s %6s %8s %9s %8s %7s %7s %8s %7s %7s %8s %9s %9s %8s\n", "symbol", "trades", "win %", "total %", "CAGR %", "Sharpe", "Sortino",
+           "maxDD %", "DD bars", "Calmar", "PF", "exposure%", "avg bars", "max bars");
+    for (size_t s = 0; s < symbolInputs.size(); s++)
     {
-        this->strategyInstance = strategyInstance;
+        std::shared_ptr<Data> data = Resampler::load(symbolInputs[s].first, symbolInputs[s].second, timeframe);
+        const int numberOfRows = data->numberOfRows;
+        float *kmax = ScratchArena::get<float>(ScratchArena::WINDOW_MAX, size_t(numberOfRows));
+        float *kmin = ScratchArena::get<float>(ScratchArena::WINDOW_MIN, size_t(numberOfRows));
+        TrendFollowingStrategy::getKMaxMin(*data, params.lookBackPeriod, kmax, kmin);
+
+        equityCurve.resize(size_t(numberOfRows));
+        PerformanceMetrics metrics = MetricsEngine::computeTrendFollowing(*data, params, kmax, kmin, equityOut.is_open() ? equityCurve.data() : nullptr);
+        const BacktestResult &trades = metrics.trades;
+
+        printf("%-8s %6d %8.2f %9.2f %8.2f %7.3f %7.3f %8.2f %7d %7.3f %8.3f %9.2f %9.1f %8d\n", symbolInputs[s].first.c_str(), trades.totalTrades,
+               trades.totalTrades ? 100.0 * trades.numOfProfitableTrades / trades.totalTrades : 0.0, trades.totalProfitPercent, metrics.cagrPercent,
+               metrics.sharpe, metrics.sortino, metrics.maxDrawdownPercent, metrics.maxDrawdownBars, metrics.calmar(), metrics.profitFactor,
+               metrics.exposurePercent, metrics.averageTradeBars, metrics.maxTradeBars);
+
+        if (equityOut.is_open())
+        {
+            for (int i = 0; i < numberOfRows; i++)
+                equityOut << symbolInputs[s].first << "," << CsvParser::formatDate(data->dates()[i]) << "," << equityCurve[i] << "\n";
+        }
     }
 
-    void setSymbolInputs()
-    {
-        symbolInputs.push(std::make_pair("Meta", "data/META.csv"));
-        symbolInputs.push(std::make_pair("Tesla", "data/TSLA.csv"));
-        symbolInputs.push(std::make_pair("Amazon", "data/AMZN.csv"));
-        symbolInputs.push(std::make_pair("Apple", "data/AAPL.csv"));
-        symbolInputs.push(std::make_pair("Google", "data/GOOG.csv"));
-    }
+    if (equityOut.is_open())
+        printf("Equity curves written to %s\n", equityFile.c_str());
+    return 0;
+}
+
+// Function 'addStrategyFamily' appends the strategy family the multi mode runs: a TrendFollowingStrategy with 3% and
+// 5% triggers and a ChannelBreakoutStrategy per lookback, one MomentumStrategy per lookback, and SMA and EMA
+// MovingAverageCrossStrategy pairs (20 strategies for the default 4 lookbacks).
 
-    void setSymbolInputs(std::queue<std::pair<std::string, std::string>> &symbolInputs)
+void addStrategyFamily(const std::vector<int> &lookbacks, std::vector<std::unique_ptr<Strategy>> &strategies)
+{
+    for (size_t l = 0; l < lookbacks.size(); l++)
     {
-        this->symbolInputs = symbolInputs;
+        std::string lookback = std::to_string(lookbacks[l]);
+        strategies.emplace_back(new TrendFollowingStrategy("Trend Following " + lookback + " (3%)", lookbacks[l], 3, 3, 20, 10));
+        strategies.emplace_back(new TrendFollowingStrategy("Trend Following " + lookback + " (5%)", lookbacks[l], 5, 5, 20, 10));
+        strategies.emplace_back(new ChannelBreakoutStrategy("Channel Breakout " + lookback, lookbacks[l], 14, 3));
+        strategies.emplace_back(new MomentumStrategy("Momentum " + lookback, lookbacks[l], 10));
     }
-    // Function 'processSymbol' handles the processing of a single symbol for backtesting.
-    // It creates a shared pointer to Data, initializes a Backtest instance, and runs the backtest.
-    // Finally, it deletes the Backtest instance when done.
+    strategies.emplace_back(new MovingAverageCrossStrategy("SMA Cross 10/50", 10, 50, false));
+    strategies.emplace_back(new MovingAverageCrossStrategy("SMA Cross 20/100", 20, 100, false));
+    strategies.emplace_back(new MovingAverageCrossStrategy("EMA Cross 10/50", 10, 50, true));
+    strategies.emplace_back(new MovingAverageCrossStrategy("EMA Cross 20/100", 20, 100, true));
+}
+
+// Function 'runMultiMode' backtests a family of strategies on every symbol twice: each strategy on its own, computing
+// its own indicators (getTradeSignals), and all of them through one MultiStrategyRunner sharing an IndicatorGraph.
+// It times both over --repeat runs and checks that every result is identical. --results also prints the results.
+// Usage: main multi [--lookbacks 30,60,90,120] [--repeat 20] [--results] [--symbols Name=path,... | --universe dir|glob|manifest]
+//                   [--timeframe weekly|monthly|5m|...]
 
-    static void processSymbol(const std::pair<std::string, std::string> &symbolInput, Strategy *strategyInstance)
+int runMultiMode(const CommandLine &commandLine)
+{
+    std::vector<int> lookbacks;
+    if (!getIntList(commandLine, "lookbacks", lookbacks))
+        return 1;
+    if (lookbacks.empty())
+        lookbacks = {30, 60, 90, 120};
+    std::vector<std::unique_ptr<Strategy>> ownedStrategies;
+    addStrategyFamily(lookbacks, ownedStrategies);
+    std::vector<Strategy *> strategies;
+    for (size_t s = 0; s < ownedStrategies.size(); s++)
+        strategies.push_back(ownedStrategies[s].get());
+    MultiStrategyRunner runner(strategies);
+
+    Timeframe timeframe;
+    if (!getTimeframe(commandLine, timeframe))
+        return 1;
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+    if (!getSymbolInputs(commandLine, symbolInputs))
+        return 1;
+    const int repeat = std::max(1, int(commandLine.getInt("repeat", 20)));
+
+    printf("%zu strategies per symbol, best of %d runs\n", strategies.size(), repeat);
+    printf("%-8s %8s %8s %14s %11s %8s\n", "symbol", "rows", "series", "independent ms", "shared ms", "speedup");
+    int mismatches = 0;
+    double independentTotal = 0, sharedTotal = 0;
+    for (size_t i = 0; i < symbolInputs.size(); i++)
     {
-        if (DEBUG)
-            printMessage("Thread Started For Symbol: " + symbolInput.first);
+        std::shared_ptr<const Data> data = SymbolStore::getInstance().get(symbolInputs[i].first, symbolInputs[i].second, timeframe);
+        std::vector<BacktestResult> independent(strategies.size()), shared;
+        double independentSeconds = 1e30, sharedSeconds = 1e30;
+        int numOfNodes = 0, numOfDeclarations = 0;
+
+        for (int r = 0; r < repeat; r++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t s = 0; s < strategies.size(); s++)
+            {
+                int8_t *signals = strategies[s]->getTradeSignals(*data);
+                independent[s] = Backtest::evaluateSignals(*data, signals);
+                delete[] signals;
+            }
+            auto middle = std::chrono::steady_clock::now();
+            IndicatorGraph graph(*data);
+            shared = runner.run(graph);
+            auto end = std::chrono::steady_clock::now();
+
+            independentSeconds = std::min(independentSeconds, std::chrono::duration<double>(middle - start).count());
+            sharedSeconds = std::min(sharedSeconds, std::chrono::duration<double>(end - middle).count());
+            numOfNodes = graph.getNumOfNodes();
+            numOfDeclarations = graph.getNumOfDeclarations();
+        }
+        independentTotal += independentSeconds;
+        sharedTotal += sharedSeconds;
 
-        // Create a shared pointer to Data for the symbol.
-        std::shared_ptr<Data> symbolData = std::make_shared<Data>(symbolInput.first, symbolInput.second);
+        for (size_t s = 0; s < strategies.size(); s++)
+        {
+            if (independent[s].totalTrades != shared[s].totalTrades || independent[s].numOfProfitableTrades != shared[s].numOfProfitableTrades ||
+                independent[s].totalProfitPercent != shared[s].totalProfitPercent)
+            {
+                printf("Mismatch: %s, %s\n", symbolInputs[i].first.c_str(), strategies[s]->strategyName.c_str());
+                mismatches++;
+            }
+        }
 
-        // Initialize a Backtest instance with the provided strategy and symbol data.
-        Backtest *backtestInstance = new Backtest(strategyInstance, symbolData);
+        printf("%-8s %8d %3d of %2d %14.3f %11.3f %7.2fx\n", symbolInputs[i].first.c_str(), data->numberOfRows, numOfNodes, numOfDeclarations,
+               independentSeconds * 1e3, sharedSeconds * 1e3, independentSeconds / sharedSeconds);
+        if (commandLine.has("results"))
+        {
+            for (size_t s = 0; s < strategies.size(); s++)
+                printf("  %-28s %4d trades, %4d profitable, %9.2f%% total profit\n", strategies[s]->strategyName.c_str(), shared[s].totalTrades,
+                       shared[s].numOfProfitableTrades, shared[s].totalProfitPercent);
+        }
+    }
 
-        // Run the backtest.
-        backtestInstance->runBacktest();
+    printf("Total: %.3f ms independent, %.3f ms shared (%.2fx)\n", independentTotal * 1e3, sharedTotal * 1e3,
+           sharedTotal > 0 ? independentTotal / sharedTotal : 0.0);
+    printf(mismatches ? "Shared-indicator results differ from independent runs\n" : "Shared-indicator results identical to independent runs\n");
+    return mismatches ? 1 : 0;
+}
 
-        if (DEBUG)
-            printMessage("Thread Completed For Symbol: " + symbolInput.first);
+// Function 'getFormatFromExtension' maps an output file name to a results format name ("text" when unknown).
 
-        // Delete the Backtest instance to free up resources.
-        delete backtestInstance;
-    }
+std::string getFormatFromExtension(const std::string &fileName)
+{
+    std::string extension = fileName.substr(fileName.rfind('.') == std::string::npos ? fileName.size() : fileName.rfind('.'));
+    if (extension == ".csv")
+        return "csv";
+    if (extension == ".jsonl" || extension == ".json")
+        return "jsonl";
+    if (extension == ".bin")
+        return "binary";
+    return "text";
+}
 
-    // Function 'runThreadTask' is a thread task function that processes symbols from a queue.
-    // It continuously dequeues symbol inputs, processes them using 'processSymbol', and repeats until the queue is empty.
+// Function 'runDefaultMode' runs the original backtest of the bundled symbols through the Driver.
 
-    static void runThreadTask(Driver *driverInstance)
+int runDefaultMode(const CommandLine &commandLine)
+{
+    std::unique_ptr<Driver> driverInstance(new Driver(int(commandLine.getInt("threads", 0))));
+    std::unique_ptr<Strategy> strategyInstance(new DefaultTrendFollowingStrategy("Trend Following Strategy"));
+
+    // --out file writes the results there instead of stdout; --format text|csv|jsonl|binary defaults to the
+    // file's extension. The csv format writes the per-trade list next to it as <name>.trades.csv.
+    std::unique_ptr<std::ofstream> resultsFile, tradesFile;
+    std::unique_ptr<ResultsSink> resultsSink;
+    if (commandLine.has("out") || commandLine.has("format"))
     {
-        while (driverInstance->symbolInputs.size())
+        std::string outFile = commandLine.getString("out", "");
+        ResultsFormat format = RESULTS_TEXT;
+        if (!ResultsSink::parseFormat(commandLine.getString("format", getFormatFromExtension(outFile)), format))
         {
-            driverInstance->queueMutex.lock();
-
-            if (driverInstance->symbolInputs.size())
-            {
-                // Dequeue a symbol input and unlock the mutex.
-                std::pair<std::string, std::string> symbolInput = driverInstance->symbolInputs.front();
-                driverInstance->symbolInputs.pop();
-                driverInstance->queueMutex.unlock();
+            printMessage("Unknown --format '" + commandLine.getString("format", "") + "'. Available formats: text, csv, jsonl, binary");
+            return 1;
+        }
 
-                // Process the symbol using 'processSymbol'.
-                processSymbol(symbolInput, driverInstance->strategyInstance);
-            }
-            else
+        std::ostream *out = &std::cout;
+        if (!outFile.empty())
+        {
+            resultsFile.reset(new std::ofstream(outFile.c_str(), std::ios::binary));
+            if (!*resultsFile)
             {
-                driverInstance->queueMutex.unlock();
+                printMessage("Unable to write results to " + outFile);
+                return 1;
             }
+            out = resultsFile.get();
+
+            if (format == RESULTS_CSV)
+                tradesFile.reset(new std::ofstream((outFile.substr(0, outFile.rfind('.')) + ".trades.csv").c_str()));
         }
-    }
 
-    // Function 'runBacktest' initiates and manages parallel backtesting using multiple threads.
-    // It creates an array of shared pointers to threads, each running the 'runThreadTask' function.
-    // The function then waits for all threads to complete using 'join' before returning.
+        resultsSink.reset(new ResultsSink(*out, format, tradesFile.get()));
+        driverInstance->setResultsSink(resultsSink.get());
+    }
 
-    void runBacktest()
+    // --fill intrabar fills targets and stops at the bar's open/high/low; --slippage and --commission add costs.
+    ExecutionSettings execution;
+    if (!setExecutionSettings(commandLine, execution))
+        return 1;
+    driverInstance->setExecution(execution);
+
+    // --timeframe weekly|monthly|5m|... resamples every csv file before the backtest (cached per symbol and timeframe).
+    Timeframe timeframe;
+    if (!getTimeframe(commandLine, timeframe))
+        return 1;
+    driverInstance->setTimeframe(timeframe);
+
+    // --lookbacks 30,60,... also runs one TrendFollowingStrategy per lookback; every strategy shares the loaded
+    // symbols through the SymbolStore, whose memory use --store-budget-mb bounds.
+    std::vector<std::unique_ptr<Strategy>> extraStrategies;
+    std::vector<int> lookbacks;
+    if (!getIntList(commandLine, "lookbacks", lookbacks))
+        return 1;
+    for (size_t l = 0; l < lookbacks.size(); l++)
+        extraStrategies.emplace_back(new TrendFollowingStrategy("Trend Following Strategy (lookback " + std::to_string(lookbacks[l]) + ")",
+                                                                lookbacks[l], 5, 5, 20, 10));
+    SymbolStore::getInstance().setMemoryBudget(size_t(commandLine.getInt("store-budget-mb", 0)) << 20);
+
+    // --universe dir|glob|manifest picks the symbols; --io-threads N loads them on N threads of their own, so
+    // reading and parsing overlaps with the backtests on the worker pool.
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+    if (!getSymbolInputs(commandLine, symbolInputs))
+        return 1;
+    driverInstance->setSymbolInputs(symbolInputs);
+    driverInstance->setNumOfIoThreads(int(commandLine.getInt("io-threads", 0)));
+    driverInstance->setStrategyInstance(strategyInstance.get());
+    for (size_t s = 0; s < extraStrategies.size(); s++)
+        driverInstance->addStrategyInstance(extraStrategies[s].get());
+    // --share-indicators runs all strategies of a symbol as one task sharing their indicator series.
+    if (commandLine.has("share-indicators") && !execution.isCloseOnly())
     {
-        std::shared_ptr<std::thread> threadsArray[NUM_OF_THREADS];
+        printMessage("--share-indicators evaluates close fills and cannot be combined with --fill intrabar, --slippage or --commission");
+        return 1;
+    }
+    driverInstance->setShareIndicators(commandLine.has("share-indicators"));
+    driverInstance->runBacktest();
 
-        // Create and start multiple threads, each running 'runThreadTask'.
-        for (int i = 0; i < NUM_OF_THREADS; i++)
-        {
-            std::shared_ptr<std::thread> threadInstance = std::make_shared<std::thread>(Driver::runThreadTask, this);
-            threadsArray[i] = threadInstance;
-        }
+    if (resultsSink)
+    {
+        resultsSink->close();
+        if (resultsFile)
+            std::cout << resultsSink->getRecordsWritten() << " results (" << resultsSink->getTradesWritten() << " trades) written to "
+                      << commandLine.getString("out", "") << std::endl;
+    }
 
-        // Wait for all threads to complete.
-        for (int i = 0; i < NUM_OF_THREADS; i++)
-        {
-            threadsArray[i]->join();
-        }
+    // --stats prints how busy each worker of the thread pool was and how the symbol store was used.
+    if (commandLine.has("stats"))
+    {
+        WorkStealingPool::printStats(driverInstance->getWorkerStats());
+        SymbolStore::getInstance().printStats();
+        SymbolUniverse::printReport(driverInstance->getLoadReports());
     }
 
-    ~Driver()
+    return 0;
+}
+
+// Function 'runMode' dispatches to the mode named by the first command line argument.
+
+int runMode(const CommandLine &commandLine)
+{
+    if (commandLine.mode == "sweep")
+        return runSweepMode(commandLine);
+    if (commandLine.mode == "replay")
+        return runReplayMode(commandLine);
+    if (commandLine.mode == "portfolio")
+        return runPortfolioMode(commandLine);
+    if (commandLine.mode == "walk-forward")
+        return runWalkForwardMode(commandLine);
+    if (commandLine.mode == "verify-batch")
+        return runVerifyBatchMode(commandLine);
+    if (commandLine.mode == "chunked")
+        return runChunkedMode(commandLine);
+    if (commandLine.mode == "metrics")
+        return runMetricsMode(commandLine);
+    if (commandLine.mode == "shard")
+        return runShardMode(commandLine);
+    if (commandLine.mode == "multi")
+        return runMultiMode(commandLine);
+
+    if (!commandLine.mode.empty())
     {
-        if (DEBUG)
-            printMessage("Deconstructing Driver Object");
+        printMessage("Unknown mode '" + commandLine.mode + "'. Available modes: sweep, replay, portfolio, walk-forward, verify-batch, chunked, metrics, shard, multi");
+        return 1;
     }
-};
 
-int main()
+    return runDefaultMode(commandLine);
+}
+
+int main(int argc, char **argv)
 {
-    Driver *driverInstance = new Driver();
-    Strategy *strategyInstance = new TrendFollowingStrategy("Trend Following Strategy");
+    CommandLine commandLine(argc, argv);
 
-    driverInstance->setSymbolInputs();
-    driverInstance->setStrategyInstance(strategyInstance);
-    driverInstance->runBacktest();
+    // Parsed csv files are cached as binary columns under --cache-dir (default .tfcache); --no-cache always parses.
+    ColumnCache::setEnabled(!commandLine.has("no-cache"));
+    ColumnCache::setDirectory(commandLine.getString("cache-dir", ColumnCache::getDirectory()));
 
-    delete driverInstance;
-    delete strategyInstance;
+    // --profile prints per-stage timings and counters after the run; --trace file.json also writes a Chrome trace.
+    Instrumentation::setEnabled(commandLine.has("profile"));
+    Instrumentation::setTracing(commandLine.has("trace"));
 
-    return 0;
-}
\ No newline at end of file
+    int status = runMode(commandLine);
+
+    if (commandLine.has("profile") || commandLine.has("trace"))
+    {
+        if (!TF_INSTRUMENTATION)
+            printMessage("Instrumentation was compiled out (TF_INSTRUMENTATION=0)");
+        Instrumentation::printSummary(std::cout);
+    }
+    if (commandLine.has("trace"))
+    {
+        std::string traceFile = commandLine.getString("trace", "trace.json");
+        if (traceFile == "true")
+            traceFile = "trace.json";
+        if (!Instrumentation::writeTrace(traceFile))
+            printMessage("Unable to write the trace to " + traceFile);
+        else
+            std::cout << "Trace written to " << traceFile << std::endl;
+    }
+
+    return status;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "common.h"
+#include "data.h"
+#include "instrumentation.h"
+#include "strategy.h"
+
+// Define a C++ struct named 'BacktestResult' to store the outcome of evaluating one set of trade signals.
+struct BacktestResult
+{
+    int totalTrades;           // Stores the number of closed trades.
+    int numOfProfitableTrades; // Stores the number of closed trades with a positive return.
+    float totalProfitPercent;  // Stores the sum of the percentage returns of all closed trades.
+
+    BacktestResult()
+        : totalTrades(0), numOfProfitableTrades(0), totalProfitPercent(0)
+    {
+    }
+
+    // Member function to return the average percentage return per trade (0 when no trade was taken).
+    float averageProfitPercent() const
+    {
+        return totalTrades ? totalProfitPercent / float(totalTrades) : 0;
+    }
+};
+
+// Define a C++ struct named 'TradeRecord' to store one closed trade.
+struct TradeRecord
+{
+    int64_t entryDate;   // Stores the date of the entry bar (seconds since the Unix epoch).
+    int64_t exitDate;    // Stores the date of the exit bar.
+    float entryPrice;    // Stores the closing price of the entry bar.
+    float exitPrice;     // Stores the closing price of the exit bar.
+    float profitPercent; // Stores the percentage return of the trade.
+    int8_t side;         // Stores 1 for a long trade and -1 for a short trade.
+};
+
+class Backtest
+{
+    Strategy *strategyInstance;
+    std::shared_ptr<const Data> dataInstance;
+    int8_t *tradeSignals;
+
+public:
+    Backtest(Strategy *strategyInstance, std::shared_ptr<const Data> dataInstance)
+        : strategyInstance(strategyInstance), dataInstance(dataInstance), tradeSignals(nullptr)
+    {
+    }
+
+    void printResults(const int &totalTrades, const int &numOfProfitableTrades, const float &totalProfitPercent)
+    {
+        stdOutMutex.lock();
+        std::cout << "\n*************************************************************\n";
+        std::cout << "Symbol: " << dataInstance->symbolName << std::endl;
+        std::cout << "Strategy: " << strategyInstance->strategyName << std::endl;
+        std::cout << "Total Trades Taken: " << totalTrades << std::endl;
+        std::cout << "Number Of Profitable Trades: " << numOfProfitableTrades << std::endl;
+        std::cout << "Total Profit Percentage: " << totalProfitPercent << std::endl;
+        std::cout << "Average Profit Percentage Per Trade: " << (totalTrades ? float(totalProfitPercent) / float(totalTrades) : 0) << std::endl;
+        std::cout << "*************************************************************\n";
+        stdOutMutex.unlock();
+    }
+
+    // Function 'evaluateSignals' walks a signal array and computes the trade statistics for it.
+    // It computes total profit percentage, the number of profitable trades, and total trades.
+    // It is static so that callers holding only a Data object and signals (e.g. a parameter sweep) can reuse it.
+    // When 'trades' is given, every closed trade is also appended to it.
+
+    static BacktestResult evaluateSignals(const Data &data, const int8_t *tradeSignals, std::vector<TradeRecord> *trades = nullptr)
+    {
+        TF_PROFILE_SCOPE(EVALUATE);
+
+        float openPrice;
+        int openIndex = 0;
+        BacktestResult result;
+        const float *closePrices = data.closePrices().data(); // Read the close column directly.
+
+        for (int i = 0; i < data.numberOfRows; i++)
+        {
+            if (tradeSignals[i] == 1)
+            {
+                openPrice = closePrices[i]; // Record the opening price for a long position.
+                openIndex = i;
+            }
+            else if (tradeSignals[i] == -1)
+            {
+                // Calculate profit for exiting a long position.
+                float profit = Strategy::findPercentageChange(openPrice, closePrices[i]);
+                result.totalProfitPercent += profit; // Accumulate the total profit.
+                result.totalTrades += 1;             // Increment the total trades count.
+                if (profit > 0)
+                    result.numOfProfitableTrades += 1; // Increment the profitable trades count if the trade was profitable.
+                if (trades)
+                    trades->push_back(makeTrade(data, openIndex, i, openPrice, profit, 1));
+            }
+            else if (tradeSignals[i] == 2)
+            {
+                openPrice = closePrices[i]; // Record the opening price for a short position.
+                openIndex = i;
+            }
+            else if (tradeSignals[i] == -2)
+            {
+                // Calculate profit for exiting a short position.
+                float profit = Strategy::findPercentageChange(closePrices[i], openPrice);
+                result.totalProfitPercent += profit; // Accumulate the total profit.
+                result.totalTrades += 1;             // Increment the total trades count.
+                if (profit > 0)
+                    result.numOfProfitableTrades += 1; // Increment the profitable trades count if the trade was profitable.
+                if (trades)
+                    trades->push_back(makeTrade(data, openIndex, i, openPrice, profit, -1));
+            }
+        }
+
+        return result;
+    }
+
+    // Static function to build the TradeRecord of a trade opened at bar 'openIndex' and closed at bar 'closeIndex'.
+    static TradeRecord makeTrade(const Data &data, int openIndex, int closeIndex, float openPrice, float profit, int8_t side)
+    {
+        TradeRecord trade;
+        trade.entryDate = data.dates()[openIndex];
+        trade.exitDate = data.dates()[closeIndex];
+        trade.entryPrice = openPrice;
+        trade.exitPrice = data.closePrices()[closeIndex];
+        trade.profitPercent = profit;
+        trade.side = side;
+        return trade;
+    }
+
+    // Function 'evaluate' runs the strategy and returns the trade statistics without printing them.
+    // When 'trades' is given, every closed trade is also appended to it.
+
+    BacktestResult evaluate(std::vector<TradeRecord> *trades = nullptr)
+    {
+        delete[] tradeSignals;
+        tradeSignals = strategyInstance->getTradeSignals(*dataInstance);
+        return evaluateSignals(*dataInstance, tradeSignals, trades);
+    }
+
+    // Function 'evaluateResults' calculates and prints trading strategy evaluation results.
+
+    void evaluateResults()
+    {
+        BacktestResult result = evaluateSignals(*dataInstance, tradeSignals);
+
+        // Print the evaluation results.
+        printResults(result.totalTrades, result.numOfProfitableTrades, result.totalProfitPercent);
+    }
+
+    void runBacktest()
+    {
+        tradeSignals = strategyInstance->getTradeSignals(*dataInstance);
+        evaluateResults();
+    }
+
+    ~Backtest()
+    {
+        delete[] tradeSignals;
+        if (DEBUG)
+            printMessage("Deconstructing Backtest Object");
+    }
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "backtest.h"
+#include "data.h"
+#include "strategy.h"
+
+// Define a C++ struct named 'ThresholdSet' to store the four percentage thresholds of one TrendFollowingStrategy
+// parameter set (its LOOKBACK_PERIOD is shared by the whole batch through the K-maximum/K-minimum windows).
+struct ThresholdSet
+{
+    int enterTrigger;
+    int exitTrigger;
+    int targetPercentage;
+    int stopLoss;
+};
+
+// Define a C++ struct named 'NativeLanes' holding the GCC vector types of one hardware SIMD register:
+// 4 floats/ints with SSE2 (the default x86-64 target) and 8 with -mavx. Wider GCC vectors than the target
+// supports are lowered element by element around blends, which measured ~6x slower than the scalar code,
+// so batches are built from several native registers instead.
+struct NativeLanes
+{
+#ifdef __AVX__
+    typedef float FloatLanes __attribute__((vector_size(32)));
+    typedef int32_t IntLanes __attribute__((vector_size(32)));
+#else
+    typedef float FloatLanes __attribute__((vector_size(16)));
+    typedef int32_t IntLanes __attribute__((vector_size(16)));
+#endif
+    static const int WIDTH = int(sizeof(FloatLanes) / sizeof(float));
+};
+
+// Define a C++ class named 'BatchSignals' that runs the TrendFollowingStrategy state machine and the Backtest
+// evaluation of up to LANES parameter sets in lockstep, one SIMD lane per parameter set.
+// All lanes share a LOOKBACK_PERIOD, so the K-maximum/K-minimum percentage changes of a bar are computed once
+// (as scalars) and only the per-lane trade state is vectorized. The branches of getNextSignal become masks:
+// every lane evaluates every transition and a blend keeps the one its state selects. Signals are never stored;
+// each exit adds its trade straight into the lane's BacktestResult.
+// Every float operation (including the int truncation of percentage changes and of the trade price) is the
+// same IEEE operation as the scalar code, so each lane's result is bitwise identical to getTradeSignals followed
+// by Backtest::evaluateSignals. 'evaluateScalar' is the lane-by-lane reference used to check that.
+template <int LANES>
+class BatchSignals
+{
+    typedef NativeLanes::FloatLanes FloatLanes;
+    typedef NativeLanes::IntLanes IntLanes;
+    static const int GROUPS = LANES / NativeLanes::WIDTH; // Stores the number of registers per batch.
+
+    static FloatLanes toFloat(IntLanes values)
+    {
+        return __builtin_convertvector(values, FloatLanes);
+    }
+
+    // Static function matching Strategy::findPercentageChange in every lane.
+    static FloatLanes findPercentageChange(FloatLanes startValue, FloatLanes endValue)
+    {
+        return ((endValue - startValue) * 100.0f) / startValue;
+    }
+
+public:
+    static_assert(LANES > 0 && LANES % NativeLanes::WIDTH == 0, "LANES must be a multiple of the SIMD register width");
+
+    static const int NUM_OF_LANES = LANES;
+
+    // Static function to backtest 'count' (1..LANES) threshold sets over one symbol in a single pass.
+    // 'kmax' and 'kmin' are the windows of the batch's shared LOOKBACK_PERIOD; results[0..count) receive the output.
+    static void evaluate(const Data &data, const float *kmax, const float *kmin, const ThresholdSet *sets, int count, BacktestResult *results)
+    {
+        count = std::max(0, std::min(count, LANES));
+        if (count == 0)
+            return;
+
+        IntLanes enterTrigger[GROUPS], exitTrigger[GROUPS];
+        FloatLanes targetPercentage[GROUPS], stopLoss[GROUPS];
+        IntLanes state[GROUPS];      // Stores the TradeState of every lane.
+        IntLanes tradePrice[GROUPS]; // Stores the (int truncated) entry price used by the exit rules.
+        FloatLanes openPrice[GROUPS]; // Stores the float entry price used by the evaluation.
+        FloatLanes totalProfitPercent[GROUPS];
+        IntLanes totalTrades[GROUPS], numOfProfitableTrades[GROUPS];
+
+        const IntLanes zero = IntLanes() + 0;
+        for (int g = 0; g < GROUPS; g++)
+        {
+            // Unused lanes repeat the last parameter set; their results are simply not written back.
+            for (int l = 0; l < NativeLanes::WIDTH; l++)
+            {
+                const ThresholdSet &set = sets[std::min(g * NativeLanes::WIDTH + l, count - 1)];
+                enterTrigger[g][l] = set.enterTrigger;
+                exitTrigger[g][l] = set.exitTrigger;
+                targetPercentage[g][l] = float(set.targetPercentage); // The scalar code compares a float with these ints.
+                stopLoss[g][l] = float(set.stopLoss);
+            }
+
+            state[g] = tradePrice[g] = totalTrades[g] = numOfProfitableTrades[g] = zero;
+            openPrice[g] = totalProfitPercent[g] = FloatLanes() + 0.0f;
+        }
+
+        const float *closePrices = data.closePrices().data();
+        for (int i = 0; i < data.numberOfRows; i++)
+        {
+            const float closePrice = closePrices[i];
+
+            // The window changes do not depend on the lane.
+            int maxPercentIncrease = Strategy::findPercentageChange(kmin[i], closePrice);
+            int maxPercentDecrease = -1 * Strategy::findPercentageChange(kmax[i], closePrice);
+            const FloatLanes close = FloatLanes() + closePrice;
+            const IntLanes closeTruncated = IntLanes() + int(closePrice);
+
+            for (int g = 0; g < GROUPS; g++)
+            {
+                FloatLanes tradeChange = findPercentageChange(toFloat(tradePrice[g]), close);
+
+                IntLanes noPosition = state[g] == 0;
+                IntLanes enterLong = noPosition & (maxPercentIncrease >= enterTrigger[g]);
+                IntLanes enterShort = noPosition & ~enterLong & (maxPercentDecrease >= enterTrigger[g]);
+                IntLanes exitLong = (state[g] == int(TrendFollowingStrategy::LONG_POSITION)) &
+                                    ((tradeChange >= targetPercentage[g]) | (maxPercentDecrease >= exitTrigger[g]) | (-1.0f * tradeChange >= stopLoss[g]));
+                IntLanes exitShort = (state[g] == int(TrendFollowingStrategy::SHORT_POSITION)) &
+                                     ((-1.0f * tradeChange >= targetPercentage[g]) | (maxPercentIncrease >= exitTrigger[g]) | (tradeChange >= stopLoss[g]));
+                IntLanes enter = enterLong | enterShort;
+                IntLanes exit = exitLong | exitShort;
+
+                // Masked state transitions: LONG_POSITION is 1 and SHORT_POSITION is -1, so a lane's new state is
+                // -enterLong + enterShort when it enters, 0 when it exits and unchanged otherwise.
+                state[g] = enter ? enterShort - enterLong : (exit ? zero : state[g]);
+                tradePrice[g] = enter ? closeTruncated : tradePrice[g];
+
+                // Fused Backtest::evaluateSignals: a long gains close/open, a short gains open/close.
+                openPrice[g] = enter ? close : openPrice[g];
+                FloatLanes profit = exitLong ? findPercentageChange(openPrice[g], close) : findPercentageChange(close, openPrice[g]);
+                totalProfitPercent[g] = exit ? totalProfitPercent[g] + profit : totalProfitPercent[g];
+                totalTrades[g] -= exit; // Masks are -1 in active lanes.
+                numOfProfitableTrades[g] -= exit & (profit > 0.0f);
+            }
+        }
+
+        for (int lane = 0; lane < count; lane++)
+        {
+            int g = lane / NativeLanes::WIDTH, l = lane % NativeLanes::WIDTH;
+            results[lane].totalTrades = totalTrades[g][l];
+            results[lane].numOfProfitableTrades = numOfProfitableTrades[g][l];
+            results[lane].totalProfitPercent = totalProfitPercent[g][l];
+        }
+    }
+
+    // Static function with the same contract as 'evaluate' that runs one parameter set at a time through
+    // TrendFollowingStrategy::getNextSignal and the scalar Backtest accounting (the reference for 'evaluate').
+    static void evaluateScalar(const Data &data, const float *kmax, const float *kmin, const ThresholdSet *sets, int count, BacktestResult *results)
+    {
+        const float *closePrices = data.closePrices().data();
+
+        for (int lane = 0; lane < std::min(count, LANES); lane++)
+        {
+            TrendFollowingStrategy::TradeState state = TrendFollowingStrategy::NO_POSITION;
+            int tradePrice = 0;
+            float openPrice = 0;
+            BacktestResult result;
+
+            for (int i = 0; i < data.numberOfRows; i++)
+            {
+                int8_t signal = TrendFollowingStrategy::getNextSignal(state, tradePrice, closePrices[i], kmax[i], kmin[i],
+                                                                      sets[lane].enterTrigger, sets[lane].exitTrigger,
+                                                                      sets[lane].targetPercentage, sets[lane].stopLoss);
+                if (signal == 1 || signal == 2)
+                {
+                    openPrice = closePrices[i];
+                }
+                else if (signal == -1 || signal == -2)
+                {
+                    float profit = signal == -1 ? Strategy::findPercentageChange(openPrice, closePrices[i])
+                                                : Strategy::findPercentageChange(closePrices[i], openPrice);
+                    result.totalProfitPercent += profit;
+                    result.totalTrades += 1;
+                    if (profit > 0)
+                        result.numOfProfitableTrades += 1;
+                }
+            }
+
+            results[lane] = result;
+        }
+    }
+};
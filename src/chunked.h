@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "backtest.h"
+#include "columns.h"
+#include "csv_parser.h"
+#include "instrumentation.h"
+#include "rolling_window.h"
+#include "strategy.h"
+
+// Define a C++ class named 'CsvBlockReader' that reads a csv file sequentially into fixed-size blocks of rows.
+// The file is read through one reusable byte buffer (never mapped or loaded whole), and each block starts with
+// the last 'overlapRows' rows of the previous block so rolling windows can be computed on the block alone.
+class CsvBlockReader
+{
+    int fd;                   // Stores the file descriptor (-1 when the file could not be opened).
+    std::vector<char> buffer; // Stores the bytes read but not parsed yet.
+    size_t bufferBegin;       // Stores the offset of the first unparsed byte in 'buffer'.
+    size_t bufferEnd;         // Stores the offset one past the last byte read into 'buffer'.
+    bool endOfFile;           // Stores whether the whole file has been read.
+    int blockRows;            // Stores the number of new rows per block.
+    int overlapRows;          // Stores the number of rows carried from one block to the next.
+    int skippedRows;          // Stores the number of malformed rows skipped so far.
+
+    CsvBlockReader(const CsvBlockReader &) = delete;
+    CsvBlockReader &operator=(const CsvBlockReader &) = delete;
+
+    // Member function to move the unparsed bytes to the front of the buffer and read more after them.
+    // The buffer doubles when a single line does not fit in it.
+    void refill()
+    {
+        if (bufferBegin == 0 && bufferEnd == buffer.size())
+            buffer.resize(buffer.size() * 2);
+
+        memmove(buffer.data(), buffer.data() + bufferBegin, bufferEnd - bufferBegin);
+        bufferEnd -= bufferBegin;
+        bufferBegin = 0;
+
+        ssize_t bytes = read(fd, buffer.data() + bufferEnd, buffer.size() - bufferEnd);
+        if (bytes <= 0)
+            endOfFile = true;
+        else
+            bufferEnd += size_t(bytes);
+    }
+
+    // Member function to parse the next valid row of the file into 'row'. Returns false at the end of the file.
+    bool readRow(CsvRow &row)
+    {
+        while (true)
+        {
+            const char *begin = buffer.data() + bufferBegin;
+            const char *end = buffer.data() + bufferEnd;
+            const char *newline = static_cast<const char *>(memchr(begin, '\n', size_t(end - begin)));
+
+            if (!newline && !endOfFile)
+            {
+                refill();
+                continue;
+            }
+            if (begin == end)
+                return false;
+
+            const char *contentEnd = newline ? newline : end;
+            bufferBegin = size_t((newline ? newline + 1 : end) - buffer.data());
+
+            if (CsvParser::parseRow(begin, contentEnd, row))
+                return true;
+            if (!CsvParser::isHeaderOrBlank(begin, contentEnd))
+                skippedRows++; // Count malformed rows instead of aborting the load, as Data::parseData does.
+        }
+    }
+
+public:
+    CsvBlockReader(const std::string &fileName, int blockRows, int overlapRows, size_t bufferBytes = size_t(1) << 20)
+        : fd(open(fileName.c_str(), O_RDONLY)), buffer(std::max<size_t>(bufferBytes, 4096)), bufferBegin(0), bufferEnd(0),
+          endOfFile(false), blockRows(std::max(1, blockRows)), overlapRows(std::max(0, overlapRows)), skippedRows(0)
+    {
+        if (fd < 0)
+            endOfFile = true;
+        else
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL); // The reader makes a single forward pass.
+    }
+
+    bool isOpen() const { return fd >= 0; }
+    int getSkippedRows() const { return skippedRows; }
+
+    // Function 'readBlock' fills 'block' with up to 'overlapRows' rows copied from the end of 'previous'
+    // followed by up to 'blockRows' new rows, and sets 'overlap' to the number of copied rows.
+    // The columns of 'block' keep their capacity between calls. Returns false when no new row was left.
+
+    bool readBlock(const DataColumns *previous, DataColumns &block, int &overlap)
+    {
+        overlap = previous ? int(std::min(previous->size(), size_t(overlapRows))) : 0;
+
+        // Grow the columns up to the block size as rows arrive, so short files never touch a full block.
+        const size_t limit = size_t(overlap) + size_t(blockRows);
+        block.resize(std::min(limit, std::max(block.date.capacity(), size_t(overlap) + 4096)));
+
+        if (overlap)
+        {
+            size_t from = previous->size() - size_t(overlap);
+            std::copy(previous->date.begin() + from, previous->date.end(), block.date.begin());
+            std::copy(previous->openPrice.begin() + from, previous->openPrice.end(), block.openPrice.begin());
+            std::copy(previous->highPrice.begin() + from, previous->highPrice.end(), block.highPrice.begin());
+            std::copy(previous->lowPrice.begin() + from, previous->lowPrice.end(), block.lowPrice.begin());
+            std::copy(previous->closePrice.begin() + from, previous->closePrice.end(), block.closePrice.begin());
+            std::copy(previous->adjClosePrice.begin() + from, previous->adjClosePrice.end(), block.adjClosePrice.begin());
+            std::copy(previous->volume.begin() + from, previous->volume.end(), block.volume.begin());
+        }
+
+        size_t rows = size_t(overlap);
+        CsvRow row;
+        while (rows < limit && readRow(row))
+        {
+            if (rows == block.date.size())
+                block.resize(std::min(limit, rows * 2));
+            block.set(rows++, row);
+        }
+
+        block.resize(rows);
+        return rows > size_t(overlap);
+    }
+
+    ~CsvBlockReader()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+};
+
+// Define a C++ struct named 'ChunkedStats' to report what a chunked run did.
+struct ChunkedStats
+{
+    long long rows;      // Stores the number of rows processed.
+    int blocks;          // Stores the number of blocks processed.
+    int skippedRows;     // Stores the number of malformed rows skipped.
+    size_t bufferBytes;  // Stores the bytes held by the block buffers and scratch arrays at their largest.
+
+    ChunkedStats()
+        : rows(0), blocks(0), skippedRows(0), bufferBytes(0)
+    {
+    }
+};
+
+// Define a C++ class named 'ChunkedBacktest' that runs TrendFollowingStrategy on a csv file block by block,
+// for series larger than memory. Blocks of 'blockRows' rows carry LOOKBACK_PERIOD - 1 rows of overlap, so the
+// rolling max/min of every new row are computed exactly; the trade state and the open trade carry across block
+// boundaries. While one block is computed the next one is read and parsed on another thread (double buffering).
+// Memory is bounded by the block size whatever the file length, and the result equals the in-memory
+// TrendFollowingStrategy + Backtest::evaluateSignals path bit for bit.
+class ChunkedBacktest
+{
+    TrendFollowingParams params;
+    int blockRows;
+    ChunkedStats stats;
+
+public:
+    ChunkedBacktest(const TrendFollowingParams &params, int blockRows = 1 << 18)
+        : params(params), blockRows(std::max(1, blockRows))
+    {
+    }
+
+    const ChunkedStats &getStats() const
+    {
+        return stats;
+    }
+
+    // Function 'run' backtests the csv file 'fileName'. When 'trades' is given, every closed trade is appended to it.
+
+    BacktestResult run(const std::string &fileName, std::vector<TradeRecord> *trades = nullptr)
+    {
+        const int overlapRows = std::max(0, params.lookBackPeriod - 1);
+        CsvBlockReader reader(fileName, blockRows, overlapRows);
+        DataColumns blocks[2];
+        int overlaps[2] = {0, 0};
+
+        stats = ChunkedStats();
+        BacktestResult result;
+        TrendFollowingStrategy::TradeState state = TrendFollowingStrategy::NO_POSITION;
+        int tradePrice = 0;
+        float openPrice = 0;
+        int64_t openDate = 0;
+
+        // Prefetch the first block, then always keep the read of the next block in flight while computing.
+        int current = 0;
+        std::future<bool> nextBlock = std::async(std::launch::async, [&reader, &blocks, &overlaps]()
+                                                 { return reader.readBlock(nullptr, blocks[0], overlaps[0]); });
+
+        while (nextBlock.get())
+        {
+            const DataColumns &block = blocks[current];
+            const int overlap = overlaps[current];
+            const int next = 1 - current;
+            nextBlock = std::async(std::launch::async, [&reader, &blocks, &overlaps, current, next]()
+                                   { return reader.readBlock(&blocks[current], blocks[next], overlaps[next]); });
+
+            TF_PROFILE_SCOPE(EVALUATE);
+            const int numberOfRows = int(block.size());
+            const float *closePrices = block.closePrice.data();
+            float *kmax = ScratchArena::get<float>(ScratchArena::WINDOW_MAX, size_t(numberOfRows));
+            float *kmin = ScratchArena::get<float>(ScratchArena::WINDOW_MIN, size_t(numberOfRows));
+            RollingWindow::compute(closePrices, numberOfRows, params.lookBackPeriod, kmax, kmin);
+
+            // Only the new rows are evaluated; the overlap rows were evaluated with the previous block.
+            for (int i = overlap; i < numberOfRows; i++)
+            {
+                int8_t signal = TrendFollowingStrategy::getNextSignal(state, tradePrice, closePrices[i], kmax[i], kmin[i], params.enterTrigger,
+                                                                      params.exitTrigger, params.targetPercentage, params.stopLoss);
+                if (signal == 1 || signal == 2)
+                {
+                    openPrice = closePrices[i];
+                    openDate = block.date[i];
+                }
+                else if (signal == -1 || signal == -2)
+                {
+                    // Same accounting as Backtest::evaluateSignals.
+                    float profit = signal == -1 ? Strategy::findPercentageChange(openPrice, closePrices[i])
+                                                : Strategy::findPercentageChange(closePrices[i], openPrice);
+                    result.totalProfitPercent += profit;
+                    result.totalTrades += 1;
+                    if (profit > 0)
+                        result.numOfProfitableTrades += 1;
+                    if (trades)
+                    {
+                        TradeRecord trade;
+                        trade.entryDate = openDate;
+                        trade.exitDate = block.date[i];
+                        trade.entryPrice = openPrice;
+                        trade.exitPrice = closePrices[i];
+                        trade.profitPercent = profit;
+                        trade.side = signal == -1 ? 1 : -1;
+                        trades->push_back(trade);
+                    }
+                }
+            }
+
+            stats.rows += numberOfRows - overlap;
+            stats.blocks++;
+            size_t blockBytes = block.date.capacity() * (sizeof(int64_t) + 5 * sizeof(float) + sizeof(long long int));
+            stats.bufferBytes = std::max(stats.bufferBytes, 2 * blockBytes + 2 * size_t(numberOfRows) * sizeof(float));
+            current = next;
+        }
+
+        stats.skippedRows = reader.getSkippedRows();
+        return result;
+    }
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Define a C++ class named 'CommandLine' to parse "main <mode> --option value ..." style arguments.
+class CommandLine
+{
+    std::map<std::string, std::string> options; // Stores option values keyed by name (without leading dashes).
+
+public:
+    std::string mode; // Stores the first positional argument (empty when running the default backtest).
+
+    CommandLine(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+
+            if (arg.compare(0, 2, "--") == 0)
+            {
+                std::string key = arg.substr(2);
+                std::string value = "true"; // Options without a value are treated as flags.
+
+                // Support both "--key=value" and "--key value".
+                size_t equals = key.find('=');
+                if (equals != std::string::npos)
+                {
+                    value = key.substr(equals + 1);
+                    key = key.substr(0, equals);
+                }
+                else if (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0)
+                {
+                    value = argv[++i];
+                }
+
+                options[key] = value;
+            }
+            else if (mode.empty())
+            {
+                mode = arg;
+            }
+        }
+    }
+
+    bool has(const std::string &key) const
+    {
+        return options.count(key) != 0;
+    }
+
+    std::string getString(const std::string &key, const std::string &defaultValue) const
+    {
+        std::map<std::string, std::string>::const_iterator it = options.find(key);
+        return it == options.end() ? defaultValue : it->second;
+    }
+
+    long long getInt(const std::string &key, long long defaultValue) const
+    {
+        std::map<std::string, std::string>::const_iterator it = options.find(key);
+        return it == options.end() ? defaultValue : atoll(it->second.c_str());
+    }
+
+    double getDouble(const std::string &key, double defaultValue) const
+    {
+        std::map<std::string, std::string>::const_iterator it = options.find(key);
+        return it == options.end() ? defaultValue : atof(it->second.c_str());
+    }
+
+    // Function 'getSymbolInputs' parses "--symbols Name=path,Name=path" into (symbol name, csv file) pairs.
+    // It returns 'defaultInputs' when the option was not given.
+
+    std::vector<std::pair<std::string, std::string>> getSymbolInputs(const std::vector<std::pair<std::string, std::string>> &defaultInputs) const
+    {
+        if (!has("symbols"))
+            return defaultInputs;
+
+        std::vector<std::pair<std::string, std::string>> symbolInputs;
+        std::string list = getString("symbols", "");
+        size_t start = 0;
+
+        while (start <= list.size())
+        {
+            size_t end = list.find(',', start);
+            if (end == std::string::npos)
+                end = list.size();
+
+            std::string item = list.substr(start, end - start);
+            size_t equals = item.find('=');
+            if (equals != std::string::npos)
+                symbolInputs.push_back(std::make_pair(item.substr(0, equals), item.substr(equals + 1)));
+            else if (!item.empty())
+                symbolInputs.push_back(std::make_pair(item, item)); // A bare path doubles as the symbol name.
+
+            start = end + 1;
+        }
+
+        return symbolInputs;
+    }
+};
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "columns.h"
+#include "csv_parser.h"
+
+// Define a C++ struct named 'ColumnViews' that describes a set of read-only columns and the memory that backs them.
+// The backing is either a DataColumns block (freshly parsed data) or a MappedFile (a binary cache file).
+struct ColumnViews
+{
+    std::shared_ptr<const void> storage; // Keeps the memory behind the views alive.
+    Span<const int64_t> date;
+    Span<const float> openPrice;
+    Span<const float> highPrice;
+    Span<const float> lowPrice;
+    Span<const float> closePrice;
+    Span<const float> adjClosePrice;
+    Span<const long long int> volume;
+    int skippedRows; // Stores the malformed row count of the source csv.
+
+    ColumnViews()
+        : skippedRows(0)
+    {
+    }
+
+    // Static function to build views over an in-memory DataColumns block.
+    static ColumnViews fromColumns(const std::shared_ptr<const DataColumns> &columns, int skippedRows)
+    {
+        ColumnViews views;
+        size_t rows = columns->size();
+        views.storage = columns;
+        views.date = Span<const int64_t>(columns->date.data(), rows);
+        views.openPrice = Span<const float>(columns->openPrice.data(), rows);
+        views.highPrice = Span<const float>(columns->highPrice.data(), rows);
+        views.lowPrice = Span<const float>(columns->lowPrice.data(), rows);
+        views.closePrice = Span<const float>(columns->closePrice.data(), rows);
+        views.adjClosePrice = Span<const float>(columns->adjClosePrice.data(), rows);
+        views.volume = Span<const long long int>(columns->volume.data(), rows);
+        views.skippedRows = skippedRows;
+        return views;
+    }
+
+    // Member function to return views of rows [offset, offset + count) that share the same backing memory.
+    ColumnViews subview(size_t offset, size_t count) const
+    {
+        ColumnViews views = *this;
+        views.date = date.subspan(offset, count);
+        views.openPrice = openPrice.subspan(offset, count);
+        views.highPrice = highPrice.subspan(offset, count);
+        views.lowPrice = lowPrice.subspan(offset, count);
+        views.closePrice = closePrice.subspan(offset, count);
+        views.adjClosePrice = adjClosePrice.subspan(offset, count);
+        views.volume = volume.subspan(offset, count);
+        return views;
+    }
+};
+
+// Define a C++ struct named 'ColumnCacheHeader' that is the fixed-size header at the start of a binary cache file.
+// The seven columns follow it, each starting at a 64-byte aligned offset, in native (little-endian) byte order.
+struct ColumnCacheHeader
+{
+    static const int NUM_OF_COLUMNS = 7;
+
+    char magic[8];                         // Stores "TFCOLS01".
+    uint32_t headerSize;                   // Stores sizeof(ColumnCacheHeader), to reject files from other builds.
+    uint32_t skippedRows;                  // Stores the malformed row count of the source csv.
+    char symbolName[64];                   // Stores the symbol the cache was built for (informational).
+    uint64_t rowCount;                     // Stores the number of rows in every column.
+    uint64_t columnOffsets[NUM_OF_COLUMNS]; // Stores the byte offset of each column from the start of the file.
+    uint64_t fileSize;                     // Stores the total size of the cache file.
+    uint64_t payloadChecksum;              // Stores the checksum of every byte after the header.
+    int64_t sourceMtime;                   // Stores the source csv modification time in nanoseconds.
+    uint64_t sourceSize;                   // Stores the source csv size in bytes.
+};
+
+// Define a C++ class named 'ColumnCache' that converts a csv file into a binary columnar file on first load
+// and maps that file directly on later loads, so repeated runs skip csv parsing entirely.
+// A cache file is reused only while the source csv has the same size and modification time.
+class ColumnCache
+{
+    // Static function holding the process-wide cache settings.
+    static std::string &directory()
+    {
+        static std::string cacheDirectory = ".tfcache";
+        return cacheDirectory;
+    }
+
+    static std::atomic<bool> &enabled()
+    {
+        static std::atomic<bool> cacheEnabled(true);
+        return cacheEnabled;
+    }
+
+    static uint64_t alignOffset(uint64_t offset)
+    {
+        return (offset + 63) & ~uint64_t(63);
+    }
+
+    // Static function to create 'path' and any missing parent directories.
+    static bool makeDirectories(const std::string &path)
+    {
+        for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+        {
+            std::string prefix = path.substr(0, slash);
+            if (!prefix.empty() && mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+                return false;
+            if (slash == std::string::npos)
+                return true;
+        }
+    }
+
+public:
+    // Static function to look up the size and nanosecond modification time of a file (what makes a cached or checkpointed result stale).
+    static bool getFileStamp(const std::string &fileName, int64_t &mtime, uint64_t &size)
+    {
+        struct stat fileStat;
+        if (stat(fileName.c_str(), &fileStat) != 0)
+            return false;
+
+        mtime = int64_t(fileStat.st_mtim.tv_sec) * 1000000000LL + fileStat.st_mtim.tv_nsec;
+        size = uint64_t(fileStat.st_size);
+        return true;
+    }
+
+    static void setEnabled(bool isEnabled) { enabled() = isEnabled; }
+    static bool isEnabled() { return enabled(); }
+
+    // Static function to change the cache directory. Call it before any Data is loaded.
+    static void setDirectory(const std::string &cacheDirectory) { directory() = cacheDirectory; }
+    static std::string getDirectory() { return directory(); }
+
+    // Static function to return the checksum stored in cache files: a 64-bit multiply-xor hash over 8-byte words.
+    static uint64_t checksum(const char *bytes, size_t length)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL ^ length;
+        size_t i = 0;
+
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + i, sizeof(word));
+            hash = (hash ^ word) * 0x100000001b3ULL;
+            hash ^= hash >> 29;
+        }
+
+        for (; i < length; i++)
+            hash = (hash ^ uint8_t(bytes[i])) * 0x100000001b3ULL;
+
+        return hash;
+    }
+
+    // Static function to return the cache file used for a csv file: "<dir>/<basename>-<hash of real path>.tfc".
+    // A non-empty 'variant' (e.g. a resampling timeframe) names a derived file "<basename>@<variant>-<hash>.tfc".
+    static std::string getCachePath(const std::string &csvFileName, const std::string &variant = "")
+    {
+        char resolved[PATH_MAX];
+        std::string key = realpath(csvFileName.c_str(), resolved) ? std::string(resolved) : csvFileName;
+
+        size_t slash = csvFileName.find_last_of('/');
+        std::string baseName = slash == std::string::npos ? csvFileName : csvFileName.substr(slash + 1);
+        if (!variant.empty())
+            baseName += "@" + variant;
+
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), "-%016llx.tfc", (unsigned long long)checksum(key.data(), key.size()));
+        return directory() + "/" + baseName + suffix;
+    }
+
+    // Static function to map a cache file and point 'views' at its columns.
+    // Returns false when the file is missing, truncated, from another build or fails its checksum.
+    static bool loadFile(const std::string &cacheFileName, ColumnViews &views, ColumnCacheHeader &header, bool verifyChecksum = true)
+    {
+        std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(cacheFileName);
+        if (!file->isOpen() || file->size() < sizeof(ColumnCacheHeader))
+            return false;
+
+        memcpy(&header, file->data(), sizeof(header));
+        if (memcmp(header.magic, "TFCOLS01", 8) != 0 || header.headerSize != sizeof(ColumnCacheHeader) || header.fileSize != file->size())
+            return false;
+
+        const size_t columnBytes[ColumnCacheHeader::NUM_OF_COLUMNS] = {sizeof(int64_t), sizeof(float), sizeof(float), sizeof(float),
+                                                                        sizeof(float), sizeof(float), sizeof(long long int)};
+        for (int c = 0; c < ColumnCacheHeader::NUM_OF_COLUMNS; c++)
+        {
+            if (header.columnOffsets[c] % 64 != 0 || header.columnOffsets[c] + header.rowCount * columnBytes[c] > file->size())
+                return false;
+        }
+
+        if (verifyChecksum && checksum(file->data() + sizeof(header), file->size() - sizeof(header)) != header.payloadChecksum)
+            return false;
+
+        size_t rows = size_t(header.rowCount);
+        const char *base = file->data();
+        views.date = Span<const int64_t>(reinterpret_cast<const int64_t *>(base + header.columnOffsets[0]), rows);
+        views.openPrice = Span<const float>(reinterpret_cast<const float *>(base + header.columnOffsets[1]), rows);
+        views.highPrice = Span<const float>(reinterpret_cast<const float *>(base + header.columnOffsets[2]), rows);
+        views.lowPrice = Span<const float>(reinterpret_cast<const float *>(base + header.columnOffsets[3]), rows);
+        views.closePrice = Span<const float>(reinterpret_cast<const float *>(base + header.columnOffsets[4]), rows);
+        views.adjClosePrice = Span<const float>(reinterpret_cast<const float *>(base + header.columnOffsets[5]), rows);
+        views.volume = Span<const long long int>(reinterpret_cast<const long long int *>(base + header.columnOffsets[6]), rows);
+        views.skippedRows = int(header.skippedRows);
+        views.storage = file;
+        return true;
+    }
+
+    // Static function to load the cached columns of a csv file if the cache is enabled and still matches the csv.
+    static bool load(const std::string &csvFileName, ColumnViews &views, const std::string &variant = "")
+    {
+        int64_t mtime;
+        uint64_t size;
+        if (!isEnabled() || !getFileStamp(csvFileName, mtime, size))
+            return false;
+
+        ColumnCacheHeader header;
+        ColumnViews cached;
+        if (!loadFile(getCachePath(csvFileName, variant), cached, header) || header.sourceMtime != mtime || header.sourceSize != size)
+            return false;
+
+        views = cached;
+        return true;
+    }
+
+    // Static function to write the columns parsed from a csv file to its cache file.
+    // The file is written under a temporary name and renamed into place, so concurrent loaders never see a partial file.
+    static bool store(const std::string &csvFileName, const std::string &symbolName, const ColumnViews &views,
+                      const std::string &variant = "")
+    {
+        int64_t mtime;
+        uint64_t size;
+        if (!isEnabled() || !getFileStamp(csvFileName, mtime, size) || !makeDirectories(directory()))
+            return false;
+
+        ColumnCacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "TFCOLS01", 8);
+        header.headerSize = sizeof(ColumnCacheHeader);
+        header.skippedRows = uint32_t(views.skippedRows);
+        strncpy(header.symbolName, symbolName.c_str(), sizeof(header.symbolName) - 1);
+        header.rowCount = views.date.size();
+        header.sourceMtime = mtime;
+        header.sourceSize = size;
+
+        const void *columns[ColumnCacheHeader::NUM_OF_COLUMNS] = {views.date.data(), views.openPrice.data(), views.highPrice.data(),
+                                                                   views.lowPrice.data(), views.closePrice.data(), views.adjClosePrice.data(),
+                                                                   views.volume.data()};
+        const size_t columnBytes[ColumnCacheHeader::NUM_OF_COLUMNS] = {sizeof(int64_t), sizeof(float), sizeof(float), sizeof(float),
+                                                                        sizeof(float), sizeof(float), sizeof(long long int)};
+
+        // Lay the columns out back to back, each on a 64-byte boundary, in one contiguous buffer.
+        uint64_t offset = alignOffset(sizeof(header));
+        for (int c = 0; c < ColumnCacheHeader::NUM_OF_COLUMNS; c++)
+        {
+            header.columnOffsets[c] = offset;
+            offset = alignOffset(offset + header.rowCount * columnBytes[c]);
+        }
+        header.fileSize = offset;
+
+        std::vector<char> buffer(size_t(offset), 0);
+        for (int c = 0; c < ColumnCacheHeader::NUM_OF_COLUMNS; c++)
+        {
+            if (header.rowCount)
+                memcpy(&buffer[size_t(header.columnOffsets[c])], columns[c], size_t(header.rowCount * columnBytes[c]));
+        }
+        header.payloadChecksum = checksum(&buffer[sizeof(header)], buffer.size() - sizeof(header));
+        memcpy(&buffer[0], &header, sizeof(header));
+
+        std::string cachePath = getCachePath(csvFileName, variant);
+        char tempSuffix[64];
+        snprintf(tempSuffix, sizeof(tempSuffix), ".tmp.%d.%zx", int(getpid()), std::hash<std::thread::id>()(std::this_thread::get_id()));
+        std::string tempPath = cachePath + tempSuffix;
+
+        FILE *fout = fopen(tempPath.c_str(), "wb");
+        if (!fout)
+            return false;
+
+        bool written = fwrite(&buffer[0], 1, buffer.size(), fout) == buffer.size();
+        written = (fclose(fout) == 0) && written;
+
+        if (!written || rename(tempPath.c_str(), cachePath.c_str()) != 0)
+        {
+            unlink(tempPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "csv_parser.h"
+
+// Define a C++ allocator named 'AlignedAllocator' that returns cache-line aligned memory, so columns start on
+// a 64-byte boundary and vectorized loops over them never split their first load across cache lines.
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator
+{
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n)
+    {
+        void *memory = nullptr;
+        size_t bytes = n * sizeof(T);
+        if (bytes == 0)
+            bytes = Alignment; // posix_memalign may return nullptr for 0 bytes.
+        if (posix_memalign(&memory, Alignment, bytes) != 0)
+            throw std::bad_alloc();
+        return static_cast<T *>(memory);
+    }
+
+    void deallocate(T *memory, size_t)
+    {
+        free(memory);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+// Define a C++ class named 'Span' that is a non-owning view over a contiguous array (a minimal std::span).
+template <typename T>
+class Span
+{
+    T *pointer;    // Stores the first element of the view.
+    size_t length; // Stores the number of elements in the view.
+
+public:
+    Span()
+        : pointer(nullptr), length(0)
+    {
+    }
+
+    Span(T *pointer, size_t length)
+        : pointer(pointer), length(length)
+    {
+    }
+
+    T *data() const { return pointer; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    T *begin() const { return pointer; }
+    T *end() const { return pointer + length; }
+    T &operator[](size_t i) const { return pointer[i]; }
+
+    // Member function to return the view of 'count' elements starting at 'offset'.
+    Span subspan(size_t offset, size_t count) const
+    {
+        return Span(pointer + offset, count);
+    }
+};
+
+// Define a C++ struct named 'DataColumns' that owns one aligned, contiguous array per csv column.
+// It is filled by the csv loader (or any other producer of bars) and then handed to a Data object.
+struct DataColumns
+{
+    std::vector<int64_t, AlignedAllocator<int64_t>> date;
+    std::vector<float, AlignedAllocator<float>> openPrice;
+    std::vector<float, AlignedAllocator<float>> highPrice;
+    std::vector<float, AlignedAllocator<float>> lowPrice;
+    std::vector<float, AlignedAllocator<float>> closePrice;
+    std::vector<float, AlignedAllocator<float>> adjClosePrice;
+    std::vector<long long int, AlignedAllocator<long long int>> volume;
+
+    // Member function to reserve capacity for 'rows' rows in every column.
+    void reserve(size_t rows)
+    {
+        date.reserve(rows);
+        openPrice.reserve(rows);
+        highPrice.reserve(rows);
+        lowPrice.reserve(rows);
+        closePrice.reserve(rows);
+        adjClosePrice.reserve(rows);
+        volume.reserve(rows);
+    }
+
+    // Member function to resize every column to 'rows' rows.
+    void resize(size_t rows)
+    {
+        date.resize(rows);
+        openPrice.resize(rows);
+        highPrice.resize(rows);
+        lowPrice.resize(rows);
+        closePrice.resize(rows);
+        adjClosePrice.resize(rows);
+        volume.resize(rows);
+    }
+
+    // Member function to overwrite row 'i' of every column.
+    void set(size_t i, const CsvRow &row)
+    {
+        date[i] = row.date;
+        openPrice[i] = row.openPrice;
+        highPrice[i] = row.highPrice;
+        lowPrice[i] = row.lowPrice;
+        closePrice[i] = row.closePrice;
+        adjClosePrice[i] = row.adjClosePrice;
+        volume[i] = row.volume;
+    }
+
+    // Member function to append one row to every column.
+    void push_back(const CsvRow &row)
+    {
+        date.push_back(row.date);
+        openPrice.push_back(row.openPrice);
+        highPrice.push_back(row.highPrice);
+        lowPrice.push_back(row.lowPrice);
+        closePrice.push_back(row.closePrice);
+        adjClosePrice.push_back(row.adjClosePrice);
+        volume.push_back(row.volume);
+    }
+
+    size_t size() const
+    {
+        return date.size();
+    }
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#define DEBUG false
+
+std::mutex stdOutMutex;
+
+template <typename T>
+// This function prints a message to the standard output with an optional newline character.
+void printMessage(T msg, bool nextLine = true)
+{
+    // Lock a mutex to ensure thread safety when printing.
+    stdOutMutex.lock();
+
+    // Print the message to the standard output.
+    std::cout << msg;
+
+    // Check if the 'nextLine' flag is set to true.
+    if (nextLine)
+    {
+        // If true, add a newline character to the end of the message.
+        std::cout << std::endl;
+    }
+    else
+    {
+        // If false, add a space character to the end of the message.
+        std::cout << " ";
+    }
+
+    // Unlock the mutex to release the lock for other threads.
+    stdOutMutex.unlock();
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Define a C++ class named 'MappedFile' that maps a whole file read-only into memory.
+// The mapping is released when the object is destroyed.
+class MappedFile
+{
+    const char *begin; // Stores the first byte of the mapping (nullptr when the file could not be mapped).
+    size_t length;     // Stores the size of the mapping in bytes.
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+public:
+    explicit MappedFile(const std::string &fileName)
+        : begin(nullptr), length(0)
+    {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            void *mapping = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                begin = static_cast<const char *>(mapping);
+                length = size_t(fileStat.st_size);
+                madvise(mapping, length, MADV_SEQUENTIAL); // The loader makes a single forward pass.
+            }
+        }
+
+        close(fd); // The mapping stays valid after the descriptor is closed.
+    }
+
+    bool isOpen() const { return begin != nullptr; }
+    const char *data() const { return begin; }
+    size_t size() const { return length; }
+
+    ~MappedFile()
+    {
+        if (begin)
+            munmap(const_cast<char *>(begin), length);
+    }
+};
+
+// Define a C++ struct named 'CsvRow' to hold one parsed "Date,Open,High,Low,Close,Adj Close,Volume" row.
+struct CsvRow
+{
+    int64_t date;         // Stores the bar time as seconds since the Unix epoch (UTC).
+    float openPrice;      // Stores the opening price.
+    float highPrice;      // Stores the highest traded price.
+    float lowPrice;       // Stores the lowest traded price.
+    float closePrice;     // Stores the closing price.
+    float adjClosePrice;  // Stores the dividend/split adjusted closing price.
+    long long int volume; // Stores the traded volume.
+};
+
+// Define a C++ class named 'CsvParser' with allocation-free, locale-independent parsing routines.
+// Every routine takes a [cursor, end) byte range, advances 'cursor' past what it consumed and returns false on malformed input.
+class CsvParser
+{
+public:
+    // Static function to count the '\n' bytes in [begin, end), 16 bytes at a time when SSE2 is available.
+    static size_t countLines(const char *begin, const char *end)
+    {
+        size_t lines = 0;
+        const char *p = begin;
+
+#ifdef __SSE2__
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (; p + 16 <= end; p += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            lines += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        }
+#endif
+
+        for (; p < end; p++)
+            lines += (*p == '\n');
+
+        return lines;
+    }
+
+    // Static function to return the start of the next line after 'cursor' (or 'end' for the last line).
+    static const char *nextLine(const char *cursor, const char *end)
+    {
+        const char *newline = static_cast<const char *>(memchr(cursor, '\n', size_t(end - cursor)));
+        return newline ? newline + 1 : end;
+    }
+
+    // Static function to convert a civil date to days since 1970-01-01 (proleptic Gregorian calendar).
+    static int64_t daysFromCivil(int year, unsigned month, unsigned day)
+    {
+        year -= month <= 2;
+        const int64_t era = (year >= 0 ? year : year - 399) / 400;
+        const unsigned yearOfEra = unsigned(year - era * 400);
+        const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + int64_t(dayOfEra) - 719468;
+    }
+
+    // Static function to convert days since 1970-01-01 back to a civil (year, month, day).
+    static void civilFromDays(int64_t days, int &year, unsigned &month, unsigned &day)
+    {
+        days += 719468;
+        const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const unsigned dayOfEra = unsigned(days - era * 146097);
+        const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const unsigned mp = (5 * dayOfYear + 2) / 153;
+        day = dayOfYear - (153 * mp + 2) / 5 + 1;
+        month = mp < 10 ? mp + 3 : mp - 9;
+        year = int(int64_t(yearOfEra) + era * 400 + (month <= 2));
+    }
+
+    // Static function to format an epoch timestamp as "YYYY-MM-DD", or "YYYY-MM-DD HH:MM:SS" for intraday bars.
+    static std::string formatDate(int64_t timestamp)
+    {
+        int64_t days = timestamp >= 0 ? timestamp / 86400 : (timestamp - 86399) / 86400;
+        int64_t seconds = timestamp - days * 86400;
+        int year;
+        unsigned month, day;
+        civilFromDays(days, year, month, day);
+
+        char buffer[32];
+        if (seconds == 0)
+            snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", year, month, day);
+        else
+            snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u %02d:%02d:%02d", year, month, day,
+                     int(seconds / 3600), int(seconds / 60 % 60), int(seconds % 60));
+        return buffer;
+    }
+
+    // Static function to parse exactly 'width' decimal digits.
+    static bool parseDigits(const char *&cursor, const char *end, int width, int &value)
+    {
+        if (end - cursor < width)
+            return false;
+
+        value = 0;
+        for (int i = 0; i < width; i++)
+        {
+            unsigned digit = unsigned(cursor[i] - '0');
+            if (digit > 9)
+                return false;
+            value = value * 10 + int(digit);
+        }
+
+        cursor += width;
+        return true;
+    }
+
+    // Static function to parse "YYYY-MM-DD" with an optional " HH:MM[:SS]" or "THH:MM[:SS]" time of day.
+    static bool parseDate(const char *&cursor, const char *end, int64_t &timestamp)
+    {
+        int year, month, day, hour = 0, minute = 0, second = 0;
+
+        if (!parseDigits(cursor, end, 4, year) || cursor == end || *cursor++ != '-' ||
+            !parseDigits(cursor, end, 2, month) || cursor == end || *cursor++ != '-' ||
+            !parseDigits(cursor, end, 2, day) || month < 1 || month > 12 || day < 1 || day > 31)
+            return false;
+
+        if (cursor != end && (*cursor == ' ' || *cursor == 'T'))
+        {
+            cursor++;
+            if (!parseDigits(cursor, end, 2, hour) || cursor == end || *cursor++ != ':' || !parseDigits(cursor, end, 2, minute))
+                return false;
+            if (cursor != end && *cursor == ':')
+            {
+                cursor++;
+                if (!parseDigits(cursor, end, 2, second))
+                    return false;
+            }
+        }
+
+        timestamp = daysFromCivil(year, unsigned(month), unsigned(day)) * 86400 + hour * 3600 + minute * 60 + second;
+        return true;
+    }
+
+    // Static function to parse a signed decimal integer.
+    static bool parseInt(const char *&cursor, const char *end, long long int &value)
+    {
+        bool negative = cursor != end && *cursor == '-';
+        cursor += negative;
+
+        const char *digitsBegin = cursor;
+        unsigned long long magnitude = 0;
+        while (cursor != end && unsigned(*cursor - '0') <= 9)
+            magnitude = magnitude * 10 + unsigned(*cursor++ - '0');
+
+        if (cursor == digitsBegin || cursor - digitsBegin > 18)
+            return false;
+
+        value = negative ? -(long long int)magnitude : (long long int)magnitude;
+        return true;
+    }
+
+    // Static function to parse a decimal floating point number ("-12.345", "1e-3", ...) into a float.
+    // The digits are accumulated into an integer mantissa and scaled by an exact power of ten in double precision,
+    // which is correctly rounded. The rare inputs where that shortcut could round differently from strtof
+    // (too many digits, huge exponents or a double result exactly halfway between two floats) fall back to strtof.
+    static bool parseFloat(const char *&cursor, const char *end, float &value)
+    {
+        static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+        const char *start = cursor;
+        bool negative = cursor != end && *cursor == '-';
+        cursor += (cursor != end && (*cursor == '-' || *cursor == '+'));
+
+        unsigned long long mantissa = 0;
+        int numOfDigits = 0, exponent = 0;
+
+        while (cursor != end && unsigned(*cursor - '0') <= 9)
+        {
+            mantissa = mantissa * 10 + unsigned(*cursor++ - '0');
+            numOfDigits++;
+        }
+
+        if (cursor != end && *cursor == '.')
+        {
+            cursor++;
+            while (cursor != end && unsigned(*cursor - '0') <= 9)
+            {
+                mantissa = mantissa * 10 + unsigned(*cursor++ - '0');
+                numOfDigits++;
+                exponent--;
+            }
+        }
+
+        if (numOfDigits == 0)
+            return false;
+
+        if (cursor != end && (*cursor == 'e' || *cursor == 'E'))
+        {
+            cursor++;
+            long long int explicitExponent;
+            if (cursor != end && *cursor == '+')
+                cursor++;
+            if (!parseInt(cursor, end, explicitExponent) || explicitExponent > 400 || explicitExponent < -400)
+                return false;
+            exponent += int(explicitExponent);
+        }
+
+        bool exact = numOfDigits <= 15 && exponent >= -22 && exponent <= 22;
+        if (exact)
+        {
+            double result = exponent < 0 ? double(mantissa) / powersOfTen[-exponent] : double(mantissa) * powersOfTen[exponent];
+
+            // A double that sits exactly on a float rounding midpoint may have been rounded there; let strtof decide.
+            uint64_t bits;
+            memcpy(&bits, &result, sizeof(bits));
+            if ((bits & 0x1FFFFFFFull) != 0x10000000ull)
+            {
+                value = float(negative ? -result : result);
+                return true;
+            }
+        }
+
+        char buffer[64];
+        size_t length = size_t(cursor - start);
+        if (length >= sizeof(buffer))
+            return false;
+        memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        value = strtof(buffer, nullptr);
+        return true;
+    }
+
+    // Static function to consume a single ',' separator.
+    static bool expectComma(const char *&cursor, const char *end)
+    {
+        if (cursor == end || *cursor != ',')
+            return false;
+        cursor++;
+        return true;
+    }
+
+    // Static function to parse one "Date,Open,High,Low,Close,Adj Close,Volume" line ending at 'end' (exclusive of '\n').
+    static bool parseRow(const char *cursor, const char *end, CsvRow &row)
+    {
+        if (end != cursor && end[-1] == '\r')
+            end--; // Accept Windows line endings.
+
+        return parseDate(cursor, end, row.date) && expectComma(cursor, end) &&
+               parseFloat(cursor, end, row.openPrice) && expectComma(cursor, end) &&
+               parseFloat(cursor, end, row.highPrice) && expectComma(cursor, end) &&
+               parseFloat(cursor, end, row.lowPrice) && expectComma(cursor, end) &&
+               parseFloat(cursor, end, row.closePrice) && expectComma(cursor, end) &&
+               parseFloat(cursor, end, row.adjClosePrice) && expectComma(cursor, end) &&
+               parseInt(cursor, end, row.volume) && (cursor == end || *cursor == ',');
+    }
+
+    // Static function to return whether a line is blank or looks like a "Date,Open,..." header.
+    static bool isHeaderOrBlank(const char *cursor, const char *end)
+    {
+        while (cursor != end && (*cursor == ' ' || *cursor == '\r' || *cursor == '\t'))
+            cursor++;
+        return cursor == end || (unsigned((*cursor | 0x20) - 'a') < 26);
+    }
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "common.h"
+#include "columns.h"
+#include "column_cache.h"
+#include "instrumentation.h"
+#include "csv_parser.h"
+
+// Define a C++ struct named 'DataPoint' to store financial data.
+// Data keeps its rows in columns; a DataPoint is materialized on demand by 'Data::getRow'.
+struct DataPoint
+{
+    int64_t date;         // Stores the date associated with the data point, packed as seconds since the Unix epoch.
+    float openPrice;      // Stores the opening price of the instrument.
+    float highPrice;      // Stores the highest price of the instrument.
+    float lowPrice;       // Stores the lowest price of the instrument.
+    float closePrice;     // Stores the closing price of the instrument.
+    float adjClosePrice;  // Stores the dividend/split adjusted closing price of the instrument.
+    long long int volume; // Stores the trading volume associated with the data point.
+
+    // Member function to set the data members of the struct from a parsed csv row.
+    void setData(const CsvRow &row)
+    {
+        date = row.date;
+        openPrice = row.openPrice;
+        highPrice = row.highPrice;
+        lowPrice = row.lowPrice;
+        closePrice = row.closePrice;
+        adjClosePrice = row.adjClosePrice;
+        volume = row.volume;
+    }
+
+    // Member function to set the data members of the struct from a comma-separated string.
+    // Returns false (leaving the struct untouched) when the line is malformed.
+    bool setData(const std::string &line)
+    {
+        CsvRow row;
+        if (!CsvParser::parseRow(line.data(), line.data() + line.size(), row))
+            return false;
+
+        setData(row);
+        return true;
+    }
+};
+
+// Define a C++ class named 'Data' to handle financial data.
+// Rows are stored column by column so that kernels touching a single field (usually the close) stream through
+// one dense array. Columns are exposed as read-only Span views; copies of a Data share the same columns.
+// The columns are backed either by freshly parsed DataColumns or by a memory-mapped binary cache file.
+class Data
+{
+    ColumnViews columns; // Stores the column views and the memory that backs them.
+
+public:
+    std::string symbolName; // Stores the symbol name associated with the data.
+    int numberOfRows;       // Stores the number of rows in the data.
+    int skippedRows;        // Stores the number of malformed rows skipped while parsing.
+
+    // Constructor that creates an empty Data object for the given symbol.
+    explicit Data(std::string symbolName)
+        : symbolName(symbolName), numberOfRows(0), skippedRows(0)
+    {
+    }
+
+    // Constructor that takes symbol name and a file name to load data (through the column cache when enabled).
+    Data(std::string symbolName, std::string fileName)
+        : symbolName(symbolName), numberOfRows(0), skippedRows(0)
+    {
+        loadData(fileName); // Call the loadData function to initialize the data.
+    }
+
+    // Constructor that takes ownership of columns produced elsewhere.
+    Data(std::string symbolName, std::shared_ptr<const DataColumns> columns)
+        : symbolName(symbolName), numberOfRows(0), skippedRows(0)
+    {
+        setColumns(ColumnViews::fromColumns(columns, 0));
+    }
+
+    // Member function to point the column views at 'views' and keep their backing memory alive.
+    void setColumns(const ColumnViews &views)
+    {
+        columns = views;
+        numberOfRows = int(views.date.size());
+        skippedRows = views.skippedRows;
+    }
+
+    // Member function to return rows [begin, begin + count) as a Data that references these columns (no copy).
+    Data getSlice(int begin, int count) const
+    {
+        Data slice(symbolName);
+        slice.setColumns(columns.subview(size_t(begin), size_t(count)));
+        return slice;
+    }
+
+    // Member function to load a csv file. When the column cache is enabled, an up to date binary cache of the file
+    // is mapped instead of parsing; otherwise the csv is parsed and the cache is (re)written for the next run.
+    void loadData(const std::string &fileName)
+    {
+        TF_PROFILE_SCOPE(LOAD_DATA);
+
+        ColumnViews cached;
+        bool cacheHit;
+        {
+            TF_PROFILE_SCOPE(CACHE_LOAD);
+            cacheHit = ColumnCache::load(fileName, cached);
+        }
+        if (cacheHit)
+        {
+            setColumns(cached);
+            TF_PROFILE_COUNT(CACHE_HITS, 1);
+            TF_PROFILE_COUNT(ROWS_LOADED, numberOfRows);
+            return;
+        }
+
+        parseData(fileName);
+        TF_PROFILE_COUNT(CACHE_MISSES, 1);
+        TF_PROFILE_COUNT(ROWS_LOADED, numberOfRows);
+        if (numberOfRows)
+            ColumnCache::store(fileName, symbolName, columns);
+    }
+
+    // Member function to map a binary cache file directly, without looking at its source csv.
+    bool loadColumnCache(const std::string &cacheFileName)
+    {
+        ColumnViews views;
+        ColumnCacheHeader header;
+        if (!ColumnCache::loadFile(cacheFileName, views, header))
+            return false;
+
+        setColumns(views);
+        return true;
+    }
+
+    // Member function to parse data from a csv file and populate the columns.
+    // The file is memory mapped and parsed in place: a vectorized newline count sizes the columns up front,
+    // then each line is parsed without temporary strings. Malformed rows are skipped and counted in 'skippedRows'.
+    void parseData(const std::string &fileName)
+    {
+        TF_PROFILE_SCOPE(PARSE_CSV);
+
+        std::shared_ptr<DataColumns> parsed = std::make_shared<DataColumns>();
+        int malformedRows = 0;
+
+        MappedFile file(fileName); // Map the file for reading.
+        if (file.isOpen())
+        {
+            const char *cursor = file.data();
+            const char *end = cursor + file.size();
+            size_t rows = 0;
+            parsed->resize(CsvParser::countLines(cursor, end) + 1); // Every row fits; trimmed below.
+
+            // Loop to parse the file line by line.
+            while (cursor < end)
+            {
+                const char *lineEnd = CsvParser::nextLine(cursor, end);
+                const char *contentEnd = lineEnd[-1] == '\n' ? lineEnd - 1 : lineEnd;
+
+                CsvRow row;
+                if (CsvParser::parseRow(cursor, contentEnd, row))
+                    parsed->set(rows++, row); // Store the row in every column.
+                else if (!CsvParser::isHeaderOrBlank(cursor, contentEnd))
+                    malformedRows++; // Count malformed rows instead of aborting the load.
+
+                cursor = lineEnd;
+            }
+
+            parsed->resize(rows);
+        }
+
+        setColumns(ColumnViews::fromColumns(parsed, malformedRows));
+    }
+
+    Span<const int64_t> dates() const { return columns.date; }
+    Span<const float> openPrices() const { return columns.openPrice; }
+    Span<const float> highPrices() const { return columns.highPrice; }
+    Span<const float> lowPrices() const { return columns.lowPrice; }
+    Span<const float> closePrices() const { return columns.closePrice; }
+    Span<const float> adjClosePrices() const { return columns.adjClosePrice; }
+    Span<const long long int> volumes() const { return columns.volume; }
+
+    // Member function to return the bytes held by the seven columns (mapped or in memory).
+    size_t getColumnBytes() const
+    {
+        return size_t(numberOfRows) * (sizeof(int64_t) + 5 * sizeof(float) + sizeof(long long int));
+    }
+
+    // Member function to materialize one row as a DataPoint.
+    DataPoint getRow(int row) const
+    {
+        DataPoint point;
+        point.date = columns.date[row];
+        point.openPrice = columns.openPrice[row];
+        point.highPrice = columns.highPrice[row];
+        point.lowPrice = columns.lowPrice[row];
+        point.closePrice = columns.closePrice[row];
+        point.adjClosePrice = columns.adjClosePrice[row];
+        point.volume = columns.volume[row];
+        return point;
+    }
+
+    // Member function to return the bytes used by one row across all columns.
+    static size_t getBytesPerRow()
+    {
+        return sizeof(int64_t) + 5 * sizeof(float) + sizeof(long long int);
+    }
+
+    // Member function to print the stored data to the console.
+    void printData() const
+    {
+        for (int row = 0; row < numberOfRows; row++)
+        {
+            std::cout << CsvParser::formatDate(columns.date[row]) << ", " << columns.openPrice[row] << ", " << columns.closePrice[row] << ", " << columns.volume[row] << "\n";
+        }
+        std::cout.flush();
+    }
+
+    // Destructor for the class.
+    ~Data()
+    {
+        // If DEBUG flag is set, print a message indicating deconstruction.
+        if (DEBUG)
+            printMessage("Deconstructing Data Object");
+    }
+};
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "backtest.h"
+#include "execution.h"
+#include "instrumentation.h"
+#include "multi_strategy.h"
+#include "resample.h"
+#include "results_sink.h"
+#include "symbol_store.h"
+#include "thread_pool.h"
+#include "universe.h"
+
+// Define a C++ class named 'Driver' that backtests every (symbol, strategy) pair on a work-stealing thread pool.
+// Loading a symbol is one task; once loaded it fans out one task per strategy, so a long series or a large
+// strategy list is spread over all workers instead of tying one thread to one symbol. Series come from the
+// process-wide SymbolStore, so every strategy, run and Driver shares one read-only copy of each symbol.
+class Driver
+{
+    int NUM_OF_THREADS; // Stores the number of worker threads (0 means one per hardware thread).
+    int NUM_OF_IO_THREADS; // Stores the number of loader threads (0 loads on the worker threads).
+    std::queue<std::pair<std::string, std::string>> symbolInputs;
+    std::vector<Strategy *> strategyInstances;
+    std::vector<WorkerStats> workerStats; // Stores the per-worker statistics of the last run.
+    ResultsSink *resultsSink;             // Stores where results go (nullptr prints the text format to stdout).
+    ExecutionSettings execution;          // Stores the execution model (close-only by default).
+    Timeframe timeframe;                  // Stores the bar size the csv files are resampled to.
+    std::vector<SymbolLoadReport> loadReports; // Stores the rows and malformed rows of each symbol of the last run.
+    bool shareIndicators;                 // Stores whether each symbol runs all strategies in one MultiStrategyRunner task.
+
+public:
+    Driver()
+        : NUM_OF_THREADS(0), NUM_OF_IO_THREADS(0), resultsSink(nullptr), shareIndicators(false)
+    {
+    }
+
+    Driver(int NUM_OF_THREADS)
+        : NUM_OF_THREADS(NUM_OF_THREADS), NUM_OF_IO_THREADS(0), resultsSink(nullptr), shareIndicators(false)
+    {
+    }
+
+    // Function 'setNumOfIoThreads' loads the symbols on 'numOfIoThreads' dedicated loader threads that feed the
+    // worker pool, so at most that many files are read and parsed at once while the workers backtest the symbols
+    // already loaded. 0 (the default) loads each symbol as a task on the worker pool itself.
+    void setNumOfIoThreads(int numOfIoThreads)
+    {
+        NUM_OF_IO_THREADS = std::max(0, numOfIoThreads);
+    }
+
+    // Function 'setShareIndicators' runs all strategies of a symbol as one task through a MultiStrategyRunner,
+    // so they share their indicator series instead of each computing its own. Symbols still run in parallel;
+    // the strategies of one symbol no longer do. Only the close-only execution model shares indicators (the command
+    // line rejects the combination; other callers fall back to per-strategy tasks).
+    void setShareIndicators(bool shareIndicators)
+    {
+        this->shareIndicators = shareIndicators;
+    }
+
+    void setStrategyInstance(Strategy *strategyInstance)
+    {
+        strategyInstances.assign(1, strategyInstance);
+    }
+
+    // Function 'setResultsSink' routes the results of later runs to 'resultsSink'; the caller closes it.
+    void setResultsSink(ResultsSink *resultsSink)
+    {
+        this->resultsSink = resultsSink;
+    }
+
+    // Function 'setExecution' sets how trades are filled; the default close-only model evaluates the plain signals.
+    void setExecution(const ExecutionSettings &execution)
+    {
+        this->execution = execution;
+    }
+
+    // Function 'setTimeframe' resamples every loaded csv file to 'timeframe' (native keeps the file's bars).
+    void setTimeframe(const Timeframe &timeframe)
+    {
+        this->timeframe = timeframe;
+    }
+
+    void addStrategyInstance(Strategy *strategyInstance)
+    {
+        strategyInstances.push_back(strategyInstance);
+    }
+
+    // Function 'setStrategyInstances' runs every strategy in 'strategyInstances' on each symbol of the next run.
+    void setStrategyInstances(const std::vector<Strategy *> &strategyInstances)
+    {
+        this->strategyInstances = strategyInstances;
+    }
+
+    // Function 'getDefaultSymbolInputs' returns the (symbol name, csv file) pairs bundled with the repository.
+
+    static std::vector<std::pair<std::string, std::string>> getDefaultSymbolInputs()
+    {
+        std::vector<std::pair<std::string, std::string>> defaultInputs;
+        defaultInputs.push_back(std::make_pair("Meta", "data/META.csv"));
+        defaultInputs.push_back(std::make_pair("Tesla", "data/TSLA.csv"));
+        defaultInputs.push_back(std::make_pair("Amazon", "data/AMZN.csv"));
+        defaultInputs.push_back(std::make_pair("Apple", "data/AAPL.csv"));
+        defaultInputs.push_back(std::make_pair("Google", "data/GOOG.csv"));
+        return defaultInputs;
+    }
+
+    void setSymbolInputs()
+    {
+        std::vector<std::pair<std::string, std::string>> defaultInputs = getDefaultSymbolInputs();
+        for (size_t i = 0; i < defaultInputs.size(); i++)
+            symbolInputs.push(defaultInputs[i]);
+    }
+
+    void setSymbolInputs(std::queue<std::pair<std::string, std::string>> &symbolInputs)
+    {
+        this->symbolInputs = symbolInputs;
+    }
+
+    // Function 'setSymbolInputs' queues (symbol name, csv file) pairs, e.g. a universe found by SymbolUniverse::discover.
+    void setSymbolInputs(const std::vector<std::pair<std::string, std::string>> &symbolInputs)
+    {
+        for (size_t i = 0; i < symbolInputs.size(); i++)
+            this->symbolInputs.push(symbolInputs[i]);
+    }
+    // Function 'processSymbol' handles the processing of a single symbol for backtesting.
+    // It takes the symbol's Data from the SymbolStore, initializes a Backtest instance, and runs the backtest.
+    // Finally, it deletes the Backtest instance when done.
+
+    static void processSymbol(const std::pair<std::string, std::string> &symbolInput, Strategy *strategyInstance, ResultsSink &resultsSink,
+                              const ExecutionSettings &execution = ExecutionSettings())
+    {
+        TF_PROFILE_SCOPE(PROCESS_SYMBOL);
+
+        // Share the symbol's Data with every other strategy run on it (loaded on the first request only).
+        std::shared_ptr<const Data> symbolData = SymbolStore::getInstance().get(symbolInput.first, symbolInput.second);
+
+        processStrategy(strategyInstance, symbolData, resultsSink, execution);
+    }
+
+    // Function 'processStrategy' runs one strategy on one already loaded symbol and pushes the result to 'resultsSink'.
+
+    static void processStrategy(Strategy *strategyInstance, std::shared_ptr<const Data> symbolData, ResultsSink &resultsSink,
+                                const ExecutionSettings &execution = ExecutionSettings())
+    {
+        TF_PROFILE_SCOPE(PROCESS_STRATEGY);
+        TF_PROFILE_COUNT(BACKTESTS, 1);
+
+        if (DEBUG)
+            printMessage("Task Started For Symbol: " + symbolData->symbolName + ", Strategy: " + strategyInstance->strategyName);
+
+        // Run the backtest; the per-trade list is only collected when the sink writes it.
+        std::vector<TradeRecord> trades;
+        std::vector<TradeRecord> *tradesOut = resultsSink.wantsTrades() ? &trades : nullptr;
+        BacktestResult result;
+
+        if (execution.isCloseOnly())
+        {
+            // Initialize a Backtest instance with the provided strategy and symbol data.
+            Backtest *backtestInstance = new Backtest(strategyInstance, symbolData);
+            result = backtestInstance->evaluate(tradesOut);
+
+            // Delete the Backtest instance to free up resources.
+            delete backtestInstance;
+        }
+        else
+            result = ExecutionEngine(execution).evaluate(*strategyInstance, *symbolData, tradesOut);
+
+        resultsSink.push(symbolData->symbolName, *strategyInstance, result, trades);
+
+        if (DEBUG)
+            printMessage("Task Completed For Symbol: " + symbolData->symbolName + ", Strategy: " + strategyInstance->strategyName);
+    }
+
+    // Function 'processStrategies' runs every strategy on one already loaded symbol through a MultiStrategyRunner
+    // and pushes the results to 'resultsSink' in strategy order.
+
+    static void processStrategies(const std::vector<Strategy *> &strategyInstances, std::shared_ptr<const Data> symbolData, ResultsSink &resultsSink)
+    {
+        TF_PROFILE_SCOPE(PROCESS_STRATEGY);
+        TF_PROFILE_COUNT(BACKTESTS, (long long)strategyInstances.size());
+
+        std::vector<std::vector<TradeRecord>> trades;
+        std::vector<BacktestResult> results = MultiStrategyRunner(strategyInstances).run(*symbolData, resultsSink.wantsTrades() ? &trades : nullptr);
+        const std::vector<TradeRecord> noTrades;
+        for (size_t s = 0; s < strategyInstances.size(); s++)
+            resultsSink.push(symbolData->symbolName, *strategyInstances[s], results[s], trades.empty() ? noTrades : trades[s]);
+    }
+
+    // Function 'runBacktest' backtests every symbol input against every strategy instance.
+    // Each symbol is loaded either as a task on the pool or, with loader threads, by the next free loader; once
+    // loaded it queues one backtest task per strategy, where idle workers can steal them. It returns once every
+    // task has finished.
+
+    void runBacktest()
+    {
+        WorkStealingPool pool(NUM_OF_THREADS);
+        std::vector<Strategy *> strategies = strategyInstances;
+        const ExecutionSettings &execution = this->execution;
+        const Timeframe &timeframe = this->timeframe;
+
+        // Without a sink of the caller's, results are printed in the text format by a sink local to this run.
+        std::unique_ptr<ResultsSink> stdoutSink;
+        if (!resultsSink)
+            stdoutSink.reset(new ResultsSink(std::cout, RESULTS_TEXT));
+        ResultsSink &sink = resultsSink ? *resultsSink : *stdoutSink;
+
+        std::vector<std::pair<std::string, std::string>> inputs;
+        for (; !symbolInputs.empty(); symbolInputs.pop())
+            inputs.push_back(symbolInputs.front());
+        loadReports.assign(inputs.size(), SymbolLoadReport());
+        std::vector<SymbolLoadReport> &reports = loadReports;
+
+        // Load symbol 'i' (on whichever thread calls it) and queue its backtests on the pool.
+        const bool shareIndicators = this->shareIndicators && execution.isCloseOnly();
+        std::function<void(size_t)> loadSymbol = [&pool, &strategies, &sink, &execution, &timeframe, &inputs, &reports, shareIndicators](size_t i)
+        {
+            TF_PROFILE_SCOPE(PROCESS_SYMBOL);
+            std::shared_ptr<const Data> symbolData = SymbolStore::getInstance().get(inputs[i].first, inputs[i].second, timeframe);
+            reports[i].symbolName = inputs[i].first;
+            reports[i].fileName = inputs[i].second;
+            reports[i].rows = symbolData->numberOfRows;
+            reports[i].skippedRows = symbolData->skippedRows;
+
+            if (shareIndicators)
+            {
+                pool.submit([&strategies, symbolData, &sink]()
+                            { processStrategies(strategies, symbolData, sink); });
+                return;
+            }
+            for (size_t s = 0; s < strategies.size(); s++)
+            {
+                Strategy *strategyInstance = strategies[s];
+                pool.submit([strategyInstance, symbolData, &sink, &execution]()
+                            { processStrategy(strategyInstance, symbolData, sink, execution); });
+            }
+        };
+
+        if (NUM_OF_IO_THREADS > 0)
+        {
+            // Loader threads take the next symbol from a shared counter; the workers never wait on a file.
+            std::atomic<size_t> nextInput(0);
+            std::vector<std::thread> loaders;
+            for (int t = 0; t < NUM_OF_IO_THREADS && size_t(t) < inputs.size(); t++)
+                loaders.emplace_back([&nextInput, &inputs, &loadSymbol]()
+                                     {
+                                         for (size_t i = nextInput++; i < inputs.size(); i = nextInput++)
+                                             loadSymbol(i);
+                                     });
+            for (size_t t = 0; t < loaders.size(); t++)
+                loaders[t].join();
+        }
+        else
+        {
+            for (size_t i = 0; i < inputs.size(); i++)
+                pool.submit([&loadSymbol, i]()
+                            { loadSymbol(i); });
+        }
+
+        pool.wait();
+        workerStats = pool.getStats();
+
+        if (stdoutSink)
+            stdoutSink->close();
+    }
+
+    // Function 'getLoadReports' returns the rows and malformed rows of each symbol of the last run, in input order.
+
+    const std::vector<SymbolLoadReport> &getLoadReports() const
+    {
+        return loadReports;
+    }
+
+    const std::vector<WorkerStats> &getWorkerStats() const
+    {
+        return workerStats;
+    }
+
+    ~Driver()
+    {
+        if (DEBUG)
+            printMessage("Deconstructing Driver Object");
+    }
+};
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "backtest.h"
+#include "instrumentation.h"
+#include "strategy.h"
+
+// Define an enum named 'FillModel' for how exits are filled.
+enum FillModel
+{
+    FILL_CLOSE_ONLY, // Every trade is entered and exited at the close of the signal bar (the original behaviour).
+    FILL_INTRABAR    // TARGET and STOP_LOSS levels are checked against each bar's open, high and low and filled there.
+};
+
+// Define an enum named 'TieBreak' for which level is assumed hit first when one bar reaches both.
+enum TieBreak
+{
+    TIE_STOP_FIRST,     // Assume the stop loss was hit first (conservative).
+    TIE_TARGET_FIRST,   // Assume the target was hit first (optimistic).
+    TIE_NEAREST_TO_OPEN // Assume the level closer to the bar's open was hit first.
+};
+
+// Define a C++ struct named 'ExecutionSettings' to configure the execution model.
+struct ExecutionSettings
+{
+    FillModel fillModel;     // Stores how exits are filled.
+    TieBreak tieBreak;       // Stores which level wins when a bar reaches both the target and the stop.
+    float slippagePercent;   // Stores the adverse price move applied to every fill, in percent of the price.
+    float commissionPercent; // Stores the commission charged per fill, in percent of the traded value.
+
+    ExecutionSettings()
+        : fillModel(FILL_CLOSE_ONLY), tieBreak(TIE_STOP_FIRST), slippagePercent(0), commissionPercent(0)
+    {
+    }
+
+    // Member function to return whether fills are at the close and free, i.e. the plain signal evaluation applies.
+    bool isCloseOnly() const
+    {
+        return fillModel == FILL_CLOSE_ONLY && slippagePercent == 0 && commissionPercent == 0;
+    }
+
+    // Static functions to parse the --fill and --tie option values; they return false for unknown names.
+    static bool parseFillModel(const std::string &name, FillModel &fillModel)
+    {
+        if (name == "close")
+            fillModel = FILL_CLOSE_ONLY;
+        else if (name == "intrabar")
+            fillModel = FILL_INTRABAR;
+        else
+            return false;
+        return true;
+    }
+
+    static bool parseTieBreak(const std::string &name, TieBreak &tieBreak)
+    {
+        if (name == "stop")
+            tieBreak = TIE_STOP_FIRST;
+        else if (name == "target")
+            tieBreak = TIE_TARGET_FIRST;
+        else if (name == "nearest")
+            tieBreak = TIE_NEAREST_TO_OPEN;
+        else
+            return false;
+        return true;
+    }
+};
+
+// Define a C++ class named 'ExecutionEngine' that evaluates a strategy under an execution model.
+// For TrendFollowingStrategy it runs the trade state machine and the fills in one pass over the open, high, low
+// and close columns: entries and trend-reversal exits still happen at the close, while TARGET and STOP_LOSS are
+// resolved intrabar (a gap through a level fills at the open, otherwise at the level itself). Other strategies
+// are filled at the close of their signal bars. Slippage and commission apply to every fill. Nothing is
+// allocated per trade; the trade list is only filled when the caller asks for it.
+class ExecutionEngine
+{
+    ExecutionSettings settings;
+
+    // Member function to apply slippage to a fill: buys ('direction' 1) pay more, sells ('direction' -1) get less.
+    float fill(float price, int direction) const
+    {
+        return price * (1 + direction * settings.slippagePercent / 100);
+    }
+
+    // Member function to record one closed trade in 'result' (and 'trades' when given).
+    void closeTrade(const Data &data, int entryIndex, int exitIndex, float entryPrice, float exitPrice, int8_t side,
+                    BacktestResult &result, std::vector<TradeRecord> *trades) const
+    {
+        // Each fill pays commission on its own value: buys cost price * (1 + c), sells bring price * (1 - c).
+        // A long earns its net sale proceeds over its entry cost; a short earns its net entry proceeds over the cost
+        // of buying back, i.e. it is measured against the exit, as in Backtest::evaluateSignals.
+        const float commission = settings.commissionPercent / 100;
+        float profit = side == 1 ? Strategy::findPercentageChange(entryPrice * (1 + commission), exitPrice * (1 - commission))
+                                 : Strategy::findPercentageChange(exitPrice * (1 + commission), entryPrice * (1 - commission));
+
+        result.totalProfitPercent += profit;
+        result.totalTrades += 1;
+        if (profit > 0)
+            result.numOfProfitableTrades += 1;
+
+        if (trades)
+        {
+            TradeRecord trade;
+            trade.entryDate = data.dates()[entryIndex];
+            trade.exitDate = data.dates()[exitIndex];
+            trade.entryPrice = entryPrice;
+            trade.exitPrice = exitPrice;
+            trade.profitPercent = profit;
+            trade.side = side;
+            trades->push_back(trade);
+        }
+    }
+
+    // Member function to pick the exit price of an open position on one bar, or return 0 when it stays open.
+    // 'targetLevel' and 'stopLevel' are the prices at which the position's target and stop are reached.
+    float getIntrabarExit(int side, float openPrice, float highPrice, float lowPrice, float targetLevel, float stopLevel) const
+    {
+        if (side == 1)
+        {
+            if (openPrice >= targetLevel || openPrice <= stopLevel)
+                return openPrice; // The bar gapped through a level: the order fills at the open.
+
+            bool hitTarget = highPrice >= targetLevel;
+            bool hitStop = lowPrice <= stopLevel;
+            if (hitTarget && hitStop)
+                return isTargetFirst(targetLevel - openPrice, openPrice - stopLevel) ? targetLevel : stopLevel;
+            return hitTarget ? targetLevel : (hitStop ? stopLevel : 0);
+        }
+
+        if (openPrice <= targetLevel || openPrice >= stopLevel)
+            return openPrice;
+
+        bool hitTarget = lowPrice <= targetLevel;
+        bool hitStop = highPrice >= stopLevel;
+        if (hitTarget && hitStop)
+            return isTargetFirst(openPrice - targetLevel, stopLevel - openPrice) ? targetLevel : stopLevel;
+        return hitTarget ? targetLevel : (hitStop ? stopLevel : 0);
+    }
+
+    // Member function to resolve a bar that reached both levels, given their distances from the open.
+    bool isTargetFirst(float targetDistance, float stopDistance) const
+    {
+        if (settings.tieBreak == TIE_NEAREST_TO_OPEN)
+            return targetDistance < stopDistance;
+        return settings.tieBreak == TIE_TARGET_FIRST;
+    }
+
+public:
+    explicit ExecutionEngine(const ExecutionSettings &settings = ExecutionSettings())
+        : settings(settings)
+    {
+    }
+
+    const ExecutionSettings &getSettings() const
+    {
+        return settings;
+    }
+
+    // Function 'run' evaluates TrendFollowingStrategy with thresholds 'params' on precomputed K-maximum and
+    // K-minimum windows (built with params.lookBackPeriod). With FILL_CLOSE_ONLY and no costs it returns exactly
+    // what Backtest::evaluateSignals returns for the strategy's signals.
+
+    BacktestResult run(const Data &data, const TrendFollowingParams &params, const float *kmax, const float *kmin,
+                       std::vector<TradeRecord> *trades = nullptr) const
+    {
+        TF_PROFILE_SCOPE(EVALUATE);
+
+        const float *openPrices = data.openPrices().data();
+        const float *highPrices = data.highPrices().data();
+        const float *lowPrices = data.lowPrices().data();
+        const float *closePrices = data.closePrices().data();
+        const bool intrabar = settings.fillModel == FILL_INTRABAR;
+
+        BacktestResult result;
+        TrendFollowingStrategy::TradeState state = TrendFollowingStrategy::NO_POSITION;
+        int tradePrice = 0;
+        int entryIndex = 0;
+        float entryPrice = 0, targetLevel = 0, stopLevel = 0;
+
+        for (int i = 0; i < data.numberOfRows; i++)
+        {
+            const float closePrice = closePrices[i];
+
+            if (intrabar && state != TrendFollowingStrategy::NO_POSITION)
+            {
+                const int side = state == TrendFollowingStrategy::LONG_POSITION ? 1 : -1;
+                float exitPrice = getIntrabarExit(side, openPrices[i], highPrices[i], lowPrices[i], targetLevel, stopLevel);
+
+                // Without a target or stop fill, the position still exits at the close on a reverse trend.
+                if (exitPrice == 0)
+                {
+                    int reverseMove = side == 1 ? int(-1 * Strategy::findPercentageChange(kmax[i], closePrice))
+                                                : int(Strategy::findPercentageChange(kmin[i], closePrice));
+                    if (reverseMove >= params.exitTrigger)
+                        exitPrice = closePrice;
+                }
+
+                if (exitPrice != 0)
+                {
+                    closeTrade(data, entryIndex, i, entryPrice, fill(exitPrice, -side), int8_t(side), result, trades);
+                    state = TrendFollowingStrategy::NO_POSITION;
+                }
+                continue; // As in the signal path, a bar that exits or holds a position never enters a new one.
+            }
+
+            int8_t signal = TrendFollowingStrategy::getNextSignal(state, tradePrice, closePrice, kmax[i], kmin[i], params.enterTrigger,
+                                                                  params.exitTrigger, params.targetPercentage, params.stopLoss);
+            if (signal == 1 || signal == 2)
+            {
+                const int side = signal == 1 ? 1 : -1;
+                entryIndex = i;
+                entryPrice = fill(closePrice, side);
+                targetLevel = closePrice * (1 + side * params.targetPercentage / 100.0f);
+                stopLevel = closePrice * (1 - side * params.stopLoss / 100.0f);
+            }
+            else if (signal == -1 || signal == -2)
+            {
+                const int side = signal == -1 ? 1 : -1;
+                closeTrade(data, entryIndex, i, entryPrice, fill(closePrice, -side), int8_t(side), result, trades);
+            }
+        }
+
+        return result;
+    }
+
+    // Function 'evaluateSignals' fills a precomputed signal array at the close of each signal bar, with
+    // slippage and commission. It is used for strategies whose exit levels the engine does not know.
+
+    BacktestResult evaluateSignals(const Data &data, const int8_t *tradeSignals, std::vector<TradeRecord> *trades = nullptr) const
+    {
+        TF_PROFILE_SCOPE(EVALUATE);
+
+        const float *closePrices = data.closePrices().data();
+        BacktestResult result;
+        int entryIndex = 0;
+        float entryPrice = 0;
+
+        for (int i = 0; i < data.numberOfRows; i++)
+        {
+            if (tradeSignals[i] == 1 || tradeSignals[i] == 2)
+            {
+                entryIndex = i;
+                entryPrice = fill(closePrices[i], tradeSignals[i] == 1 ? 1 : -1);
+            }
+            else if (tradeSignals[i] == -1 || tradeSignals[i] == -2)
+            {
+                const int side = tradeSignals[i] == -1 ? 1 : -1;
+                closeTrade(data, entryIndex, i, entryPrice, fill(closePrices[i], -side), int8_t(side), result, trades);
+            }
+        }
+
+        return result;
+    }
+
+    // Function 'evaluate' runs 'strategy' on 'data' under this execution model.
+    // A TrendFollowingStrategy gets the intrabar engine; any other strategy is filled at the close of its signals.
+
+    BacktestResult evaluate(Strategy &strategy, const Data &data, std::vector<TradeRecord> *trades = nullptr) const
+    {
+        TrendFollowingStrategy *trendFollowing = dynamic_cast<TrendFollowingStrategy *>(&strategy);
+        if (trendFollowing)
+        {
+            TrendFollowingParams params = trendFollowing->getParams();
+            float *kmax = ScratchArena::get<float>(ScratchArena::WINDOW_MAX, size_t(data.numberOfRows));
+            float *kmin = ScratchArena::get<float>(ScratchArena::WINDOW_MIN, size_t(data.numberOfRows));
+            TrendFollowingStrategy::getKMaxMin(data, params.lookBackPeriod, kmax, kmin);
+            return run(data, params, kmax, kmin, trades);
+        }
+
+        int8_t *tradeSignals = strategy.getTradeSignals(data);
+        BacktestResult result = evaluateSignals(data, tradeSignals, trades);
+        delete[] tradeSignals;
+        return result;
+    }
+};
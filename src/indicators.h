@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "columns.h"
+#include "data.h"
+#include "instrumentation.h"
+#include "rolling_window.h"
+
+// Define an enum named 'IndicatorKind' for the series an IndicatorGraph can compute. Every kind reads the close
+// column except ATR, which also reads the high and low columns. The first bars use the bars available so far
+// (a partial window), as getKMax/getKMin always have.
+enum IndicatorKind
+{
+    INDICATOR_ROLLING_MAX,   // Maximum close of the last 'period' bars (TrendFollowingStrategy::getKMax).
+    INDICATOR_ROLLING_MIN,   // Minimum close of the last 'period' bars (TrendFollowingStrategy::getKMin).
+    INDICATOR_SMA,           // Simple moving average of the last 'period' closes.
+    INDICATOR_EMA,           // Exponential moving average with alpha 2 / (period + 1), seeded with the first close.
+    INDICATOR_ATR,           // Average true range, Wilder-smoothed over 'period' bars.
+    INDICATOR_PERCENT_CHANGE // Percentage change of the close over 'period' bars (0 for the first 'period' bars).
+};
+
+// Define a C++ class named 'IndicatorGraph' holding the indicator series of one symbol.
+// Strategies first declare the (kind, period) nodes they read; a node declared by several strategies is stored
+// once. 'compute' then builds each declared node exactly once, and strategies read the shared series with 'get'.
+// A rolling maximum and minimum of the same period come out of one fused RollingWindow pass. After 'compute' the
+// graph is read-only, so any number of threads may read it at once.
+class IndicatorGraph
+{
+    // Define a struct named 'Node' for one declared series.
+    struct Node
+    {
+        IndicatorKind kind;
+        int period;
+        int declarations; // Stores how many times the node was declared.
+        bool computed;    // Stores whether 'values' holds the series.
+        std::vector<float, AlignedAllocator<float>> values;
+    };
+
+    const Data &data;
+    std::vector<Node> nodes;
+    std::map<std::pair<int, int>, int> nodeIndices; // Maps (kind, period) to its index in 'nodes'.
+
+    // Member function to return the index of the (kind, period) node, or -1 when it was not declared.
+    int find(IndicatorKind kind, int period) const
+    {
+        std::map<std::pair<int, int>, int>::const_iterator found = nodeIndices.find(std::make_pair(int(kind), period));
+        return found == nodeIndices.end() ? -1 : found->second;
+    }
+
+    // Static function to fill 'sma' with the mean of values[max(0, i - K + 1) .. i] from a running sum.
+    static void computeSma(const float *values, int N, int K, float *sma)
+    {
+        double sum = 0;
+        for (int i = 0; i < N; i++)
+        {
+            sum += values[i];
+            if (i >= K)
+                sum -= values[i - K];
+            sma[i] = float(sum / std::min(i + 1, K));
+        }
+    }
+
+    // Static function to fill 'ema' with the exponential moving average of 'values'.
+    static void computeEma(const float *values, int N, int K, float *ema)
+    {
+        const double alpha = 2.0 / (K + 1);
+        double average = N ? values[0] : 0;
+        for (int i = 0; i < N; i++)
+        {
+            average += alpha * (values[i] - average);
+            ema[i] = float(average);
+        }
+    }
+
+    // Static function to fill 'atr' with the average true range. Until K bars are available it is the plain
+    // mean of the true ranges so far; from then on each bar moves it by (true range - atr) / K (Wilder), applied
+    // as a multiplication so no division sits on the loop's dependency chain.
+    static void computeAtr(const float *highs, const float *lows, const float *closes, int N, int K, float *atr)
+    {
+        const double smoothing = 1.0 / K;
+        double average = 0;
+        for (int i = 0; i < N; i++)
+        {
+            double trueRange = highs[i] - lows[i];
+            if (i > 0)
+                trueRange = std::max(trueRange, std::max(std::fabs(double(highs[i]) - closes[i - 1]), std::fabs(double(lows[i]) - closes[i - 1])));
+            average += i < K ? (trueRange - average) / (i + 1) : (trueRange - average) * smoothing;
+            atr[i] = float(average);
+        }
+    }
+
+    // Static function to fill 'change' with the percentage change of values[i - K] to values[i]
+    // (the formula of Strategy::findPercentageChange).
+    static void computePercentChange(const float *values, int N, int K, float *change)
+    {
+        for (int i = 0; i < N; i++)
+            change[i] = i < K ? 0.0f : ((values[i] - values[i - K]) * 100) / values[i - K];
+    }
+
+    IndicatorGraph(const IndicatorGraph &) = delete;
+    IndicatorGraph &operator=(const IndicatorGraph &) = delete;
+
+public:
+    explicit IndicatorGraph(const Data &data)
+        : data(data)
+    {
+    }
+
+    // Function 'declare' registers the (kind, period) series and returns its node index. Declaring a series that
+    // is already in the graph returns the existing node, so it is computed and stored once however many
+    // strategies read it. Periods below 1 are read as 1.
+    int declare(IndicatorKind kind, int period)
+    {
+        period = std::max(1, period);
+        int index = find(kind, period);
+        if (index >= 0)
+        {
+            TF_PROFILE_COUNT(INDICATORS_SHARED, 1);
+            nodes[size_t(index)].declarations++;
+            return index;
+        }
+
+        Node node;
+        node.kind = kind;
+        node.period = period;
+        node.declarations = 1;
+        node.computed = false;
+        nodes.push_back(node);
+        index = int(nodes.size()) - 1;
+        nodeIndices[std::make_pair(int(kind), period)] = index;
+        return index;
+    }
+
+    // Function 'compute' builds every node declared since the last call; nodes already built are kept.
+
+    void compute()
+    {
+        TF_PROFILE_SCOPE(INDICATORS);
+
+        const int numberOfRows = data.numberOfRows;
+        const float *closePrices = data.closePrices().data();
+
+        for (size_t n = 0; n < nodes.size(); n++)
+        {
+            Node &node = nodes[n];
+            if (node.computed)
+                continue;
+            node.values.resize(size_t(numberOfRows));
+
+            switch (node.kind)
+            {
+            case INDICATOR_ROLLING_MAX:
+            case INDICATOR_ROLLING_MIN:
+            {
+                // Build the max and min of the period together; the partner goes to scratch when it was not declared.
+                const bool isMax = node.kind == INDICATOR_ROLLING_MAX;
+                int partner = find(isMax ? INDICATOR_ROLLING_MIN : INDICATOR_ROLLING_MAX, node.period);
+                float *other;
+                if (partner >= 0 && !nodes[size_t(partner)].computed)
+                {
+                    nodes[size_t(partner)].values.resize(size_t(numberOfRows));
+                    nodes[size_t(partner)].computed = true;
+                    other = nodes[size_t(partner)].values.data();
+                }
+                else
+                    other = ScratchArena::get<float>(isMax ? ScratchArena::WINDOW_MIN : ScratchArena::WINDOW_MAX, size_t(numberOfRows));
+                RollingWindow::compute(closePrices, numberOfRows, node.period, isMax ? node.values.data() : other,
+                                       isMax ? other : node.values.data());
+                break;
+            }
+            case INDICATOR_SMA:
+                computeSma(closePrices, numberOfRows, node.period, node.values.data());
+                break;
+            case INDICATOR_EMA:
+                computeEma(closePrices, numberOfRows, node.period, node.values.data());
+                break;
+            case INDICATOR_ATR:
+                computeAtr(data.highPrices().data(), data.lowPrices().data(), closePrices, numberOfRows, node.period, node.values.data());
+                break;
+            case INDICATOR_PERCENT_CHANGE:
+                computePercentChange(closePrices, numberOfRows, node.period, node.values.data());
+                break;
+            }
+            node.computed = true;
+        }
+    }
+
+    // Function 'get' returns the computed (kind, period) series of data.numberOfRows values, or nullptr when the
+    // series was not declared and computed.
+
+    const float *get(IndicatorKind kind, int period) const
+    {
+        int index = find(kind, std::max(1, period));
+        return index >= 0 && nodes[size_t(index)].computed ? nodes[size_t(index)].values.data() : nullptr;
+    }
+
+    const Data &getData() const
+    {
+        return data;
+    }
+
+    // Function 'getNumOfNodes' returns the number of distinct series in the graph.
+    int getNumOfNodes() const
+    {
+        return int(nodes.size());
+    }
+
+    // Function 'getNumOfDeclarations' returns the number of declarations, shared ones included; compared with
+    // getNumOfNodes it tells how many series computations sharing saved.
+    int getNumOfDeclarations() const
+    {
+        int declarations = 0;
+        for (size_t n = 0; n < nodes.size(); n++)
+            declarations += nodes[n].declarations;
+        return declarations;
+    }
+};
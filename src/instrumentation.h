@@ -0,0 +1,414 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Instrumentation is compiled in unless TF_INSTRUMENTATION is defined to 0 (make INSTRUMENTATION=0). When compiled
+// in, it is still off until Instrumentation::setEnabled(true); a disabled scope costs one relaxed atomic load.
+#ifndef TF_INSTRUMENTATION
+#define TF_INSTRUMENTATION 1
+#endif
+
+// Define a C++ class named 'Instrumentation' that collects per-stage timings and counters from every thread.
+// Each thread writes only to its own ThreadProfile (no locks, no shared cache lines); the profiles are registered
+// once per thread and kept after the thread exits, so the summary and the trace can be built when a run is over.
+// Timings go into log2 nanosecond histograms, and with tracing on every scope is also kept as a trace event
+// (up to MAX_TRACE_EVENTS per thread) for chrome://tracing or Perfetto.
+class Instrumentation
+{
+public:
+    enum Stage
+    {
+        LOAD_DATA = 0,        // Data::loadData (cache lookup, parse, cache store).
+        PARSE_CSV = 1,        // Data::parseData.
+        CACHE_LOAD = 2,       // ColumnCache::load (looking up, validating and mapping the cache file).
+        PROCESS_SYMBOL = 3,   // Driver task loading one symbol and queuing its backtests.
+        PROCESS_STRATEGY = 4, // Driver task running one (symbol, strategy) backtest.
+        TRADE_SIGNALS = 5,    // Strategy::getTradeSignals.
+        EVALUATE = 6,         // Backtest::evaluateSignals and ExecutionEngine.
+        RESULT_PUSH = 7,      // ResultsSink::push on a worker.
+        RESULT_WRITE = 8,     // ResultsSink writer formatting and writing a drained set of batches.
+        LOCK_WAIT = 9,        // Blocking on a contended WorkStealingPool deque lock.
+        RESAMPLE = 10,        // Resampler::load building coarser bars that were not cached.
+        INDICATORS = 11,      // IndicatorGraph::compute building the declared indicator series.
+        NUM_OF_STAGES = 12
+    };
+
+    enum Counter
+    {
+        ROWS_LOADED = 0,      // Rows made available by Data::loadData.
+        CACHE_HITS = 1,       // Loads served by the binary column cache.
+        CACHE_MISSES = 2,     // Loads that had to parse the csv.
+        BACKTESTS = 3,        // Backtests evaluated by the Driver.
+        RESULTS_WRITTEN = 4,  // Result records written by a ResultsSink.
+        LOCK_CONTENTIONS = 5, // Deque lock acquisitions that found the lock taken.
+        INDICATORS_SHARED = 6, // Indicator declarations served by a series another strategy already declared.
+        NUM_OF_COUNTERS = 7
+    };
+
+    static const int NUM_OF_BUCKETS = 48;              // Bucket b holds durations in [2^b, 2^(b+1)) ns.
+    static const size_t MAX_TRACE_EVENTS = 1 << 20;    // Per thread, to bound memory on long runs.
+
+    struct StageStats
+    {
+        long long calls;
+        long long totalNs;
+        long long maxNs;
+        long long histogram[NUM_OF_BUCKETS];
+    };
+
+    struct TraceEvent
+    {
+        int64_t startNs;
+        int64_t durationNs;
+        int stage;
+    };
+
+    struct ThreadProfile
+    {
+        int threadIndex;
+        StageStats stages[NUM_OF_STAGES];
+        long long counters[NUM_OF_COUNTERS];
+        std::vector<TraceEvent> events;
+        long long droppedEvents;
+    };
+
+private:
+    struct Registry
+    {
+        std::mutex registryMutex; // Guards 'profiles' (taken once per thread).
+        std::vector<std::unique_ptr<ThreadProfile>> profiles;
+    };
+
+    static Registry &getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    static std::atomic<bool> &getEnabledFlag()
+    {
+        static std::atomic<bool> enabled(false);
+        return enabled;
+    }
+
+    static std::atomic<bool> &getTracingFlag()
+    {
+        static std::atomic<bool> tracing(false);
+        return tracing;
+    }
+
+    static int getBucket(long long durationNs)
+    {
+        int bucket = 0;
+        while (bucket + 1 < NUM_OF_BUCKETS && (1LL << (bucket + 1)) <= durationNs)
+            bucket++;
+        return bucket;
+    }
+
+    // Static function returning an approximate quantile (the upper bound of the bucket holding it).
+    static double getQuantileNs(const StageStats &stats, double quantile)
+    {
+        long long rank = (long long)(quantile * double(stats.calls - 1)), seen = 0;
+        for (int b = 0; b < NUM_OF_BUCKETS; b++)
+        {
+            seen += stats.histogram[b];
+            if (seen > rank)
+                return std::min(double(stats.maxNs), double(1LL << (b + 1)));
+        }
+        return double(stats.maxNs);
+    }
+
+    // Static function to add up the profiles of every thread.
+    static void mergeProfiles(StageStats *stages, long long *counters, long long &droppedEvents)
+    {
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.registryMutex);
+        std::fill(stages, stages + NUM_OF_STAGES, StageStats());
+        std::fill(counters, counters + NUM_OF_COUNTERS, 0);
+        droppedEvents = 0;
+
+        for (size_t t = 0; t < registry.profiles.size(); t++)
+        {
+            const ThreadProfile &profile = *registry.profiles[t];
+            for (int s = 0; s < NUM_OF_STAGES; s++)
+            {
+                stages[s].calls += profile.stages[s].calls;
+                stages[s].totalNs += profile.stages[s].totalNs;
+                stages[s].maxNs = std::max(stages[s].maxNs, profile.stages[s].maxNs);
+                for (int b = 0; b < NUM_OF_BUCKETS; b++)
+                    stages[s].histogram[b] += profile.stages[s].histogram[b];
+            }
+            for (int c = 0; c < NUM_OF_COUNTERS; c++)
+                counters[c] += profile.counters[c];
+            droppedEvents += profile.droppedEvents;
+        }
+    }
+
+public:
+    static const char *getStageName(int stage)
+    {
+        static const char *names[NUM_OF_STAGES] = {"load_data", "parse_csv", "cache_load", "process_symbol", "process_strategy",
+                                                   "trade_signals", "evaluate", "result_push", "result_write", "lock_wait",
+                                                   "resample", "indicators"};
+        return names[stage];
+    }
+
+    static const char *getCounterName(int counter)
+    {
+        static const char *names[NUM_OF_COUNTERS] = {"rows_loaded", "cache_hits", "cache_misses", "backtests", "results_written",
+                                                     "lock_contentions", "indicators_shared"};
+        return names[counter];
+    }
+
+    static void setEnabled(bool enabled)
+    {
+        getEnabledFlag().store(enabled && TF_INSTRUMENTATION, std::memory_order_relaxed);
+    }
+
+    static bool isEnabled()
+    {
+        return TF_INSTRUMENTATION && getEnabledFlag().load(std::memory_order_relaxed);
+    }
+
+    // Function 'setTracing' also keeps every timed scope as a trace event (enables instrumentation too).
+    static void setTracing(bool tracing)
+    {
+        getTracingFlag().store(tracing && TF_INSTRUMENTATION, std::memory_order_relaxed);
+        if (tracing)
+            setEnabled(true);
+    }
+
+    static bool isTracing()
+    {
+        return getTracingFlag().load(std::memory_order_relaxed);
+    }
+
+    // Static function returning nanoseconds since the first call (the time origin of the trace).
+    static int64_t nowNs()
+    {
+        static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    // Static function returning the calling thread's profile, registering it on first use.
+    static ThreadProfile &getThreadProfile()
+    {
+        static thread_local ThreadProfile *profile = nullptr;
+        if (!profile)
+        {
+            Registry &registry = getRegistry();
+            std::lock_guard<std::mutex> lock(registry.registryMutex);
+            registry.profiles.push_back(std::unique_ptr<ThreadProfile>(new ThreadProfile()));
+            profile = registry.profiles.back().get();
+            profile->threadIndex = int(registry.profiles.size()) - 1;
+        }
+        return *profile;
+    }
+
+    static void record(Stage stage, int64_t startNs, int64_t endNs)
+    {
+        ThreadProfile &profile = getThreadProfile();
+        StageStats &stats = profile.stages[stage];
+        long long durationNs = std::max<long long>(0, endNs - startNs);
+
+        stats.calls++;
+        stats.totalNs += durationNs;
+        stats.maxNs = std::max(stats.maxNs, durationNs);
+        stats.histogram[getBucket(durationNs)]++;
+
+        if (isTracing())
+        {
+            if (profile.events.size() < MAX_TRACE_EVENTS)
+            {
+                TraceEvent event = {startNs, durationNs, int(stage)};
+                profile.events.push_back(event);
+            }
+            else
+            {
+                profile.droppedEvents++;
+            }
+        }
+    }
+
+    static void count(Counter counter, long long amount)
+    {
+        getThreadProfile().counters[counter] += amount;
+    }
+
+    // Function 'reset' clears every thread's statistics and events (call between runs, with no scope open).
+    static void reset()
+    {
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.registryMutex);
+        for (size_t t = 0; t < registry.profiles.size(); t++)
+        {
+            int threadIndex = registry.profiles[t]->threadIndex;
+            *registry.profiles[t] = ThreadProfile();
+            registry.profiles[t]->threadIndex = threadIndex;
+        }
+    }
+
+    // Function 'printSummary' prints one row per stage that ran and every non-zero counter.
+    // Call it once the instrumented work is finished (profiles are read without synchronizing with their threads).
+
+    static void printSummary(std::ostream &out)
+    {
+        StageStats stages[NUM_OF_STAGES];
+        long long counters[NUM_OF_COUNTERS], droppedEvents;
+        mergeProfiles(stages, counters, droppedEvents);
+
+        char line[160];
+        snprintf(line, sizeof(line), "%-17s %10s %12s %11s %11s %11s %11s\n", "stage", "calls", "total ms", "mean us", "p50 us", "p99 us", "max us");
+        out << "\n" << line;
+        for (int s = 0; s < NUM_OF_STAGES; s++)
+        {
+            const StageStats &stats = stages[s];
+            if (!stats.calls)
+                continue;
+            snprintf(line, sizeof(line), "%-17s %10lld %12.3f %11.2f %11.2f %11.2f %11.2f\n", getStageName(s), stats.calls, stats.totalNs / 1e6,
+                     stats.totalNs / 1e3 / stats.calls, getQuantileNs(stats, 0.5) / 1e3, getQuantileNs(stats, 0.99) / 1e3, stats.maxNs / 1e3);
+            out << line;
+        }
+
+        for (int c = 0; c < NUM_OF_COUNTERS; c++)
+        {
+            if (counters[c])
+                out << getCounterName(c) << ": " << counters[c] << "\n";
+        }
+        if (droppedEvents)
+            out << "trace events dropped: " << droppedEvents << "\n";
+        out.flush();
+    }
+
+    // Function 'writeTrace' writes the trace events of every thread in the Chrome trace-event JSON format
+    // (one "X" complete event per scope, one track per thread).
+
+    static bool writeTrace(const std::string &fileName)
+    {
+        std::ofstream fout(fileName.c_str());
+        if (!fout)
+            return false;
+
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.registryMutex);
+        fout << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        char line[192];
+
+        for (size_t t = 0; t < registry.profiles.size(); t++)
+        {
+            const ThreadProfile &profile = *registry.profiles[t];
+            snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                     first ? "" : ",\n", profile.threadIndex, profile.threadIndex);
+            fout << line;
+            first = false;
+
+            for (size_t e = 0; e < profile.events.size(); e++)
+            {
+                const TraceEvent &event = profile.events[e];
+                snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         getStageName(event.stage), profile.threadIndex, event.startNs / 1e3, event.durationNs / 1e3);
+                fout << line;
+            }
+        }
+
+        fout << "\n]}\n";
+        return bool(fout);
+    }
+};
+
+#if TF_INSTRUMENTATION
+
+// Define a C++ class named 'ScopedTimer' that records the time between its construction and destruction.
+class ScopedTimer
+{
+    Instrumentation::Stage stage;
+    int64_t startNs;
+    bool active;
+
+public:
+    explicit ScopedTimer(Instrumentation::Stage stage)
+        : stage(stage), startNs(0), active(Instrumentation::isEnabled())
+    {
+        if (active)
+            startNs = Instrumentation::nowNs();
+    }
+
+    ~ScopedTimer()
+    {
+        if (active)
+            Instrumentation::record(stage, startNs, Instrumentation::nowNs());
+    }
+};
+
+// Define a C++ class named 'ContendedLockGuard', a lock_guard that counts and times acquisitions that had to wait.
+// An uncontended acquisition is a single try_lock.
+class ContendedLockGuard
+{
+    std::mutex &guardedMutex;
+
+public:
+    explicit ContendedLockGuard(std::mutex &guardedMutex)
+        : guardedMutex(guardedMutex)
+    {
+        if (guardedMutex.try_lock())
+            return;
+
+        if (!Instrumentation::isEnabled())
+        {
+            guardedMutex.lock();
+            return;
+        }
+
+        Instrumentation::count(Instrumentation::LOCK_CONTENTIONS, 1);
+        ScopedTimer timer(Instrumentation::LOCK_WAIT);
+        guardedMutex.lock();
+    }
+
+    ~ContendedLockGuard()
+    {
+        guardedMutex.unlock();
+    }
+
+    ContendedLockGuard(const ContendedLockGuard &) = delete;
+    ContendedLockGuard &operator=(const ContendedLockGuard &) = delete;
+};
+
+#define TF_PROFILE_CONCAT_INNER(a, b) a##b
+#define TF_PROFILE_CONCAT(a, b) TF_PROFILE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope as 'stage' (an Instrumentation::Stage name).
+#define TF_PROFILE_SCOPE(stage) ScopedTimer TF_PROFILE_CONCAT(profileScope, __LINE__)(Instrumentation::stage)
+
+// Adds 'amount' to 'counter' (an Instrumentation::Counter name) on the calling thread.
+#define TF_PROFILE_COUNT(counter, amount)                                       \
+    do                                                                          \
+    {                                                                           \
+        if (Instrumentation::isEnabled())                                       \
+            Instrumentation::count(Instrumentation::counter, (long long)(amount)); \
+    } while (0)
+
+#else
+
+typedef std::lock_guard<std::mutex> ContendedLockGuard;
+
+#define TF_PROFILE_SCOPE(stage) \
+    do                          \
+    {                           \
+    } while (0)
+#define TF_PROFILE_COUNT(counter, amount) \
+    do                                    \
+    {                                     \
+    } while (0)
+
+#endif
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "backtest.h"
+#include "data.h"
+#include "instrumentation.h"
+#include "strategy.h"
+
+// Define a C++ struct named 'PerformanceMetrics' to store the risk and performance statistics of one backtest.
+// Returns are measured on an equity curve that starts at 1 and puts the whole account into each trade: a long is
+// worth entry equity * close / entry price and a short entry equity * entry price / close, so every closed trade
+// moves equity by exactly its profitPercent (shorts are measured against the exit price, as in Backtest).
+struct PerformanceMetrics
+{
+    BacktestResult trades;         // Stores the trade statistics, identical to Backtest::evaluateSignals.
+    double finalEquity;            // Stores the equity after the last bar (open positions marked at the last close).
+    double totalReturnPercent;     // Stores the compounded return of the equity curve.
+    double cagrPercent;            // Stores the compound annual growth rate.
+    double sharpe;                 // Stores the annualized mean / standard deviation of per-bar returns (no risk-free rate).
+    double sortino;                // Stores the annualized mean / downside deviation of per-bar returns.
+    double maxDrawdownPercent;     // Stores the largest peak-to-trough fall of the equity curve.
+    int maxDrawdownBars;           // Stores the longest number of bars spent below a previous equity peak.
+    double maxDrawdownDays;        // Stores that same longest drawdown in calendar days.
+    double profitFactor;           // Stores gross profit / gross loss of the closed trades (infinity without losses).
+    double exposurePercent;        // Stores the share of bars spent in a position.
+    double averageTradeBars;       // Stores the average number of bars a closed trade was held.
+    int maxTradeBars;              // Stores the longest number of bars a closed trade was held.
+    double years;                  // Stores the calendar span of the data in years.
+
+    PerformanceMetrics()
+        : finalEquity(1), totalReturnPercent(0), cagrPercent(0), sharpe(0), sortino(0), maxDrawdownPercent(0), maxDrawdownBars(0),
+          maxDrawdownDays(0), profitFactor(0), exposurePercent(0), averageTradeBars(0), maxTradeBars(0), years(0)
+    {
+    }
+
+    // Member function to return the CAGR divided by the maximum drawdown (0 without a drawdown).
+    double calmar() const
+    {
+        return maxDrawdownPercent > 0 ? cagrPercent / maxDrawdownPercent : 0;
+    }
+};
+
+// Define an enum named 'MetricsRank' for the statistic a sweep ranks its results by.
+enum MetricsRank
+{
+    RANK_PROFIT,        // Total profit percentage, then average profit (the original ranking; needs no metrics).
+    RANK_SHARPE,
+    RANK_SORTINO,
+    RANK_CAGR,
+    RANK_CALMAR,
+    RANK_PROFIT_FACTOR
+};
+
+// Define a C++ class named 'MetricsEngine' that computes PerformanceMetrics in one fused pass over the signal and
+// close columns. Every statistic is a running accumulator (equity, peak, sums of returns and squared returns,
+// gross profit and loss, bar counts), so nothing is stored per trade and nothing is allocated. The optional
+// 'equityCurve' output receives the equity at every bar.
+class MetricsEngine
+{
+    // Function 'compute' is the shared pass. 'nextSignal(i)' returns the signal of bar i, in order.
+
+    template <typename NextSignal>
+    static PerformanceMetrics compute(const Data &data, NextSignal nextSignal, double *equityCurve)
+    {
+        TF_PROFILE_SCOPE(EVALUATE);
+
+        PerformanceMetrics metrics;
+        const int numberOfRows = data.numberOfRows;
+        if (numberOfRows == 0)
+            return metrics;
+
+        const float *closePrices = data.closePrices().data();
+        const int64_t *dates = data.dates().data();
+
+        float openPrice = 0;           // Stores the entry close of the open trade (as Backtest::evaluateSignals).
+        int side = 0;                  // Stores 1 while long, -1 while short, 0 when flat.
+        int entryIndex = 0;
+        double entryEquity = 1, equity = 1, previousEquity = 1;
+        double peak = 1;
+        int peakIndex = 0;
+        double returnSum = 0, returnSquareSum = 0, downsideSquareSum = 0;
+        double grossProfit = 0, grossLoss = 0;
+        long long barsInMarket = 0, tradeBars = 0;
+
+        for (int i = 0; i < numberOfRows; i++)
+        {
+            const float closePrice = closePrices[i];
+            const int8_t signal = nextSignal(i);
+
+            // Mark the position held through this bar to its close.
+            if (side)
+            {
+                barsInMarket++;
+                equity = side == 1 ? entryEquity * closePrice / openPrice : entryEquity * openPrice / closePrice;
+            }
+
+            if (signal == 1 || signal == 2)
+            {
+                side = signal == 1 ? 1 : -1;
+                openPrice = closePrice;
+                entryIndex = i;
+                entryEquity = equity;
+            }
+            else if ((signal == -1 || signal == -2) && side)
+            {
+                // Same accounting as Backtest::evaluateSignals, so 'trades' matches it bit for bit.
+                float profit = side == 1 ? Strategy::findPercentageChange(openPrice, closePrice)
+                                         : Strategy::findPercentageChange(closePrice, openPrice);
+                metrics.trades.totalProfitPercent += profit;
+                metrics.trades.totalTrades += 1;
+                if (profit > 0)
+                {
+                    metrics.trades.numOfProfitableTrades += 1;
+                    grossProfit += profit;
+                }
+                else
+                    grossLoss -= profit;
+
+                int heldBars = i - entryIndex;
+                tradeBars += heldBars;
+                metrics.maxTradeBars = std::max(metrics.maxTradeBars, heldBars);
+                side = 0;
+            }
+
+            if (i > 0)
+            {
+                double barReturn = equity / previousEquity - 1;
+                returnSum += barReturn;
+                returnSquareSum += barReturn * barReturn;
+                if (barReturn < 0)
+                    downsideSquareSum += barReturn * barReturn;
+            }
+            previousEquity = equity;
+
+            if (equity >= peak)
+            {
+                peak = equity;
+                peakIndex = i;
+            }
+            else
+            {
+                metrics.maxDrawdownPercent = std::max(metrics.maxDrawdownPercent, (1 - equity / peak) * 100);
+                if (i - peakIndex > metrics.maxDrawdownBars)
+                {
+                    metrics.maxDrawdownBars = i - peakIndex;
+                    metrics.maxDrawdownDays = double(dates[i] - dates[peakIndex]) / 86400;
+                }
+            }
+
+            if (equityCurve)
+                equityCurve[i] = equity;
+        }
+
+        // Annualize with the bar frequency of the data itself, so daily, weekly and intraday bars all work.
+        const int returns = numberOfRows - 1;
+        metrics.years = double(dates[numberOfRows - 1] - dates[0]) / (365.25 * 86400);
+        double periodsPerYear = metrics.years > 0 ? returns / metrics.years : 252;
+
+        metrics.finalEquity = equity;
+        metrics.totalReturnPercent = (equity - 1) * 100;
+        metrics.cagrPercent = metrics.years > 0 && equity > 0 ? (std::pow(equity, 1 / metrics.years) - 1) * 100 : 0;
+
+        if (returns > 1)
+        {
+            double mean = returnSum / returns;
+            double variance = std::max(0.0, (returnSquareSum - returnSum * mean) / (returns - 1));
+            double downside = std::sqrt(downsideSquareSum / returns);
+            metrics.sharpe = variance > 0 ? mean / std::sqrt(variance) * std::sqrt(periodsPerYear) : 0;
+            metrics.sortino = downside > 0 ? mean / downside * std::sqrt(periodsPerYear) : 0;
+        }
+
+        metrics.profitFactor = grossLoss > 0 ? grossProfit / grossLoss : (grossProfit > 0 ? std::numeric_limits<double>::infinity() : 0);
+        metrics.exposurePercent = 100.0 * double(barsInMarket) / numberOfRows;
+        metrics.averageTradeBars = metrics.trades.totalTrades ? double(tradeBars) / metrics.trades.totalTrades : 0;
+        return metrics;
+    }
+
+public:
+    // Function 'computeSignals' computes the metrics of a precomputed signal array (any Strategy).
+
+    static PerformanceMetrics computeSignals(const Data &data, const int8_t *tradeSignals, double *equityCurve = nullptr)
+    {
+        return compute(data, [tradeSignals](int i)
+                       { return tradeSignals[i]; },
+                       equityCurve);
+    }
+
+    // Function 'computeTrendFollowing' runs the TrendFollowingStrategy state machine inside the same pass, on
+    // K-maximum and K-minimum windows built with params.lookBackPeriod, so a sweep gets the metrics of every
+    // parameter set without materializing its signals.
+
+    static PerformanceMetrics computeTrendFollowing(const Data &data, const TrendFollowingParams &params, const float *kmax, const float *kmin,
+                                                    double *equityCurve = nullptr)
+    {
+        const float *closePrices = data.closePrices().data();
+        TrendFollowingStrategy::TradeState state = TrendFollowingStrategy::NO_POSITION;
+        int tradePrice = 0;
+
+        return compute(data, [&](int i)
+                       { return TrendFollowingStrategy::getNextSignal(state, tradePrice, closePrices[i], kmax[i], kmin[i], params.enterTrigger,
+                                                                      params.exitTrigger, params.targetPercentage, params.stopLoss); },
+                       equityCurve);
+    }
+
+    // Static function to parse the --rank option value; returns false for unknown names.
+    static bool parseRank(const std::string &name, MetricsRank &rank)
+    {
+        static const char *names[] = {"profit", "sharpe", "sortino", "cagr", "calmar", "profit-factor"};
+        for (int r = 0; r <= RANK_PROFIT_FACTOR; r++)
+        {
+            if (name == names[r])
+            {
+                rank = MetricsRank(r);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Static function to return the statistic 'rank' orders results by (higher is better).
+    static double getRankValue(const PerformanceMetrics &metrics, MetricsRank rank)
+    {
+        switch (rank)
+        {
+        case RANK_SHARPE:
+            return metrics.sharpe;
+        case RANK_SORTINO:
+            return metrics.sortino;
+        case RANK_CAGR:
+            return metrics.cagrPercent;
+        case RANK_CALMAR:
+            return metrics.calmar();
+        case RANK_PROFIT_FACTOR:
+            return metrics.profitFactor;
+        default:
+            return metrics.trades.totalProfitPercent;
+        }
+    }
+};
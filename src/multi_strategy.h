@@ -0,0 +1,427 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "backtest.h"
+#include "batch_signals.h"
+#include "data.h"
+#include "indicators.h"
+#include "instrumentation.h"
+#include "strategy.h"
+
+// Define a C++ struct named 'SignalWriter' that stores the signals a strategy's loop produces into an array.
+// The loops only report non-zero signals, so the array must be zeroed first.
+struct SignalWriter
+{
+    int8_t *signals;
+
+    void operator()(int i, int8_t signal)
+    {
+        signals[i] = signal;
+    }
+};
+
+// Define a C++ struct named 'SignalEvaluator' that applies the accounting of Backtest::evaluateSignals to signals as
+// a strategy's loop produces them, with the same float operations in the same order, so evaluating inside the
+// loop gives bitwise the same BacktestResult as storing the signals and evaluating them afterwards.
+struct SignalEvaluator
+{
+    const float *closePrices;
+    float openPrice; // Stores the close of the open trade's entry bar.
+    BacktestResult result;
+
+    explicit SignalEvaluator(const Data &data)
+        : closePrices(data.closePrices().data()), openPrice(0)
+    {
+    }
+
+    void operator()(int i, int8_t signal)
+    {
+        if (signal == 1 || signal == 2)
+        {
+            openPrice = closePrices[i];
+            return;
+        }
+
+        // A long gains close/open, a short gains open/close (measured against the exit, as Backtest does).
+        float profit = signal == -1 ? Strategy::findPercentageChange(openPrice, closePrices[i])
+                                    : Strategy::findPercentageChange(closePrices[i], openPrice);
+        result.totalProfitPercent += profit;
+        result.totalTrades += 1;
+        if (profit > 0)
+            result.numOfProfitableTrades += 1;
+    }
+};
+
+// Define a C++ class named 'FusedIndicatorStrategy' for IndicatorStrategies that can also backtest themselves inside
+// their signal loop. Subclasses write the loop once as a template 'run(graph, emit)' that calls emit(i, signal) for
+// every non-zero signal; computeSignals runs it with a SignalWriter and evaluate with a SignalEvaluator.
+class FusedIndicatorStrategy : public IndicatorStrategy
+{
+public:
+    // Pure virtual function to backtest the strategy on graph.getData() without storing its signals.
+    virtual BacktestResult evaluate(const IndicatorGraph &graph) const = 0;
+};
+
+// Define a C++ class named 'MovingAverageCrossStrategy' that goes long while a fast moving average is above a
+// slow one: it buys when the fast average closes above the slow one and sells when it closes below it.
+// EXPONENTIAL selects EMAs instead of SMAs.
+class MovingAverageCrossStrategy : public FusedIndicatorStrategy
+{
+    IndicatorKind getKind() const
+    {
+        return strategyParams.find("EXPONENTIAL")->second ? INDICATOR_EMA : INDICATOR_SMA;
+    }
+
+    template <typename Emit>
+    void run(const IndicatorGraph &graph, Emit &emit) const
+    {
+        const float *fast = graph.get(getKind(), strategyParams.find("FAST_PERIOD")->second);
+        const float *slow = graph.get(getKind(), strategyParams.find("SLOW_PERIOD")->second);
+        const int numberOfRows = graph.getData().numberOfRows;
+        bool isLong = false;
+
+        for (int i = 0; i < numberOfRows; i++)
+        {
+            if (!isLong && fast[i] > slow[i])
+            {
+                isLong = true;
+                emit(i, 1);
+            }
+            else if (isLong && fast[i] < slow[i])
+            {
+                isLong = false;
+                emit(i, -1);
+            }
+        }
+    }
+
+public:
+    MovingAverageCrossStrategy(std::string strategyName, int fastPeriod, int slowPeriod, bool exponential)
+    {
+        this->strategyName = strategyName;
+        strategyParams["FAST_PERIOD"] = fastPeriod;
+        strategyParams["SLOW_PERIOD"] = slowPeriod;
+        strategyParams["EXPONENTIAL"] = exponential ? 1 : 0;
+    }
+
+    void declareIndicators(IndicatorGraph &graph) const
+    {
+        graph.declare(getKind(), strategyParams.find("FAST_PERIOD")->second);
+        graph.declare(getKind(), strategyParams.find("SLOW_PERIOD")->second);
+    }
+
+    void computeSignals(const IndicatorGraph &graph, int8_t *signals) const
+    {
+        std::fill(signals, signals + graph.getData().numberOfRows, int8_t(0));
+        SignalWriter writer = {signals};
+        run(graph, writer);
+    }
+
+    BacktestResult evaluate(const IndicatorGraph &graph) const
+    {
+        SignalEvaluator evaluator(graph.getData());
+        run(graph, evaluator);
+        return evaluator.result;
+    }
+};
+
+// Define a C++ class named 'ChannelBreakoutStrategy' that enters on a close at a new CHANNEL_PERIOD high (long)
+// or low (short) and exits on an ATR trailing stop: ATR_MULTIPLE average true ranges below the highest close
+// since a long entry, or above the lowest close since a short entry. Its channel is the rolling maximum and
+// minimum a TrendFollowingStrategy with the same lookback reads.
+class ChannelBreakoutStrategy : public FusedIndicatorStrategy
+{
+    template <typename Emit>
+    void run(const IndicatorGraph &graph, Emit &emit) const
+    {
+        const int channelPeriod = strategyParams.find("CHANNEL_PERIOD")->second;
+        const float atrMultiple = float(strategyParams.find("ATR_MULTIPLE")->second);
+        const float *kmax = graph.get(INDICATOR_ROLLING_MAX, channelPeriod);
+        const float *kmin = graph.get(INDICATOR_ROLLING_MIN, channelPeriod);
+        const float *atr = graph.get(INDICATOR_ATR, strategyParams.find("ATR_PERIOD")->second);
+        const float *closePrices = graph.getData().closePrices().data();
+        const int numberOfRows = graph.getData().numberOfRows;
+        int side = 0;      // Stores 1 while long, -1 while short, 0 when flat.
+        float extreme = 0; // Stores the highest close since a long entry or the lowest since a short entry.
+
+        for (int i = 0; i < numberOfRows; i++)
+        {
+            const float closePrice = closePrices[i];
+
+            // The first bars have no channel yet: kmax and kmin are both the close.
+            if (side == 0 && i >= channelPeriod)
+            {
+                if (closePrice >= kmax[i])
+                {
+                    side = 1;
+                    extreme = closePrice;
+                    emit(i, 1);
+                }
+                else if (closePrice <= kmin[i])
+                {
+                    side = -1;
+                    extreme = closePrice;
+                    emit(i, 2);
+                }
+            }
+            else if (side == 1)
+            {
+                extreme = std::max(extreme, closePrice);
+                if (closePrice < extreme - atrMultiple * atr[i])
+                {
+                    side = 0;
+                    emit(i, -1);
+                }
+            }
+            else if (side == -1)
+            {
+                extreme = std::min(extreme, closePrice);
+                if (closePrice > extreme + atrMultiple * atr[i])
+                {
+                    side = 0;
+                    emit(i, -2);
+                }
+            }
+        }
+    }
+
+public:
+    ChannelBreakoutStrategy(std::string strategyName, int channelPeriod, int atrPeriod, int atrMultiple)
+    {
+        this->strategyName = strategyName;
+        strategyParams["CHANNEL_PERIOD"] = channelPeriod;
+        strategyParams["ATR_PERIOD"] = atrPeriod;
+        strategyParams["ATR_MULTIPLE"] = atrMultiple;
+    }
+
+    void declareIndicators(IndicatorGraph &graph) const
+    {
+        graph.declare(INDICATOR_ROLLING_MAX, strategyParams.find("CHANNEL_PERIOD")->second);
+        graph.declare(INDICATOR_ROLLING_MIN, strategyParams.find("CHANNEL_PERIOD")->second);
+        graph.declare(INDICATOR_ATR, strategyParams.find("ATR_PERIOD")->second);
+    }
+
+    void computeSignals(const IndicatorGraph &graph, int8_t *signals) const
+    {
+        std::fill(signals, signals + graph.getData().numberOfRows, int8_t(0));
+        SignalWriter writer = {signals};
+        run(graph, writer);
+    }
+
+    BacktestResult evaluate(const IndicatorGraph &graph) const
+    {
+        SignalEvaluator evaluator(graph.getData());
+        run(graph, evaluator);
+        return evaluator.result;
+    }
+};
+
+// Define a C++ class named 'MomentumStrategy' that goes long when the close has risen at least THRESHOLD_PERCENTAGE
+// over MOMENTUM_PERIOD bars and short when it has fallen that much, exiting once the change turns the other way.
+class MomentumStrategy : public FusedIndicatorStrategy
+{
+    template <typename Emit>
+    void run(const IndicatorGraph &graph, Emit &emit) const
+    {
+        const float *change = graph.get(INDICATOR_PERCENT_CHANGE, strategyParams.find("MOMENTUM_PERIOD")->second);
+        const float threshold = float(strategyParams.find("THRESHOLD_PERCENTAGE")->second);
+        const int numberOfRows = graph.getData().numberOfRows;
+        int side = 0; // Stores 1 while long, -1 while short, 0 when flat.
+
+        for (int i = 0; i < numberOfRows; i++)
+        {
+            if (side == 0 && change[i] >= threshold)
+            {
+                side = 1;
+                emit(i, 1);
+            }
+            else if (side == 0 && change[i] <= -threshold)
+            {
+                side = -1;
+                emit(i, 2);
+            }
+            else if (side == 1 && change[i] < 0)
+            {
+                side = 0;
+                emit(i, -1);
+            }
+            else if (side == -1 && change[i] > 0)
+            {
+                side = 0;
+                emit(i, -2);
+            }
+        }
+    }
+
+public:
+    MomentumStrategy(std::string strategyName, int momentumPeriod, int thresholdPercentage)
+    {
+        this->strategyName = strategyName;
+        strategyParams["MOMENTUM_PERIOD"] = momentumPeriod;
+        strategyParams["THRESHOLD_PERCENTAGE"] = thresholdPercentage;
+    }
+
+    void declareIndicators(IndicatorGraph &graph) const
+    {
+        graph.declare(INDICATOR_PERCENT_CHANGE, strategyParams.find("MOMENTUM_PERIOD")->second);
+    }
+
+    void computeSignals(const IndicatorGraph &graph, int8_t *signals) const
+    {
+        std::fill(signals, signals + graph.getData().numberOfRows, int8_t(0));
+        SignalWriter writer = {signals};
+        run(graph, writer);
+    }
+
+    BacktestResult evaluate(const IndicatorGraph &graph) const
+    {
+        SignalEvaluator evaluator(graph.getData());
+        run(graph, evaluator);
+        return evaluator.result;
+    }
+};
+
+// Define a C++ class named 'MultiStrategyRunner' that backtests a list of strategies on one symbol together.
+// Every IndicatorStrategy declares its series on one IndicatorGraph, which computes each distinct series once.
+// The strategies then share their loops as well:
+// - TrendFollowingStrategies with the same lookback run as BatchSignals lanes, one pass over the graph's rolling
+//   max/min for up to 8 of them, evaluated inside the pass.
+// - FusedIndicatorStrategies evaluate inside their own signal loop; no signal array is written or read back.
+// - Other strategies, and every strategy when the trade lists are wanted, write their signals into one reused
+//   buffer (their own getTradeSignals outside the graph) and are evaluated by Backtest::evaluateSignals.
+// Every path gives bitwise the same results as backtesting each strategy on its own, in strategy order.
+class MultiStrategyRunner
+{
+    typedef BatchSignals<8> BatchLanes;
+    typedef BatchSignals<NativeLanes::WIDTH> NarrowLanes; // Stores one SIMD register of lanes for small groups.
+
+    std::vector<Strategy *> strategies;
+
+    // Static function to backtest the TrendFollowingStrategies 'members' (indices into 'trendFollowing'), which share
+    // one lookback, in BatchSignals lanes over the graph's windows, writing their results.
+    static void evaluateTrendFollowingGroup(const IndicatorGraph &graph, int lookBackPeriod, const std::vector<size_t> &members,
+                                            const std::vector<TrendFollowingStrategy *> &trendFollowing, std::vector<BacktestResult> &results)
+    {
+        const float *kmax = graph.get(INDICATOR_ROLLING_MAX, lookBackPeriod);
+        const float *kmin = graph.get(INDICATOR_ROLLING_MIN, lookBackPeriod);
+        ThresholdSet sets[BatchLanes::NUM_OF_LANES];
+        BacktestResult batchResults[BatchLanes::NUM_OF_LANES];
+
+        for (size_t batchBegin = 0; batchBegin < members.size(); batchBegin += BatchLanes::NUM_OF_LANES)
+        {
+            int count = int(std::min(members.size() - batchBegin, size_t(BatchLanes::NUM_OF_LANES)));
+            for (int lane = 0; lane < count; lane++)
+            {
+                TrendFollowingParams params = trendFollowing[members[batchBegin + size_t(lane)]]->getParams();
+                ThresholdSet set = {params.enterTrigger, params.exitTrigger, params.targetPercentage, params.stopLoss};
+                sets[lane] = set;
+            }
+
+            if (count <= NarrowLanes::NUM_OF_LANES)
+                NarrowLanes::evaluate(graph.getData(), kmax, kmin, sets, count, batchResults);
+            else
+                BatchLanes::evaluate(graph.getData(), kmax, kmin, sets, count, batchResults);
+            for (int lane = 0; lane < count; lane++)
+                results[members[batchBegin + size_t(lane)]] = batchResults[lane];
+        }
+    }
+
+public:
+    explicit MultiStrategyRunner(const std::vector<Strategy *> &strategies)
+        : strategies(strategies)
+    {
+    }
+
+    // Function 'run' backtests every strategy on graph.getData(), declaring and computing the strategies' series
+    // on 'graph' (which may already hold series of its own). When 'trades' is given, trades[s] receives the
+    // closed trades of strategy s.
+
+    std::vector<BacktestResult> run(IndicatorGraph &graph, std::vector<std::vector<TradeRecord>> *trades = nullptr) const
+    {
+        const Data &data = graph.getData();
+        std::vector<IndicatorStrategy *> indicatorStrategies(strategies.size());
+        std::vector<TrendFollowingStrategy *> trendFollowing(strategies.size());
+        for (size_t s = 0; s < strategies.size(); s++)
+        {
+            indicatorStrategies[s] = dynamic_cast<IndicatorStrategy *>(strategies[s]);
+            trendFollowing[s] = dynamic_cast<TrendFollowingStrategy *>(strategies[s]);
+            if (indicatorStrategies[s])
+                indicatorStrategies[s]->declareIndicators(graph);
+        }
+        graph.compute();
+
+        std::vector<BacktestResult> results(strategies.size());
+        std::vector<bool> evaluated(strategies.size(), false);
+
+        // Without trade lists, evaluate inside the shared loops: group the trend followers by lookback for the SIMD
+        // lanes and let fused strategies evaluate as they go.
+        if (!trades)
+        {
+            TF_PROFILE_SCOPE(EVALUATE);
+
+            std::map<int, std::vector<size_t>> lookbackGroups;
+            for (size_t s = 0; s < strategies.size(); s++)
+            {
+                if (trendFollowing[s])
+                    lookbackGroups[std::max(1, trendFollowing[s]->getParams().lookBackPeriod)].push_back(s);
+            }
+            for (std::map<int, std::vector<size_t>>::const_iterator group = lookbackGroups.begin(); group != lookbackGroups.end(); ++group)
+            {
+                evaluateTrendFollowingGroup(graph, group->first, group->second, trendFollowing, results);
+                for (size_t m = 0; m < group->second.size(); m++)
+                    evaluated[group->second[m]] = true;
+            }
+
+            for (size_t s = 0; s < strategies.size(); s++)
+            {
+                const FusedIndicatorStrategy *fused = dynamic_cast<const FusedIndicatorStrategy *>(strategies[s]);
+                if (!evaluated[s] && fused)
+                {
+                    results[s] = fused->evaluate(graph);
+                    evaluated[s] = true;
+                }
+            }
+        }
+
+        if (trades)
+            trades->assign(strategies.size(), std::vector<TradeRecord>());
+        std::vector<int8_t> signals;
+
+        for (size_t s = 0; s < strategies.size(); s++)
+        {
+            if (evaluated[s])
+                continue;
+
+            std::vector<TradeRecord> *tradesOut = trades ? &(*trades)[s] : nullptr;
+            if (indicatorStrategies[s])
+            {
+                signals.resize(size_t(data.numberOfRows));
+                {
+                    TF_PROFILE_SCOPE(TRADE_SIGNALS);
+                    indicatorStrategies[s]->computeSignals(graph, signals.data());
+                }
+                results[s] = Backtest::evaluateSignals(data, signals.data(), tradesOut);
+            }
+            else
+            {
+                int8_t *ownSignals = strategies[s]->getTradeSignals(data);
+                results[s] = Backtest::evaluateSignals(data, ownSignals, tradesOut);
+                delete[] ownSignals;
+            }
+        }
+        return results;
+    }
+
+    // Overload of 'run' on a graph of its own.
+
+    std::vector<BacktestResult> run(const Data &data, std::vector<std::vector<TradeRecord>> *trades = nullptr) const
+    {
+        IndicatorGraph graph(data);
+        return run(graph, trades);
+    }
+};
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "data.h"
+#include "resample.h"
+#include "strategy.h"
+#include "thread_pool.h"
+
+// Define a C++ struct named 'PortfolioSettings' to configure the shared cash account.
+struct PortfolioSettings
+{
+    double initialCapital;   // Stores the starting cash.
+    double positionFraction; // Stores the fraction of current equity committed to each new position.
+    int maxPositions;        // Stores the maximum number of positions open at the same time.
+
+    PortfolioSettings()
+        : initialCapital(100000), positionFraction(0.1), maxPositions(10)
+    {
+    }
+};
+
+// Define a C++ struct named 'EquityPoint' to store the account state at the end of one date.
+struct EquityPoint
+{
+    int64_t date;      // Stores the date (seconds since the Unix epoch).
+    double equity;     // Stores cash plus the marked value of every open position.
+    double cash;       // Stores the uncommitted cash.
+    int openPositions; // Stores the number of open positions.
+};
+
+// Define a C++ struct named 'PortfolioSummary' to store the totals of a portfolio run.
+struct PortfolioSummary
+{
+    double finalEquity;
+    double totalReturnPercent;
+    double maxDrawdownPercent;
+    int tradesTaken;       // Stores the number of entries that were filled.
+    int tradesClosed;      // Stores the number of positions that were closed.
+    int entriesRejected;   // Stores the entry signals skipped for lack of cash or position slots.
+    int maxOpenPositions;  // Stores the peak number of concurrent positions.
+    int openPositionsAtEnd; // Stores the positions still open (marked at their last close) after the last bar.
+    long long eventsMerged; // Stores the number of events that went through the merge.
+};
+
+// Define a C++ class named 'PortfolioBacktest' that trades every symbol's signals out of one shared cash account.
+// Each symbol's signals are turned into a sparse list of entry rows. A k-way merge (a min-heap holding one cursor
+// per symbol) then walks all series in date order. An idle symbol's cursor jumps straight to its next entry
+// signal; a symbol with an open position steps bar by bar so the position is marked to market.
+// The merge therefore never builds a symbol x date matrix. Its cost is
+// O((entry signals + bars spent in a position) * log(symbols)).
+// Positions are sized as a fraction of current equity and filled at the signal bar's close. A short locks its
+// entry notional as collateral and is worth collateral + (entry - price) * quantity.
+class PortfolioBacktest
+{
+    struct Cursor
+    {
+        int64_t date;
+        int symbol;
+        int row;
+
+        bool operator>(const Cursor &other) const
+        {
+            return date != other.date ? date > other.date : symbol > other.symbol;
+        }
+    };
+
+    struct Position
+    {
+        bool open;
+        int side;         // Stores 1 for long, -1 for short.
+        double quantity;  // Stores the number of shares.
+        double entryPrice;
+        double value;     // Stores the current marked value of the position.
+    };
+
+    std::vector<std::pair<std::string, std::string>> symbolInputs; // Stores the (symbol name, csv file) pairs to load.
+    std::vector<std::shared_ptr<Data>> symbolData;                 // Stores the loaded data, one entry per symbol.
+    Strategy *strategyInstance;
+    PortfolioSettings settings;
+    int NUM_OF_THREADS;
+    Timeframe timeframe; // Stores the bar size the csv files are resampled to.
+
+    std::vector<std::unique_ptr<int8_t[]>> signals; // Stores the signals of each symbol.
+    std::vector<std::vector<int>> entryRows;        // Stores, per symbol, the rows carrying an entry signal.
+    std::vector<EquityPoint> equityCurve;
+    PortfolioSummary summary;
+
+    // Member function returning the next entry row of 'symbol' strictly after 'row' (or -1).
+    int getNextEntryRow(int symbol, int row) const
+    {
+        const std::vector<int> &rows = entryRows[symbol];
+        std::vector<int>::const_iterator next = std::upper_bound(rows.begin(), rows.end(), row);
+        return next == rows.end() ? -1 : *next;
+    }
+
+    Cursor makeCursor(int symbol, int row) const
+    {
+        Cursor cursor;
+        cursor.date = symbolData[symbol]->dates()[row];
+        cursor.symbol = symbol;
+        cursor.row = row;
+        return cursor;
+    }
+
+public:
+    PortfolioBacktest(Strategy *strategyInstance, const PortfolioSettings &settings, int numOfThreads = 0)
+        : strategyInstance(strategyInstance), settings(settings), NUM_OF_THREADS(numOfThreads)
+    {
+    }
+
+    // Function 'setSymbolInputs' sets the csv files to load; they are read in parallel by 'run'.
+    void setSymbolInputs(const std::vector<std::pair<std::string, std::string>> &symbolInputs)
+    {
+        this->symbolInputs = symbolInputs;
+        symbolData.assign(symbolInputs.size(), std::shared_ptr<Data>());
+    }
+
+    // Function 'setTimeframe' resamples every loaded csv file to 'timeframe' (native keeps the file's bars).
+    void setTimeframe(const Timeframe &timeframe)
+    {
+        this->timeframe = timeframe;
+    }
+
+    // Function 'setSymbolData' sets already loaded series instead of csv files.
+    void setSymbolData(const std::vector<std::shared_ptr<Data>> &symbolData)
+    {
+        this->symbolInputs.clear();
+        this->symbolData = symbolData;
+    }
+
+    // Function 'generateSignals' loads any missing series and computes every symbol's signals in parallel,
+    // keeping only the rows that carry an entry signal.
+
+    void generateSignals()
+    {
+        signals.clear();
+        signals.resize(symbolData.size());
+        entryRows.assign(symbolData.size(), std::vector<int>());
+
+        WorkStealingPool pool(NUM_OF_THREADS);
+        for (size_t s = 0; s < symbolData.size(); s++)
+        {
+            pool.submit([this, s]()
+                        {
+                            if (!symbolData[s])
+                                symbolData[s] = Resampler::load(symbolInputs[s].first, symbolInputs[s].second, timeframe);
+
+                            const Data &data = *symbolData[s];
+                            signals[s].reset(strategyInstance->getTradeSignals(data));
+                            for (int i = 0; i < data.numberOfRows; i++)
+                            {
+                                if (signals[s][i] == 1 || signals[s][i] == 2)
+                                    entryRows[s].push_back(i);
+                            }
+                        });
+        }
+        pool.wait();
+    }
+
+    // Function 'run' generates the signals and simulates the shared account over the merged event stream.
+
+    void run()
+    {
+        generateSignals();
+
+        std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heap;
+        std::vector<Position> positions(symbolData.size());
+        std::vector<Cursor> dateCursors, pendingEntries;
+
+        double cash = settings.initialCapital, positionsValue = 0, peakEquity = settings.initialCapital;
+        int openPositions = 0;
+        summary = PortfolioSummary();
+        summary.maxDrawdownPercent = 0;
+        equityCurve.clear();
+
+        for (size_t s = 0; s < symbolData.size(); s++)
+        {
+            positions[s].open = false;
+            if (!entryRows[s].empty())
+                heap.push(makeCursor(int(s), entryRows[s][0]));
+        }
+
+        while (!heap.empty())
+        {
+            // Take every cursor that falls on the earliest pending date.
+            int64_t date = heap.top().date;
+            dateCursors.clear();
+            pendingEntries.clear();
+            while (!heap.empty() && heap.top().date == date)
+            {
+                dateCursors.push_back(heap.top());
+                heap.pop();
+            }
+            summary.eventsMerged += (long long)dateCursors.size();
+
+            // Mark open positions and close those with an exit signal first, so exits free cash for same-day entries.
+            for (size_t c = 0; c < dateCursors.size(); c++)
+            {
+                const Cursor &cursor = dateCursors[c];
+                Position &position = positions[cursor.symbol];
+                float closePrice = symbolData[cursor.symbol]->closePrices()[cursor.row];
+                int8_t signal = signals[cursor.symbol][cursor.row];
+
+                if (!position.open)
+                {
+                    pendingEntries.push_back(cursor);
+                    continue;
+                }
+
+                double value = position.side > 0 ? position.quantity * closePrice
+                                                 : position.quantity * (2 * position.entryPrice - closePrice);
+                positionsValue += value - position.value;
+                position.value = value;
+
+                if (signal == -1 || signal == -2)
+                {
+                    cash += position.value;
+                    positionsValue -= position.value;
+                    position.open = false;
+                    openPositions--;
+                    summary.tradesClosed++;
+
+                    int next = getNextEntryRow(cursor.symbol, cursor.row);
+                    if (next >= 0)
+                        heap.push(makeCursor(cursor.symbol, next));
+                }
+                else if (cursor.row + 1 < symbolData[cursor.symbol]->numberOfRows)
+                {
+                    heap.push(makeCursor(cursor.symbol, cursor.row + 1));
+                }
+            }
+
+            // Fill the entries of this date in symbol order while cash and position slots last.
+            for (size_t c = 0; c < pendingEntries.size(); c++)
+            {
+                const Cursor &cursor = pendingEntries[c];
+                Position &position = positions[cursor.symbol];
+                float closePrice = symbolData[cursor.symbol]->closePrices()[cursor.row];
+                double notional = (cash + positionsValue) * settings.positionFraction;
+
+                if (openPositions < settings.maxPositions && notional > 0 && notional <= cash && closePrice > 0)
+                {
+                    position.open = true;
+                    position.side = signals[cursor.symbol][cursor.row] == 1 ? 1 : -1;
+                    position.entryPrice = closePrice;
+                    position.quantity = notional / closePrice;
+                    position.value = notional;
+                    cash -= notional;
+                    positionsValue += notional;
+                    openPositions++;
+                    summary.tradesTaken++;
+                    summary.maxOpenPositions = std::max(summary.maxOpenPositions, openPositions);
+
+                    if (cursor.row + 1 < symbolData[cursor.symbol]->numberOfRows)
+                        heap.push(makeCursor(cursor.symbol, cursor.row + 1));
+                }
+                else
+                {
+                    summary.entriesRejected++;
+
+                    int next = getNextEntryRow(cursor.symbol, cursor.row);
+                    if (next >= 0)
+                        heap.push(makeCursor(cursor.symbol, next));
+                }
+            }
+
+            EquityPoint point;
+            point.date = date;
+            point.cash = cash;
+            point.equity = cash + positionsValue;
+            point.openPositions = openPositions;
+            equityCurve.push_back(point);
+
+            peakEquity = std::max(peakEquity, point.equity);
+            summary.maxDrawdownPercent = std::max(summary.maxDrawdownPercent, (peakEquity - point.equity) * 100 / peakEquity);
+        }
+
+        summary.openPositionsAtEnd = openPositions;
+        summary.finalEquity = equityCurve.empty() ? settings.initialCapital : equityCurve.back().equity;
+        summary.totalReturnPercent = (summary.finalEquity - settings.initialCapital) * 100 / settings.initialCapital;
+    }
+
+    const std::vector<EquityPoint> &getEquityCurve() const
+    {
+        return equityCurve;
+    }
+
+    const PortfolioSummary &getSummary() const
+    {
+        return summary;
+    }
+
+    // Function 'getTotalRows' returns the number of bars across all loaded symbols.
+    long long getTotalRows() const
+    {
+        long long totalRows = 0;
+        for (size_t s = 0; s < symbolData.size(); s++)
+            totalRows += symbolData[s] ? symbolData[s]->numberOfRows : 0;
+        return totalRows;
+    }
+
+    // Function 'writeEquityCurve' writes the equity curve as CSV (one row per merged date).
+
+    bool writeEquityCurve(const std::string &fileName) const
+    {
+        std::ofstream fout(fileName.c_str());
+        if (!fout)
+            return false;
+
+        fout << "date,equity,cash,open_positions\n";
+        for (size_t i = 0; i < equityCurve.size(); i++)
+        {
+            fout << CsvParser::formatDate(equityCurve[i].date) << "," << equityCurve[i].equity << ","
+                 << equityCurve[i].cash << "," << equityCurve[i].openPositions << "\n";
+        }
+        return bool(fout);
+    }
+};
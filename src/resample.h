@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "column_cache.h"
+#include "columns.h"
+#include "csv_parser.h"
+#include "data.h"
+#include "instrumentation.h"
+
+// Define a C++ struct named 'Timeframe' that describes a bar size: N minutes, days, weeks or months.
+// NATIVE keeps the bars the csv file contains.
+struct Timeframe
+{
+    enum Unit
+    {
+        NATIVE,
+        MINUTES,
+        DAYS,
+        WEEKS,
+        MONTHS
+    };
+
+    Unit unit;  // Stores the unit of the bar size.
+    int count;  // Stores how many units one bar spans.
+
+    Timeframe()
+        : unit(NATIVE), count(1)
+    {
+    }
+
+    Timeframe(Unit unit, int count)
+        : unit(unit), count(count)
+    {
+    }
+
+    bool isNative() const
+    {
+        return unit == NATIVE;
+    }
+
+    // Static function to parse "native", "daily", "weekly", "monthly" or "<N><unit>" with unit m/min, h, d, w or mo
+    // (e.g. "5m", "1h", "1d", "2w", "3mo"). Returns false for anything else.
+    static bool parse(const std::string &name, Timeframe &timeframe)
+    {
+        if (name.empty() || name == "native")
+            timeframe = Timeframe();
+        else if (name == "daily")
+            timeframe = Timeframe(DAYS, 1);
+        else if (name == "weekly")
+            timeframe = Timeframe(WEEKS, 1);
+        else if (name == "monthly")
+            timeframe = Timeframe(MONTHS, 1);
+        else
+        {
+            char *suffix = nullptr;
+            long value = strtol(name.c_str(), &suffix, 10);
+            std::string unitName(suffix);
+            if (suffix == name.c_str() || value <= 0 || value > 1000000)
+                return false;
+
+            if (unitName == "m" || unitName == "min")
+                timeframe = Timeframe(MINUTES, int(value));
+            else if (unitName == "h")
+                timeframe = Timeframe(MINUTES, int(value) * 60);
+            else if (unitName == "d")
+                timeframe = Timeframe(DAYS, int(value));
+            else if (unitName == "w")
+                timeframe = Timeframe(WEEKS, int(value));
+            else if (unitName == "mo")
+                timeframe = Timeframe(MONTHS, int(value));
+            else
+                return false;
+        }
+        return true;
+    }
+
+    // Member function to return the canonical name ("5m", "1d", "1w", "1mo", or "native").
+    std::string getName() const
+    {
+        static const char *unitNames[] = {"native", "m", "d", "w", "mo"};
+        return unit == NATIVE ? std::string(unitNames[0]) : std::to_string(count) + unitNames[unit];
+    }
+
+    // Member function to return the bucket a bar time falls in. Bars with the same bucket form one coarser bar.
+    // Weeks start on Monday; months are calendar months; multi-unit buckets are counted from the Unix epoch.
+    int64_t getBucket(int64_t timestamp) const
+    {
+        int64_t days = floorDivide(timestamp, 86400);
+        switch (unit)
+        {
+        case MINUTES:
+            return floorDivide(timestamp, int64_t(count) * 60);
+        case DAYS:
+            return floorDivide(days, count);
+        case WEEKS:
+            return floorDivide(floorDivide(days + 3, 7), count); // 1970-01-01 was a Thursday.
+        case MONTHS:
+        {
+            int year;
+            unsigned month, day;
+            CsvParser::civilFromDays(days, year, month, day);
+            return floorDivide(int64_t(year) * 12 + int64_t(month) - 1, count);
+        }
+        default:
+            return timestamp;
+        }
+    }
+
+    // Member function to return the length of one bucket in seconds (months count as 31 days), for sizing output.
+    int64_t getApproximateSeconds() const
+    {
+        static const int64_t unitSeconds[] = {1, 60, 86400, 7 * 86400, 31 * 86400};
+        return unitSeconds[unit] * count;
+    }
+
+private:
+    static int64_t floorDivide(int64_t value, int64_t divisor)
+    {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+};
+
+// Define a C++ class named 'Resampler' that aggregates the bars of a loaded Data into a coarser Timeframe:
+// open = first open, high = max high, low = min low, close (and adj close) = last close, volume = sum.
+// Each output bar is dated with the time of its last input bar, the moment its close is known, so a strategy
+// run on resampled bars never sees a close before it happened. The input must be in time order, as csv files are.
+class Resampler
+{
+    // Static function holding the resampled Data already built in this process, keyed by symbol, file and timeframe.
+    // Entries are weak so unused resamplings are freed; the on-disk column cache keeps them across runs.
+    static std::map<std::string, std::weak_ptr<Data>> &getLoaded()
+    {
+        static std::map<std::string, std::weak_ptr<Data>> loaded;
+        return loaded;
+    }
+
+    static std::mutex &getLoadedMutex()
+    {
+        static std::mutex loadedMutex;
+        return loadedMutex;
+    }
+
+public:
+    // Function 'resample' builds the coarser bars of 'data' in one streaming pass over its columns.
+
+    static std::shared_ptr<DataColumns> resample(const Data &data, const Timeframe &timeframe)
+    {
+        std::shared_ptr<DataColumns> bars = std::make_shared<DataColumns>();
+        const int numberOfRows = data.numberOfRows;
+        if (numberOfRows == 0)
+            return bars;
+
+        const int64_t *dates = data.dates().data();
+        const float *openPrices = data.openPrices().data();
+        const float *highPrices = data.highPrices().data();
+        const float *lowPrices = data.lowPrices().data();
+        const float *closePrices = data.closePrices().data();
+        const float *adjClosePrices = data.adjClosePrices().data();
+        const long long int *volumes = data.volumes().data();
+
+        if (timeframe.isNative())
+        {
+            bars->resize(size_t(numberOfRows));
+            std::copy(dates, dates + numberOfRows, bars->date.begin());
+            std::copy(openPrices, openPrices + numberOfRows, bars->openPrice.begin());
+            std::copy(highPrices, highPrices + numberOfRows, bars->highPrice.begin());
+            std::copy(lowPrices, lowPrices + numberOfRows, bars->lowPrice.begin());
+            std::copy(closePrices, closePrices + numberOfRows, bars->closePrice.begin());
+            std::copy(adjClosePrices, adjClosePrices + numberOfRows, bars->adjClosePrice.begin());
+            std::copy(volumes, volumes + numberOfRows, bars->volume.begin());
+            return bars;
+        }
+
+        // Size the columns for the covered time span (never more than one bar per input row).
+        int64_t span = dates[numberOfRows - 1] - dates[0];
+        int64_t estimate = span / timeframe.getApproximateSeconds() + 2;
+        bars->resize(size_t(std::min<int64_t>(numberOfRows, std::max<int64_t>(estimate, 1))));
+
+        size_t count = 0;
+        int64_t bucket = timeframe.getBucket(dates[0]);
+        float openPrice = openPrices[0], highPrice = highPrices[0], lowPrice = lowPrices[0];
+        long long int volume = volumes[0];
+
+        for (int i = 1; i <= numberOfRows; i++)
+        {
+            int64_t nextBucket = i < numberOfRows ? timeframe.getBucket(dates[i]) : bucket + 1;
+            if (nextBucket != bucket)
+            {
+                // Close the bar that ended at row i - 1.
+                if (count == bars->date.size())
+                    bars->resize(std::min(size_t(numberOfRows), count * 2));
+                bars->date[count] = dates[i - 1];
+                bars->openPrice[count] = openPrice;
+                bars->highPrice[count] = highPrice;
+                bars->lowPrice[count] = lowPrice;
+                bars->closePrice[count] = closePrices[i - 1];
+                bars->adjClosePrice[count] = adjClosePrices[i - 1];
+                bars->volume[count] = volume;
+                count++;
+
+                if (i == numberOfRows)
+                    break;
+                bucket = nextBucket;
+                openPrice = openPrices[i];
+                highPrice = highPrices[i];
+                lowPrice = lowPrices[i];
+                volume = volumes[i];
+            }
+            else
+            {
+                highPrice = std::max(highPrice, highPrices[i]);
+                lowPrice = std::min(lowPrice, lowPrices[i]);
+                volume += volumes[i];
+            }
+        }
+
+        bars->resize(count);
+        return bars;
+    }
+
+    // Function 'load' returns the bars of a csv file at 'timeframe'. Native timeframes load the file as is.
+    // Otherwise the resampled columns come from (in order) this process's loaded Data, the column cache file
+    // "<file>@<timeframe>" (valid while the csv is unchanged), or a fresh resampling that is then cached.
+
+    static std::shared_ptr<Data> load(const std::string &symbolName, const std::string &fileName, const Timeframe &timeframe)
+    {
+        if (timeframe.isNative())
+            return std::make_shared<Data>(symbolName, fileName);
+
+        const std::string variant = timeframe.getName();
+        const std::string key = symbolName + '\n' + ColumnCache::getCachePath(fileName, variant);
+        {
+            std::lock_guard<std::mutex> lock(getLoadedMutex());
+            std::shared_ptr<Data> loaded = getLoaded()[key].lock();
+            if (loaded)
+                return loaded;
+        }
+
+        std::shared_ptr<Data> resampled = std::make_shared<Data>(symbolName);
+        ColumnViews cached;
+        if (ColumnCache::load(fileName, cached, variant))
+            resampled->setColumns(cached);
+        else
+        {
+            TF_PROFILE_SCOPE(RESAMPLE);
+            Data source(symbolName, fileName);
+            ColumnViews views = ColumnViews::fromColumns(resample(source, timeframe), source.skippedRows);
+            resampled->setColumns(views);
+            if (resampled->numberOfRows)
+                ColumnCache::store(fileName, symbolName, views, variant);
+        }
+
+        std::lock_guard<std::mutex> lock(getLoadedMutex());
+        getLoaded()[key] = resampled;
+        return resampled;
+    }
+};
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "backtest.h"
+#include "csv_parser.h"
+#include "instrumentation.h"
+#include "strategy.h"
+
+// Define the output formats of a ResultsSink.
+enum ResultsFormat
+{
+    RESULTS_TEXT = 0,   // The original human-readable block per backtest.
+    RESULTS_CSV = 1,    // One row per backtest; trades go to a second CSV stream joined on result_id.
+    RESULTS_JSONL = 2,  // One JSON object per line, with the params map and the trade list inline.
+    RESULTS_BINARY = 3  // "TFRES001", then per backtest a ResultRecord followed by its TradeRecords.
+};
+
+// Define a C++ struct named 'ResultRecord' holding one backtest result in a fixed-size, trivially copyable layout.
+// Names longer than their field are truncated; strategies with more than MAX_PARAMS parameters keep the first ones.
+struct ResultRecord
+{
+    static const int NAME_LENGTH = 48;
+    static const int MAX_PARAMS = 12;
+
+    char symbolName[NAME_LENGTH];
+    char strategyName[NAME_LENGTH];
+    int32_t numOfParams;
+    char paramNames[MAX_PARAMS][NAME_LENGTH];
+    int32_t paramValues[MAX_PARAMS];
+    int32_t totalTrades;
+    int32_t numOfProfitableTrades;
+    float totalProfitPercent;
+    uint32_t tradeBegin; // Stores the index of the first trade in the owning batch (unused in binary output).
+    uint32_t tradeCount; // Stores the number of trades of this backtest.
+};
+
+// Define a C++ class named 'ResultsSink' that collects backtest results from many worker threads and writes them
+// from a single writer thread.
+// Each producer thread fills its own batch of ResultRecords (and their trades) without any synchronization. A full
+// batch is pushed onto a lock-free multi-producer single-consumer stack with one compare-and-swap; the writer takes
+// the whole stack with one exchange, formats every batch into a buffer and writes it with a single call, so no
+// worker ever waits on output and no line is flushed on its own.
+// The only lock a producer takes is a one-time registration of its batch the first time it pushes to a sink.
+class ResultsSink
+{
+    static const int RECORDS_PER_BATCH = 64;
+
+    struct Batch
+    {
+        std::vector<ResultRecord> records;
+        std::vector<TradeRecord> trades;
+        Batch *next; // Stores the next batch on the pending stack.
+
+        Batch()
+            : next(nullptr)
+        {
+            records.reserve(RECORDS_PER_BATCH);
+        }
+    };
+
+    // Per-thread handle: each producer thread caches the batch it fills for the sink it last pushed to.
+    struct ThreadSlot
+    {
+        uint64_t sinkId;
+        Batch **batch;
+    };
+
+    std::ostream &out;
+    std::ostream *tradesOut; // Stores the stream for the CSV trade rows (nullptr drops them).
+    ResultsFormat format;
+    uint64_t sinkId;
+
+    std::atomic<Batch *> pending;          // Stores the lock-free stack of full batches.
+    std::mutex registryMutex;                         // Guards 'batchSlots' (taken once per producer thread).
+    std::vector<std::unique_ptr<Batch *>> batchSlots; // Stores the current batch of every producer thread.
+
+    std::thread writer;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition; // Nudges the writer; it also polls, so a missed notify only adds latency.
+    std::atomic<bool> closing;
+    bool closed;
+
+    long long recordsWritten, tradesWritten, batchesWritten; // Touched by the writer thread only.
+
+    static uint64_t nextSinkId()
+    {
+        static std::atomic<uint64_t> counter(0);
+        return ++counter;
+    }
+
+    static void copyName(char *destination, const std::string &source)
+    {
+        size_t length = std::min(source.size(), size_t(ResultRecord::NAME_LENGTH - 1));
+        memcpy(destination, source.data(), length);
+        destination[length] = '\0';
+    }
+
+    // Member function returning the calling thread's batch for this sink, registering the thread on first use.
+    Batch *&getThreadBatch()
+    {
+        static thread_local ThreadSlot slot = {0, nullptr};
+
+        if (slot.sinkId != sinkId)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            batchSlots.push_back(std::unique_ptr<Batch *>(new Batch *(nullptr)));
+            slot.batch = batchSlots.back().get();
+            slot.sinkId = sinkId;
+        }
+        return *slot.batch;
+    }
+
+    void pushBatch(Batch *batch)
+    {
+        batch->next = pending.load(std::memory_order_relaxed);
+        while (!pending.compare_exchange_weak(batch->next, batch, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+        wakeCondition.notify_one();
+    }
+
+    // Member function to take every pending batch, oldest first, and write them out.
+    bool drain()
+    {
+        Batch *stack = pending.exchange(nullptr, std::memory_order_acquire);
+        if (!stack)
+            return false;
+
+        TF_PROFILE_SCOPE(RESULT_WRITE);
+        long long recordsBefore = recordsWritten;
+        (void)recordsBefore; // Only read by TF_PROFILE_COUNT, which TF_INSTRUMENTATION=0 compiles out.
+
+        // The stack is newest first; reverse it so each producer's batches keep their order.
+        Batch *batches = nullptr;
+        while (stack)
+        {
+            Batch *next = stack->next;
+            stack->next = batches;
+            batches = stack;
+            stack = next;
+        }
+
+        std::ostringstream buffer, tradesBuffer;
+        while (batches)
+        {
+            Batch *next = batches->next;
+            writeBatch(*batches, buffer, tradesBuffer);
+            delete batches;
+            batches = next;
+        }
+
+        std::string text = buffer.str();
+        out.write(text.data(), std::streamsize(text.size()));
+        out.flush();
+        if (tradesOut)
+        {
+            std::string trades = tradesBuffer.str();
+            tradesOut->write(trades.data(), std::streamsize(trades.size()));
+            tradesOut->flush();
+        }
+        TF_PROFILE_COUNT(RESULTS_WRITTEN, recordsWritten - recordsBefore);
+        return true;
+    }
+
+    void writerLoop()
+    {
+        while (true)
+        {
+            bool wasClosing = closing.load(std::memory_order_acquire);
+            if (drain())
+                continue;
+            if (wasClosing)
+                return;
+
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait_for(lock, std::chrono::milliseconds(2));
+        }
+    }
+
+    static std::string escapeJson(const char *text)
+    {
+        std::string escaped;
+        for (const char *c = text; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                escaped += '\\';
+            if ((unsigned char)*c < 0x20)
+                continue;
+            escaped += *c;
+        }
+        return escaped;
+    }
+
+    void writeBatch(const Batch &batch, std::ostringstream &buffer, std::ostringstream &tradesBuffer)
+    {
+        for (size_t r = 0; r < batch.records.size(); r++)
+        {
+            const ResultRecord &record = batch.records[r];
+            const TradeRecord *trades = batch.trades.data() + record.tradeBegin;
+            long long resultId = recordsWritten++;
+            tradesWritten += record.tradeCount;
+
+            if (format == RESULTS_TEXT)
+                writeText(record, buffer);
+            else if (format == RESULTS_CSV)
+                writeCsv(resultId, record, trades, buffer, tradesBuffer);
+            else if (format == RESULTS_JSONL)
+                writeJson(resultId, record, trades, buffer);
+            else
+                writeBinary(record, trades, buffer);
+        }
+        batchesWritten++;
+    }
+
+    static void writeText(const ResultRecord &record, std::ostringstream &buffer)
+    {
+        buffer << "\n*************************************************************\n";
+        buffer << "Symbol: " << record.symbolName << "\n";
+        buffer << "Strategy: " << record.strategyName << "\n";
+        buffer << "Total Trades Taken: " << record.totalTrades << "\n";
+        buffer << "Number Of Profitable Trades: " << record.numOfProfitableTrades << "\n";
+        buffer << "Total Profit Percentage: " << record.totalProfitPercent << "\n";
+        buffer << "Average Profit Percentage Per Trade: " << toResult(record).averageProfitPercent() << "\n";
+        buffer << "*************************************************************\n";
+    }
+
+    static void writeCsv(long long resultId, const ResultRecord &record, const TradeRecord *trades, std::ostringstream &buffer, std::ostringstream &tradesBuffer)
+    {
+        BacktestResult result = toResult(record);
+
+        buffer << std::setprecision(9) << resultId << "," << record.symbolName << "," << record.strategyName << ",";
+        for (int p = 0; p < record.numOfParams; p++)
+            buffer << (p ? ";" : "") << record.paramNames[p] << "=" << record.paramValues[p];
+        buffer << "," << record.totalTrades << "," << record.numOfProfitableTrades << "," << record.totalProfitPercent
+               << "," << result.averageProfitPercent() << "\n";
+
+        tradesBuffer << std::setprecision(9);
+        for (uint32_t t = 0; t < record.tradeCount; t++)
+        {
+            tradesBuffer << resultId << "," << record.symbolName << "," << (trades[t].side > 0 ? "long" : "short") << ","
+                         << CsvParser::formatDate(trades[t].entryDate) << "," << CsvParser::formatDate(trades[t].exitDate) << ","
+                         << trades[t].entryPrice << "," << trades[t].exitPrice << "," << trades[t].profitPercent << "\n";
+        }
+    }
+
+    static void writeJson(long long resultId, const ResultRecord &record, const TradeRecord *trades, std::ostringstream &buffer)
+    {
+        BacktestResult result = toResult(record);
+
+        buffer << std::setprecision(9) << "{\"result_id\":" << resultId << ",\"symbol\":\"" << escapeJson(record.symbolName)
+               << "\",\"strategy\":\"" << escapeJson(record.strategyName) << "\",\"params\":{";
+        for (int p = 0; p < record.numOfParams; p++)
+            buffer << (p ? "," : "") << "\"" << escapeJson(record.paramNames[p]) << "\":" << record.paramValues[p];
+        buffer << "},\"total_trades\":" << record.totalTrades << ",\"profitable_trades\":" << record.numOfProfitableTrades
+               << ",\"total_profit_percent\":" << record.totalProfitPercent << ",\"average_profit_percent\":" << result.averageProfitPercent()
+               << ",\"trades\":[";
+        for (uint32_t t = 0; t < record.tradeCount; t++)
+        {
+            buffer << (t ? "," : "") << "{\"side\":\"" << (trades[t].side > 0 ? "long" : "short") << "\",\"entry_date\":\""
+                   << CsvParser::formatDate(trades[t].entryDate) << "\",\"exit_date\":\"" << CsvParser::formatDate(trades[t].exitDate)
+                   << "\",\"entry_price\":" << trades[t].entryPrice << ",\"exit_price\":" << trades[t].exitPrice
+                   << ",\"profit_percent\":" << trades[t].profitPercent << "}";
+        }
+        buffer << "]}\n";
+    }
+
+    static void writeBinary(const ResultRecord &record, const TradeRecord *trades, std::ostringstream &buffer)
+    {
+        ResultRecord copy = record;
+        copy.tradeBegin = 0;
+        buffer.write(reinterpret_cast<const char *>(&copy), sizeof(copy));
+        buffer.write(reinterpret_cast<const char *>(trades), std::streamsize(sizeof(TradeRecord) * record.tradeCount));
+    }
+
+    static BacktestResult toResult(const ResultRecord &record)
+    {
+        BacktestResult result;
+        result.totalTrades = record.totalTrades;
+        result.numOfProfitableTrades = record.numOfProfitableTrades;
+        result.totalProfitPercent = record.totalProfitPercent;
+        return result;
+    }
+
+public:
+    // Constructor that starts the writer thread. 'tradesOut' receives the per-trade rows of the CSV format.
+    ResultsSink(std::ostream &out, ResultsFormat format, std::ostream *tradesOut = nullptr)
+        : out(out), tradesOut(tradesOut), format(format), sinkId(nextSinkId()), pending(nullptr), closing(false), closed(false),
+          recordsWritten(0), tradesWritten(0), batchesWritten(0)
+    {
+        if (format == RESULTS_CSV)
+        {
+            out << "result_id,symbol,strategy,params,total_trades,profitable_trades,total_profit_percent,average_profit_percent\n";
+            if (tradesOut)
+                *tradesOut << "result_id,symbol,side,entry_date,exit_date,entry_price,exit_price,profit_percent\n";
+        }
+        else if (format == RESULTS_BINARY)
+        {
+            out.write("TFRES001", 8);
+        }
+
+        writer = std::thread(&ResultsSink::writerLoop, this);
+    }
+
+    // Static function to parse "text", "csv", "jsonl" or "binary".
+    static bool parseFormat(const std::string &name, ResultsFormat &format)
+    {
+        static const char *names[] = {"text", "csv", "jsonl", "binary"};
+        for (int f = 0; f < 4; f++)
+        {
+            if (name == names[f])
+            {
+                format = ResultsFormat(f);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Function 'wantsTrades' tells producers whether collecting the per-trade list is worth it.
+    bool wantsTrades() const
+    {
+        return format != RESULTS_TEXT && (format != RESULTS_CSV || tradesOut);
+    }
+
+    // Function 'push' records one backtest result; it may be called from any number of threads at once.
+
+    void push(const std::string &symbolName, const Strategy &strategy, const BacktestResult &result, const std::vector<TradeRecord> &trades)
+    {
+        TF_PROFILE_SCOPE(RESULT_PUSH);
+
+        Batch *&batch = getThreadBatch();
+        if (!batch)
+            batch = new Batch();
+
+        batch->records.push_back(ResultRecord());
+        ResultRecord &record = batch->records.back();
+        copyName(record.symbolName, symbolName);
+        copyName(record.strategyName, strategy.strategyName);
+
+        record.numOfParams = 0;
+        for (std::map<std::string, int>::const_iterator it = strategy.strategyParams.begin();
+             it != strategy.strategyParams.end() && record.numOfParams < ResultRecord::MAX_PARAMS; ++it)
+        {
+            copyName(record.paramNames[record.numOfParams], it->first);
+            record.paramValues[record.numOfParams++] = it->second;
+        }
+
+        record.totalTrades = result.totalTrades;
+        record.numOfProfitableTrades = result.numOfProfitableTrades;
+        record.totalProfitPercent = result.totalProfitPercent;
+        record.tradeBegin = uint32_t(batch->trades.size());
+        record.tradeCount = uint32_t(trades.size());
+        batch->trades.insert(batch->trades.end(), trades.begin(), trades.end());
+
+        if (batch->records.size() >= size_t(RECORDS_PER_BATCH))
+        {
+            pushBatch(batch);
+            batch = nullptr;
+        }
+    }
+
+    // Function 'close' hands over the partly filled batches, writes everything and stops the writer thread.
+    // Every producer must have finished pushing (e.g. after WorkStealingPool::wait).
+
+    void close()
+    {
+        if (closed)
+            return;
+        closed = true;
+
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (size_t t = 0; t < batchSlots.size(); t++)
+            {
+                if (*batchSlots[t])
+                    pushBatch(*batchSlots[t]);
+                *batchSlots[t] = nullptr;
+            }
+        }
+
+        closing.store(true, std::memory_order_release);
+        wakeCondition.notify_one();
+        writer.join();
+    }
+
+    long long getRecordsWritten() const
+    {
+        return recordsWritten;
+    }
+
+    long long getTradesWritten() const
+    {
+        return tradesWritten;
+    }
+
+    long long getBatchesWritten() const
+    {
+        return batchesWritten;
+    }
+
+    ~ResultsSink()
+    {
+        close();
+    }
+};
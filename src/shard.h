@@ -0,0 +1,569 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "column_cache.h"
+#include "common.h"
+#include "resample.h"
+#include "strategy.h"
+#include "sweep.h"
+
+// Define a C++ struct named 'ShardUnit' for one unit of work: parameter sets [setBegin, setEnd) of one lookback
+// group on one symbol. The sets of a unit share their K-maximum/K-minimum windows.
+struct ShardUnit
+{
+    int symbolIndex;
+    int setBegin;
+    int setEnd;
+};
+
+// Define a C++ struct named 'ShardWorkerStats' to report what one worker process did.
+struct ShardWorkerStats
+{
+    pid_t pid;          // Stores the process id of the worker.
+    int units;          // Stores the number of units the worker completed.
+    double busySeconds; // Stores the time the worker spent evaluating units.
+    bool failed;        // Stores whether the worker died before it was told to stop.
+
+    ShardWorkerStats()
+        : pid(0), units(0), busySeconds(0), failed(false)
+    {
+    }
+};
+
+// Define a C++ class named 'ShardCoordinator' that runs a ParameterSweep on local worker processes.
+// The symbol x parameter set space is cut into ShardUnits. The coordinator forks NUM_OF_WORKERS workers, each
+// connected to it by a Unix socket pair, and keeps every worker UNITS_IN_FLIGHT units ahead; a worker loads a
+// symbol and its windows once for consecutive units and sends the results back. Completed units are appended to
+// a checkpoint journal, so a run that crashed (or was killed) resumes with only the missing units. A worker that
+// dies has its units queued again and is replaced. The merged results are ranked and written by the sweep, and
+// are identical to a single-process ParameterSweep::run.
+class ShardCoordinator
+{
+    static const int UNITS_IN_FLIGHT = 2; // Units queued per worker, so a worker never waits for its next unit.
+    static const int MAX_RESPAWNS = 16;   // Workers replaced before the run gives up (it can still be resumed).
+
+    // Define a struct named 'JournalHeader' for the start of the checkpoint journal. Records follow it, each
+    // [int32 unit index][int32 count][count SweepResults][uint64 checksum of the preceding bytes].
+    struct JournalHeader
+    {
+        char magic[8];       // Stores "TFSHARD1".
+        uint64_t configHash; // Stores the hash of everything the results depend on (see 'getConfigHash').
+        uint32_t numOfUnits; // Stores the number of units of the run.
+        uint32_t resultSize; // Stores sizeof(SweepResult), to reject journals of other builds.
+    };
+
+    // Define a struct named 'Worker' for the coordinator's end of one worker process.
+    struct Worker
+    {
+        int fd;                 // Stores the coordinator's end of the socket pair (-1 once closed).
+        std::deque<int> queued; // Stores the units sent to the worker and not answered yet.
+        ShardWorkerStats stats;
+    };
+
+    ParameterSweep &sweep;
+    int NUM_OF_WORKERS;
+    int setsPerUnit;              // Stores the maximum number of parameter sets per unit.
+    std::string checkpointFile;   // Stores the journal path ("" runs without a checkpoint).
+    std::vector<ShardUnit> units; // Stores every unit of the run, symbol-major.
+    std::vector<char> unitDone;   // Stores whether each unit's results are in 'results'.
+    std::vector<SweepResult> results;
+    std::vector<ShardWorkerStats> workerStats;
+    int resumedUnits;             // Stores the units read back from the journal.
+    int journalFd;
+
+    ShardCoordinator(const ShardCoordinator &) = delete;
+    ShardCoordinator &operator=(const ShardCoordinator &) = delete;
+
+    // Static functions to write and read a whole buffer over a socket or file, retrying partial transfers.
+    // Sockets are written with MSG_NOSIGNAL so a dead peer is an error, not a SIGPIPE.
+    static bool writeAll(int fd, const void *buffer, size_t bytes, bool socket)
+    {
+        const char *cursor = static_cast<const char *>(buffer);
+        while (bytes)
+        {
+            ssize_t written = socket ? send(fd, cursor, bytes, MSG_NOSIGNAL) : write(fd, cursor, bytes);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            cursor += written;
+            bytes -= size_t(written);
+        }
+        return true;
+    }
+
+    static bool readAll(int fd, void *buffer, size_t bytes)
+    {
+        char *cursor = static_cast<char *>(buffer);
+        while (bytes)
+        {
+            ssize_t got = read(fd, cursor, bytes);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+                return false;
+            cursor += got;
+            bytes -= size_t(got);
+        }
+        return true;
+    }
+
+    // Static function to fold 'bytes' into a 64-bit FNV-1a hash.
+    static uint64_t hashBytes(uint64_t hash, const void *data, size_t bytes)
+    {
+        const unsigned char *cursor = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < bytes; i++)
+            hash = (hash ^ cursor[i]) * 1099511628211ULL;
+        return hash;
+    }
+
+    // Member function to hash the symbols, the size and modification time of their csv files, timeframe, parameter
+    // sets, unit size and the sweep settings that change results, so a journal is only resumed by the run that wrote
+    // it and never after an input file changed.
+    uint64_t getConfigHash() const
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        const std::vector<std::pair<std::string, std::string>> &symbolInputs = sweep.getSymbolInputs();
+        for (size_t i = 0; i < symbolInputs.size(); i++)
+        {
+            std::string key = symbolInputs[i].first + '\n' + symbolInputs[i].second + '\n';
+            hash = hashBytes(hash, key.data(), key.size());
+
+            // Same stamp as ColumnCacheHeader: a missing file hashes as (0, 0) and fails later when it is loaded.
+            int64_t mtime = 0;
+            uint64_t size = 0;
+            ColumnCache::getFileStamp(symbolInputs[i].second, mtime, size);
+            hash = hashBytes(hash, &mtime, sizeof(mtime));
+            hash = hashBytes(hash, &size, sizeof(size));
+        }
+        std::string timeframe = sweep.getTimeframe().getName();
+        hash = hashBytes(hash, timeframe.data(), timeframe.size());
+
+        const std::vector<std::vector<int>> &parameterSets = sweep.getParameterSets();
+        for (size_t i = 0; i < parameterSets.size(); i++)
+            hash = hashBytes(hash, parameterSets[i].data(), parameterSets[i].size() * sizeof(int));
+
+        int settings[] = {setsPerUnit, int(sweep.getRank()), int(sweep.getExecution().fillModel), int(sweep.getExecution().tieBreak)};
+        float costs[] = {sweep.getExecution().slippagePercent, sweep.getExecution().commissionPercent};
+        hash = hashBytes(hash, settings, sizeof(settings));
+        return hashBytes(hash, costs, sizeof(costs));
+    }
+
+    // Member function to cut every (symbol, lookback group) into units of at most 'setsPerUnit' parameter sets.
+    void buildUnits()
+    {
+        const std::vector<std::pair<int, int>> &groups = sweep.getLookbackGroups();
+        units.clear();
+        for (int s = 0; s < int(sweep.getSymbolInputs().size()); s++)
+            for (size_t g = 0; g < groups.size(); g++)
+                for (int begin = groups[g].first; begin < groups[g].second; begin += setsPerUnit)
+                {
+                    ShardUnit unit = {s, begin, std::min(groups[g].second, begin + setsPerUnit)};
+                    units.push_back(unit);
+                }
+    }
+
+    // Member function to copy one unit's results into their slots of 'results'.
+    void storeUnit(int unitIndex, const SweepResult *unitResults)
+    {
+        const ShardUnit &unit = units[unitIndex];
+        std::copy(unitResults, unitResults + (unit.setEnd - unit.setBegin),
+                  results.begin() + size_t(unit.symbolIndex) * sweep.getParameterSets().size() + unit.setBegin);
+        unitDone[unitIndex] = 1;
+    }
+
+    // Member function to open the checkpoint journal. A journal of the same configuration is read back (stopping
+    // at the first incomplete or corrupt record, which a crash mid-write leaves) and then appended to; anything
+    // else is an error unless 'fresh' is set, which starts a new journal.
+    bool openJournal(bool fresh, std::string &error)
+    {
+        JournalHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "TFSHARD1", 8);
+        header.configHash = getConfigHash();
+        header.numOfUnits = uint32_t(units.size());
+        header.resultSize = uint32_t(sizeof(SweepResult));
+
+        journalFd = open(checkpointFile.c_str(), O_RDWR | O_CREAT | (fresh ? O_TRUNC : 0), 0644);
+        if (journalFd < 0)
+        {
+            error = "cannot open checkpoint " + checkpointFile + ": " + strerror(errno);
+            return false;
+        }
+
+        JournalHeader existing;
+        off_t validEnd = 0;
+        if (readAll(journalFd, &existing, sizeof(existing)))
+        {
+            if (std::memcmp(&existing, &header, sizeof(header)) != 0)
+            {
+                error = "checkpoint " + checkpointFile + " belongs to another sweep configuration (pass --fresh to discard it)";
+                return false;
+            }
+
+            validEnd = off_t(sizeof(header));
+            std::vector<SweepResult> unitResults;
+            int32_t record[2];
+            while (readAll(journalFd, record, sizeof(record)) && record[0] >= 0 && record[0] < int32_t(units.size()) &&
+                   record[1] == units[record[0]].setEnd - units[record[0]].setBegin)
+            {
+                uint64_t checksum;
+                unitResults.resize(size_t(record[1]));
+                if (!readAll(journalFd, unitResults.data(), unitResults.size() * sizeof(SweepResult)) || !readAll(journalFd, &checksum, sizeof(checksum)))
+                    break;
+                uint64_t expected = hashBytes(hashBytes(14695981039346656037ULL, record, sizeof(record)), unitResults.data(),
+                                              unitResults.size() * sizeof(SweepResult));
+                if (checksum != expected)
+                    break;
+
+                if (!unitDone[record[0]])
+                    resumedUnits++;
+                storeUnit(record[0], unitResults.data());
+                validEnd = lseek(journalFd, 0, SEEK_CUR);
+            }
+        }
+
+        // Drop a torn tail record, then append after the last valid one.
+        if (validEnd == 0)
+        {
+            if (ftruncate(journalFd, 0) != 0 || lseek(journalFd, 0, SEEK_SET) != 0 || !writeAll(journalFd, &header, sizeof(header), false))
+            {
+                error = "cannot write checkpoint " + checkpointFile;
+                return false;
+            }
+        }
+        else if (ftruncate(journalFd, validEnd) != 0 || lseek(journalFd, validEnd, SEEK_SET) != validEnd)
+        {
+            error = "cannot truncate checkpoint " + checkpointFile;
+            return false;
+        }
+        return true;
+    }
+
+    // Member function to append one completed unit to the journal in a single write.
+    void appendJournal(int unitIndex, const SweepResult *unitResults, int count)
+    {
+        if (journalFd < 0)
+            return;
+
+        int32_t record[2] = {unitIndex, count};
+        uint64_t checksum = hashBytes(hashBytes(14695981039346656037ULL, record, sizeof(record)), unitResults, size_t(count) * sizeof(SweepResult));
+        std::vector<char> buffer(sizeof(record) + size_t(count) * sizeof(SweepResult) + sizeof(checksum));
+        std::memcpy(buffer.data(), record, sizeof(record));
+        std::memcpy(buffer.data() + sizeof(record), unitResults, size_t(count) * sizeof(SweepResult));
+        std::memcpy(buffer.data() + buffer.size() - sizeof(checksum), &checksum, sizeof(checksum));
+        writeAll(journalFd, buffer.data(), buffer.size(), false);
+    }
+
+    // Member function run in a forked worker: evaluate the units the coordinator sends until it sends -1.
+    // The symbol's Data and the windows of the current lookback are kept between consecutive units.
+    void workerLoop(int fd) const
+    {
+        const std::vector<std::vector<int>> &parameterSets = sweep.getParameterSets();
+        std::shared_ptr<Data> data;
+        int loadedSymbol = -1, windowLookback = -1;
+        std::vector<float> windows;
+        std::vector<SweepResult> unitResults;
+        int32_t unitIndex;
+
+        while (readAll(fd, &unitIndex, sizeof(unitIndex)) && unitIndex >= 0)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            const ShardUnit &unit = units[unitIndex];
+            if (unit.symbolIndex != loadedSymbol)
+            {
+                const std::pair<std::string, std::string> &symbolInput = sweep.getSymbolInputs()[unit.symbolIndex];
+                data = Resampler::load(symbolInput.first, symbolInput.second, sweep.getTimeframe());
+                loadedSymbol = unit.symbolIndex;
+                windowLookback = -1;
+            }
+
+            const int numberOfRows = data->numberOfRows;
+            if (parameterSets[unit.setBegin][0] != windowLookback)
+            {
+                windowLookback = parameterSets[unit.setBegin][0];
+                windows.resize(2 * size_t(numberOfRows) + 1);
+                TrendFollowingStrategy::getKMaxMin(*data, windowLookback, windows.data(), windows.data() + numberOfRows);
+            }
+
+            unitResults.resize(size_t(unit.setEnd - unit.setBegin));
+            sweep.evaluateSets(*data, unit.symbolIndex, unit.setBegin, unit.setEnd, windows.data(), windows.data() + numberOfRows, unitResults.data());
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            int32_t reply[2] = {unitIndex, int32_t(unitResults.size())};
+            if (!writeAll(fd, reply, sizeof(reply), true) || !writeAll(fd, &seconds, sizeof(seconds), true) ||
+                !writeAll(fd, unitResults.data(), unitResults.size() * sizeof(SweepResult), true))
+                break;
+        }
+    }
+
+    // Member function to fork one worker process. The child closes every other worker's socket so a dead
+    // coordinator or sibling is seen as end of file, runs 'workerLoop' and exits without running destructors.
+    bool spawnWorker(std::vector<Worker> &workers, Worker &worker)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            return false;
+
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            close(fds[0]);
+            close(fds[1]);
+            return false;
+        }
+        if (pid == 0)
+        {
+            close(fds[0]);
+            for (size_t w = 0; w < workers.size(); w++)
+                if (workers[w].fd >= 0)
+                    close(workers[w].fd);
+            if (journalFd >= 0)
+                close(journalFd);
+            workerLoop(fds[1]);
+            _exit(0);
+        }
+
+        close(fds[1]);
+        worker.fd = fds[0];
+        worker.queued.clear();
+        worker.stats = ShardWorkerStats();
+        worker.stats.pid = pid;
+        return true;
+    }
+
+    // Member function to top a worker's queue up to UNITS_IN_FLIGHT units from 'pending', or tell an idle worker
+    // to stop when nothing is left.
+    void feedWorker(Worker &worker, std::deque<int> &pending)
+    {
+        while (int(worker.queued.size()) < UNITS_IN_FLIGHT && !pending.empty())
+        {
+            int32_t unitIndex = pending.front();
+            if (!writeAll(worker.fd, &unitIndex, sizeof(unitIndex), true))
+                return; // The worker died; poll reports it and its queue is handed back.
+            pending.pop_front();
+            worker.queued.push_back(unitIndex);
+        }
+
+        if (worker.queued.empty() && pending.empty())
+        {
+            int32_t stop = -1;
+            writeAll(worker.fd, &stop, sizeof(stop), true);
+            close(worker.fd);
+            worker.fd = -1;
+            waitpid(worker.stats.pid, nullptr, 0);
+            workerStats.push_back(worker.stats);
+        }
+    }
+
+    // Member function to retire a worker that died: its queued units go back to 'pending'.
+    void retireWorker(Worker &worker, std::deque<int> &pending)
+    {
+        for (std::deque<int>::reverse_iterator unit = worker.queued.rbegin(); unit != worker.queued.rend(); ++unit)
+            pending.push_front(*unit);
+        worker.queued.clear();
+        close(worker.fd);
+        worker.fd = -1;
+        waitpid(worker.stats.pid, nullptr, 0);
+        worker.stats.failed = true;
+        workerStats.push_back(worker.stats);
+    }
+
+public:
+    ShardCoordinator(ParameterSweep &sweep, int NUM_OF_WORKERS, int setsPerUnit = 64)
+        : sweep(sweep), NUM_OF_WORKERS(std::max(1, NUM_OF_WORKERS)), setsPerUnit(std::max(1, setsPerUnit)), resumedUnits(0), journalFd(-1)
+    {
+    }
+
+    // Function 'setCheckpointFile' journals completed units to 'checkpointFile' ("" disables checkpointing).
+    void setCheckpointFile(const std::string &checkpointFile)
+    {
+        this->checkpointFile = checkpointFile;
+    }
+
+    // Function 'run' evaluates every unit not already in the checkpoint on the worker processes, then hands the
+    // merged results to the sweep, which ranks them. 'fresh' discards an existing checkpoint. On failure it sets
+    // 'error' and returns false; the units completed so far stay in the checkpoint for the next run.
+
+    bool run(bool fresh, std::string &error)
+    {
+        sweep.buildParameterSets();
+        buildUnits();
+        results.assign(sweep.getSymbolInputs().size() * sweep.getParameterSets().size(), SweepResult());
+        unitDone.assign(units.size(), 0);
+        workerStats.clear();
+        resumedUnits = 0;
+
+        if (!checkpointFile.empty() && !openJournal(fresh, error))
+        {
+            if (journalFd >= 0)
+                close(journalFd);
+            journalFd = -1;
+            return false;
+        }
+
+        std::deque<int> pending;
+        for (int u = 0; u < int(units.size()); u++)
+            if (!unitDone[u])
+                pending.push_back(u);
+
+        std::vector<Worker> workers(size_t(std::min<size_t>(NUM_OF_WORKERS, pending.size())));
+        for (size_t w = 0; w < workers.size(); w++)
+            workers[w].fd = -1;
+        for (size_t w = 0; w < workers.size(); w++)
+        {
+            if (!spawnWorker(workers, workers[w]))
+            {
+                error = std::string("cannot start a worker process: ") + strerror(errno);
+                return false;
+            }
+            feedWorker(workers[w], pending);
+        }
+
+        int respawns = 0;
+        std::vector<SweepResult> unitResults;
+        std::vector<pollfd> pollFds;
+        std::vector<size_t> pollWorkers;
+
+        while (true)
+        {
+            pollFds.clear();
+            pollWorkers.clear();
+            for (size_t w = 0; w < workers.size(); w++)
+                if (workers[w].fd >= 0)
+                {
+                    pollfd entry = {workers[w].fd, POLLIN, 0};
+                    pollFds.push_back(entry);
+                    pollWorkers.push_back(w);
+                }
+            if (pollFds.empty())
+                break;
+
+            if (poll(pollFds.data(), pollFds.size(), -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                error = std::string("poll failed: ") + strerror(errno);
+                break;
+            }
+
+            for (size_t p = 0; p < pollFds.size(); p++)
+            {
+                if (!pollFds[p].revents)
+                    continue;
+                Worker &worker = workers[pollWorkers[p]];
+
+                int32_t reply[2];
+                double seconds = 0;
+                bool received = readAll(worker.fd, reply, sizeof(reply)) && !worker.queued.empty() && reply[0] == worker.queued.front() &&
+                                readAll(worker.fd, &seconds, sizeof(seconds));
+                if (received)
+                {
+                    unitResults.resize(size_t(reply[1]));
+                    received = readAll(worker.fd, unitResults.data(), unitResults.size() * sizeof(SweepResult));
+                }
+
+                if (!received)
+                {
+                    // The worker died (or broke the protocol): requeue its units and replace it.
+                    retireWorker(worker, pending);
+                    if (pending.empty())
+                        continue;
+                    if (++respawns > MAX_RESPAWNS || !spawnWorker(workers, worker))
+                    {
+                        error = "worker processes keep failing; completed units are in the checkpoint";
+                        break;
+                    }
+                    feedWorker(worker, pending);
+                    continue;
+                }
+
+                worker.queued.pop_front();
+                worker.stats.units++;
+                worker.stats.busySeconds += seconds;
+                storeUnit(reply[0], unitResults.data());
+                appendJournal(reply[0], unitResults.data(), reply[1]);
+                feedWorker(worker, pending);
+            }
+
+            if (!error.empty())
+                break;
+        }
+
+        // On error, stop the remaining workers; their queued units are simply not done.
+        for (size_t w = 0; w < workers.size(); w++)
+            if (workers[w].fd >= 0)
+            {
+                close(workers[w].fd);
+                waitpid(workers[w].stats.pid, nullptr, 0);
+                workerStats.push_back(workers[w].stats);
+            }
+
+        if (journalFd >= 0)
+        {
+            fdatasync(journalFd);
+            close(journalFd);
+            journalFd = -1;
+        }
+
+        if (!error.empty())
+            return false;
+        if (std::find(unitDone.begin(), unitDone.end(), 0) != unitDone.end())
+        {
+            error = "some units were not completed";
+            return false;
+        }
+
+        sweep.setResults(results);
+        return true;
+    }
+
+    int getNumOfUnits() const
+    {
+        return int(units.size());
+    }
+
+    int getResumedUnits() const
+    {
+        return resumedUnits;
+    }
+
+    const std::vector<ShardWorkerStats> &getWorkerStats() const
+    {
+        return workerStats;
+    }
+
+    // Function 'printStats' prints the units and busy time of each worker process of the last run.
+
+    void printStats() const
+    {
+        std::lock_guard<std::mutex> lock(stdOutMutex);
+        for (size_t w = 0; w < workerStats.size(); w++)
+        {
+            printf("worker pid %6d: %6d units, busy %9.3f s%s\n", int(workerStats[w].pid), workerStats[w].units, workerStats[w].busySeconds,
+                   workerStats[w].failed ? " (died, units requeued)" : "");
+        }
+        fflush(stdout);
+    }
+};
@@ -0,0 +1,395 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "common.h"
+#include "data.h"
+#include "indicators.h"
+#include "instrumentation.h"
+#include "rolling_window.h"
+
+// Define a C++ class named 'Strategy' for implementing trading strategies.
+class Strategy
+{
+public:
+    std::string strategyName;                  // Stores the name of the strategy.
+    std::map<std::string, int> strategyParams; // Stores strategy-specific parameters.
+
+    // Pure virtual function to get trade signals based on financial data.
+    virtual int8_t *getTradeSignals(const Data &data) = 0;
+
+    // Static function to calculate and return the percentage change between two values.
+    static float findPercentageChange(const float &startValue, const float &endValue)
+    {
+        return ((endValue - startValue) * 100) / startValue;
+    }
+
+    // Virtual destructor for the class.
+    virtual ~Strategy()
+    {
+        // Destructor is empty here; it can be overridden in derived classes.
+    }
+};
+
+// Define a C++ class named 'IndicatorStrategy' for strategies built on an IndicatorGraph.
+// Instead of computing its own indicators, such a strategy declares the series it reads and computes its signals
+// from the graph, so strategies run together on one symbol (MultiStrategyRunner) share every series they have in
+// common. Run alone through getTradeSignals, it builds a graph of its own.
+class IndicatorStrategy : public Strategy
+{
+public:
+    // Pure virtual function to declare every series 'computeSignals' reads.
+    virtual void declareIndicators(IndicatorGraph &graph) const = 0;
+
+    // Pure virtual function to write one signal per row of graph.getData() into 'signals', reading only the
+    // columns and the declared series. It must not keep state between calls: one instance runs on many symbols at once.
+    virtual void computeSignals(const IndicatorGraph &graph, int8_t *signals) const = 0;
+
+    int8_t *getTradeSignals(const Data &data)
+    {
+        TF_PROFILE_SCOPE(TRADE_SIGNALS);
+
+        IndicatorGraph graph(data);
+        declareIndicators(graph);
+        graph.compute();
+
+        int8_t *signals = new int8_t[data.numberOfRows]; // Allocate memory for the signals.
+        computeSignals(graph, signals);
+        return signals; // Return the array of trading signals.
+    }
+};
+
+// Define a C++ struct named 'TrendFollowingParams' that holds the TrendFollowingStrategy parameters resolved
+// out of the strategyParams map once, so the per-bar loop reads plain integers instead of doing map lookups.
+struct TrendFollowingParams
+{
+    int lookBackPeriod;   // Stores LOOKBACK_PERIOD.
+    int enterTrigger;     // Stores ENTER_TRIGGER_PERCENTAGE.
+    int exitTrigger;      // Stores EXIT_TRIGGER_PERCENTAGE.
+    int targetPercentage; // Stores TARGET_PERCENTAGE.
+    int stopLoss;         // Stores STOP_LOSS_PERCENTAGE.
+
+    // Static function to read the parameters from a strategyParams map (a missing key reads as 0).
+    // The keys are built once, so resolving the parameters does not allocate.
+    static TrendFollowingParams fromMap(const std::map<std::string, int> &strategyParams)
+    {
+        static const std::string keys[] = {"LOOKBACK_PERIOD", "ENTER_TRIGGER_PERCENTAGE", "EXIT_TRIGGER_PERCENTAGE",
+                                           "TARGET_PERCENTAGE", "STOP_LOSS_PERCENTAGE"};
+        TrendFollowingParams params;
+        params.lookBackPeriod = getParam(strategyParams, keys[0]);
+        params.enterTrigger = getParam(strategyParams, keys[1]);
+        params.exitTrigger = getParam(strategyParams, keys[2]);
+        params.targetPercentage = getParam(strategyParams, keys[3]);
+        params.stopLoss = getParam(strategyParams, keys[4]);
+        return params;
+    }
+
+private:
+    static int getParam(const std::map<std::string, int> &strategyParams, const std::string &name)
+    {
+        std::map<std::string, int>::const_iterator it = strategyParams.find(name);
+        return it == strategyParams.end() ? 0 : it->second;
+    }
+};
+
+// Define a C++ struct template named 'FixedTrendFollowingParams' that carries the same parameters as
+// compile-time constants. Passed to TrendFollowingStrategy::computeSignals it lets the compiler fold the
+// thresholds into the inlined per-bar loop for fixed production configurations.
+template <int LOOKBACK_PERIOD, int ENTER_TRIGGER, int EXIT_TRIGGER, int TARGET_PERCENTAGE, int STOP_LOSS>
+struct FixedTrendFollowingParams
+{
+    static const int lookBackPeriod = LOOKBACK_PERIOD;
+    static const int enterTrigger = ENTER_TRIGGER;
+    static const int exitTrigger = EXIT_TRIGGER;
+    static const int targetPercentage = TARGET_PERCENTAGE;
+    static const int stopLoss = STOP_LOSS;
+};
+
+class TrendFollowingStrategy : public IndicatorStrategy
+{
+public:
+    // Define trade states as an enum.
+    enum TradeState
+    {
+        NO_POSITION = 0,
+        LONG_POSITION = 1,
+        SHORT_POSITION = -1
+    };
+
+    TrendFollowingStrategy(std::string strategyName)
+    {
+        this->strategyName = strategyName;
+        strategyParams["LOOKBACK_PERIOD"] = 90;
+        strategyParams["ENTER_TRIGGER_PERCENTAGE"] = 5;
+        strategyParams["EXIT_TRIGGER_PERCENTAGE"] = 5;
+        strategyParams["TARGET_PERCENTAGE"] = 20;
+        strategyParams["STOP_LOSS_PERCENTAGE"] = 10;
+    }
+
+    TrendFollowingStrategy(std::string strategyName, int lookBackPeriod, int entryTrigger, int exitTrigger, int targetPercentage, int stopLoss)
+    {
+        this->strategyName = strategyName;
+        strategyParams["LOOKBACK_PERIOD"] = lookBackPeriod;
+        strategyParams["ENTER_TRIGGER_PERCENTAGE"] = entryTrigger;
+        strategyParams["EXIT_TRIGGER_PERCENTAGE"] = exitTrigger;
+        strategyParams["TARGET_PERCENTAGE"] = targetPercentage;
+        strategyParams["STOP_LOSS_PERCENTAGE"] = stopLoss;
+    }
+
+    // Function 'getKMaxMin' calculates the maximum and minimum closing prices within a sliding window of size K
+    // in one fused pass, writing them into caller-provided arrays of data.numberOfRows floats.
+
+    // Parameters:
+    // - 'data': The financial data containing historical closing prices.
+    // - 'K': The size of the sliding window.
+    // - 'kmax', 'kmin': The output arrays for the K-maximum and K-minimum closing prices.
+
+    static void getKMaxMin(const Data &data, int K, float *kmax, float *kmin)
+    {
+        RollingWindow::compute(data.closePrices().data(), data.numberOfRows, K, kmax, kmin);
+    }
+
+    // Function 'getKMax' calculates the maximum closing prices within a sliding window of size K
+    // and returns an array of those maximum values.
+
+    // Returns:
+    // - A dynamically allocated array of floats containing the K-maximum closing prices.
+
+    static float *getKMax(const Data &data, int K)
+    {
+        float *kmax = new float[data.numberOfRows]; // Allocate memory for the K-maximum array.
+        getKMaxMin(data, K, kmax, ScratchArena::get<float>(ScratchArena::WINDOW_MIN, size_t(data.numberOfRows)));
+        return kmax; // Return the array of K-maximum closing prices.
+    }
+
+    // Function 'getKMin' calculates the minimum closing prices within a sliding window of size K
+    // and returns an array of those minimum values.
+
+    // Returns:
+    // - A dynamically allocated array of floats containing the K-minimum closing prices.
+
+    static float *getKMin(const Data &data, int K)
+    {
+        float *kmin = new float[data.numberOfRows]; // Allocate memory for the K-minimum array.
+        getKMaxMin(data, K, ScratchArena::get<float>(ScratchArena::WINDOW_MAX, size_t(data.numberOfRows)), kmin);
+        return kmin; // Return the array of K-minimum closing prices.
+    }
+
+    // Function 'getTradeSignals' calculates trading signals based on a trend-following strategy.
+    // It evaluates historical data to determine buy (1) and sell (-1) signals for long and short positions.
+
+    // Parameters:
+    // - 'data': The financial data containing historical closing prices and volume.
+
+    // Returns:
+    // - A dynamically allocated array of int8_t values representing trading signals:
+    //   - 1: Buy signal (long position)
+    //   - -1: Sell signal (exit long position)
+    //   - 2: Short signal (short position)
+    //   - -2: Cover signal (exit short position)
+    //   - 0: No action
+
+    int8_t *getTradeSignals(const Data &data)
+    {
+        TF_PROFILE_SCOPE(TRADE_SIGNALS);
+
+        // Calculate K-maximum and K-minimum arrays into this thread's reusable scratch buffers.
+        float *kmax = ScratchArena::get<float>(ScratchArena::WINDOW_MAX, size_t(data.numberOfRows));
+        float *kmin = ScratchArena::get<float>(ScratchArena::WINDOW_MIN, size_t(data.numberOfRows));
+        TrendFollowingParams params = getParams();
+        TrendFollowingStrategy::getKMaxMin(data, params.lookBackPeriod, kmax, kmin);
+
+        int8_t *signals = new int8_t[data.numberOfRows]; // Allocate memory for the signals.
+        computeSignals(data, kmax, kmin, params, signals);
+        return signals; // Return the array of trading signals.
+    }
+
+    // Overload of 'getTradeSignals' that runs the strategy on precomputed K-maximum and K-minimum arrays.
+    // The arrays must have been built with this strategy's LOOKBACK_PERIOD; this lets a parameter sweep
+    // compute the windows once and share them across every parameter set with the same lookback.
+
+    int8_t *getTradeSignals(const Data &data, const float *kmax, const float *kmin)
+    {
+        int8_t *signals = new int8_t[data.numberOfRows]; // Allocate memory for the signals.
+        computeSignals(data, kmax, kmin, getParams(), signals);
+        return signals; // Return the array of trading signals.
+    }
+
+    // Function 'declareIndicators' declares the LOOKBACK_PERIOD maximum and minimum; every TrendFollowingStrategy
+    // with the same lookback reads the same two series.
+
+    void declareIndicators(IndicatorGraph &graph) const
+    {
+        int lookBackPeriod = getParams().lookBackPeriod;
+        graph.declare(INDICATOR_ROLLING_MAX, lookBackPeriod);
+        graph.declare(INDICATOR_ROLLING_MIN, lookBackPeriod);
+    }
+
+    // Function 'computeSignals' runs the strategy on the graph's windows; the signals equal getTradeSignals(data).
+
+    void computeSignals(const IndicatorGraph &graph, int8_t *signals) const
+    {
+        TrendFollowingParams params = getParams();
+        computeSignals(graph.getData(), graph.get(INDICATOR_ROLLING_MAX, params.lookBackPeriod),
+                       graph.get(INDICATOR_ROLLING_MIN, params.lookBackPeriod), params, signals);
+    }
+
+    // Function 'getParams' resolves the strategyParams map into a TrendFollowingParams struct.
+    // The map stays the configuration API; the signal loops only ever see the resolved struct.
+    // FixedTrendFollowingStrategy returns its template arguments instead.
+
+    virtual TrendFollowingParams getParams() const
+    {
+        return TrendFollowingParams::fromMap(strategyParams);
+    }
+
+    // Function 'computeSignals' runs the trade state machine over every bar and writes one signal per row.
+    // 'PARAMS' is either a TrendFollowingParams (thresholds read from the struct) or a FixedTrendFollowingParams
+    // instantiation (thresholds are compile-time constants); getNextSignal is inlined into the loop either way.
+
+    // Parameters:
+    // - 'data': The financial data containing historical closing prices.
+    // - 'kmax', 'kmin': The K-maximum and K-minimum arrays built with params.lookBackPeriod.
+    // - 'params': The strategy thresholds.
+    // - 'signals': The output array of data.numberOfRows signals.
+
+    template <typename PARAMS>
+    static void computeSignals(const Data &data, const float *kmax, const float *kmin, const PARAMS &params, int8_t *signals)
+    {
+        const float *closePrices = data.closePrices().data(); // Read the close column directly.
+        const int numberOfRows = data.numberOfRows;
+        const int enterTrigger = params.enterTrigger;
+        const int exitTrigger = params.exitTrigger;
+        const int targetPercentage = params.targetPercentage;
+        const int stopLoss = params.stopLoss;
+        TradeState state = NO_POSITION; // Initialize the trade state to no position.
+        int tradePrice = 0;             // Initialize the trade price.
+
+        for (int i = 0; i < numberOfRows; i++)
+        {
+            signals[i] = getNextSignal(state, tradePrice, closePrices[i], kmax[i], kmin[i],
+                                       enterTrigger, exitTrigger, targetPercentage, stopLoss);
+        }
+    }
+
+    // Function 'getNextSignal' advances the trade state machine by one bar and returns that bar's signal.
+    // It is shared by the batch path above and the bar-by-bar IncrementalTrendFollowingStrategy, so both
+    // produce identical signals.
+
+    // Parameters:
+    // - 'state', 'tradePrice': The state carried from the previous bar; updated in place.
+    // - 'closePrice': The closing price of the current bar.
+    // - 'kmaxValue', 'kminValue': The K-maximum and K-minimum closing prices ending at the current bar.
+    // - The remaining parameters are the strategy's percentage thresholds.
+
+    static inline int8_t getNextSignal(TradeState &state, int &tradePrice, float closePrice, float kmaxValue, float kminValue,
+                                int enterTrigger, int exitTrigger, int targetPercentage, int stopLoss)
+    {
+        int maxPercentIncrease = findPercentageChange(kminValue, closePrice);
+        int maxPercentDecrease = -1 * findPercentageChange(kmaxValue, closePrice);
+
+        if (state == NO_POSITION)
+        {
+            if (maxPercentIncrease >= enterTrigger)
+            {
+                state = LONG_POSITION;
+                tradePrice = closePrice;
+                return 1; // Set a buy signal for a long position.
+            }
+            else if (maxPercentDecrease >= enterTrigger)
+            {
+                state = SHORT_POSITION;
+                tradePrice = closePrice;
+                return 2; // Set a short signal for a short position.
+            }
+        }
+        else if (state == LONG_POSITION)
+        {
+            if (findPercentageChange(tradePrice, closePrice) >= targetPercentage ||
+                maxPercentDecrease >= exitTrigger ||
+                (-1 * findPercentageChange(tradePrice, closePrice) >= stopLoss))
+            {
+                state = NO_POSITION;
+                return -1; // Set a sell signal to exit the long position.
+            }
+        }
+        else if (state == SHORT_POSITION)
+        {
+            if ((-1 * findPercentageChange(tradePrice, closePrice)) >= targetPercentage ||
+                maxPercentIncrease >= exitTrigger ||
+                (findPercentageChange(tradePrice, closePrice) >= stopLoss))
+            {
+                state = NO_POSITION;
+                return -2; // Set a cover signal to exit the short position.
+            }
+        }
+
+        return 0; // No action.
+    }
+
+    ~TrendFollowingStrategy()
+    {
+        strategyParams.clear();
+        if (DEBUG)
+            printMessage("Deconstructing Strategy Object");
+    }
+};
+
+// Define a C++ class template named 'FixedTrendFollowingStrategy' for a TrendFollowingStrategy whose parameters
+// are fixed at compile time. The strategyParams map mirrors the template arguments so results still list them,
+// but neither getTradeSignals nor the IndicatorGraph path reads it: the windows and the inlined signal loop use the
+// constants directly, so editing the map cannot make the two paths disagree.
+template <int LOOKBACK_PERIOD, int ENTER_TRIGGER, int EXIT_TRIGGER, int TARGET_PERCENTAGE, int STOP_LOSS>
+class FixedTrendFollowingStrategy : public TrendFollowingStrategy
+{
+public:
+    typedef FixedTrendFollowingParams<LOOKBACK_PERIOD, ENTER_TRIGGER, EXIT_TRIGGER, TARGET_PERCENTAGE, STOP_LOSS> Params;
+
+    FixedTrendFollowingStrategy(std::string strategyName)
+        : TrendFollowingStrategy(strategyName, LOOKBACK_PERIOD, ENTER_TRIGGER, EXIT_TRIGGER, TARGET_PERCENTAGE, STOP_LOSS)
+    {
+    }
+
+    using TrendFollowingStrategy::getTradeSignals;
+
+    TrendFollowingParams getParams() const
+    {
+        TrendFollowingParams params;
+        params.lookBackPeriod = LOOKBACK_PERIOD;
+        params.enterTrigger = ENTER_TRIGGER;
+        params.exitTrigger = EXIT_TRIGGER;
+        params.targetPercentage = TARGET_PERCENTAGE;
+        params.stopLoss = STOP_LOSS;
+        return params;
+    }
+
+    int8_t *getTradeSignals(const Data &data)
+    {
+        TF_PROFILE_SCOPE(TRADE_SIGNALS);
+
+        float *kmax = ScratchArena::get<float>(ScratchArena::WINDOW_MAX, size_t(data.numberOfRows));
+        float *kmin = ScratchArena::get<float>(ScratchArena::WINDOW_MIN, size_t(data.numberOfRows));
+        TrendFollowingStrategy::getKMaxMin(data, LOOKBACK_PERIOD, kmax, kmin);
+
+        int8_t *signals = new int8_t[data.numberOfRows]; // Allocate memory for the signals.
+        TrendFollowingStrategy::computeSignals(data, kmax, kmin, Params(), signals);
+        return signals; // Return the array of trading signals.
+    }
+
+    void declareIndicators(IndicatorGraph &graph) const
+    {
+        graph.declare(INDICATOR_ROLLING_MAX, LOOKBACK_PERIOD);
+        graph.declare(INDICATOR_ROLLING_MIN, LOOKBACK_PERIOD);
+    }
+
+    void computeSignals(const IndicatorGraph &graph, int8_t *signals) const
+    {
+        TrendFollowingStrategy::computeSignals(graph.getData(), graph.get(INDICATOR_ROLLING_MAX, LOOKBACK_PERIOD),
+                                               graph.get(INDICATOR_ROLLING_MIN, LOOKBACK_PERIOD), Params(), signals);
+    }
+};
+
+// The production configuration run by default (the same parameters as TrendFollowingStrategy's defaults).
+typedef FixedTrendFollowingStrategy<90, 5, 5, 20, 10> DefaultTrendFollowingStrategy;
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "data.h"
+#include "strategy.h"
+
+// Define a C++ class named 'MonotonicWindow' that tracks the extreme (max or min) of the last K values pushed.
+// It is the monotonic deque used by getKMax/getKMin, stored in a fixed ring buffer of K slots that is allocated
+// once, so a live feed costs O(1) amortized time and constant memory per bar.
+// 'Dominates(a, b)' must return true when a new value 'a' makes an older value 'b' useless
+// (std::greater_equal<float> for a rolling maximum, std::less_equal<float> for a rolling minimum).
+template <typename Dominates>
+class MonotonicWindow
+{
+    int K;                        // Stores the window size.
+    std::vector<int64_t> indices; // Stores the bar index of each slot.
+    std::vector<float> values;    // Stores the value of each slot.
+    int head;                     // Stores the ring position of the front of the deque.
+    int count;                    // Stores the number of slots in use.
+
+public:
+    explicit MonotonicWindow(int K)
+        : K(std::max(1, K)), indices(std::max(1, K)), values(std::max(1, K)), head(0), count(0)
+    {
+    }
+
+    void reset()
+    {
+        head = 0;
+        count = 0;
+    }
+
+    // Member function to add the value of bar 'index' and return the extreme of bars [index - K + 1, index].
+    float push(int64_t index, float value)
+    {
+        // Remove elements from the front of the deque if they are outside the window.
+        while (count && indices[head] <= index - K)
+        {
+            head = head + 1 == K ? 0 : head + 1;
+            count--;
+        }
+
+        // Remove elements from the back of the deque that the new value dominates.
+        Dominates dominates;
+        while (count)
+        {
+            int back = (head + count - 1) % K;
+            if (!dominates(value, values[back]))
+                break;
+            count--;
+        }
+
+        int slot = (head + count) % K;
+        indices[slot] = index;
+        values[slot] = value;
+        count++;
+
+        return values[head]; // Return the extreme value of the window.
+    }
+};
+
+// Define a C++ class named 'IncrementalStrategy' for strategies that consume one bar at a time from a live feed.
+class IncrementalStrategy
+{
+public:
+    std::string strategyName; // Stores the name of the strategy.
+
+    // Pure virtual function to consume the next bar and return its signal (same encoding as getTradeSignals).
+    virtual int8_t onBar(const DataPoint &bar) = 0;
+
+    // Pure virtual function to forget all history and start over.
+    virtual void reset() = 0;
+
+    virtual ~IncrementalStrategy()
+    {
+    }
+};
+
+// Define a C++ class named 'IncrementalTrendFollowingStrategy' that runs TrendFollowingStrategy bar by bar.
+// It keeps only the rolling max/min windows and the trade state, and produces the same signals as the batch path.
+class IncrementalTrendFollowingStrategy : public IncrementalStrategy
+{
+    int lookBackPeriod, enterTrigger, exitTrigger, targetPercentage, stopLoss;
+    MonotonicWindow<std::greater_equal<float>> rollingMax; // Stores the K-maximum state.
+    MonotonicWindow<std::less_equal<float>> rollingMin;    // Stores the K-minimum state.
+    TrendFollowingStrategy::TradeState state;              // Stores the current trade state.
+    int tradePrice;                                        // Stores the entry price of the open trade.
+    int64_t barIndex;                                      // Stores the index of the next bar.
+
+public:
+    IncrementalTrendFollowingStrategy(std::string strategyName, int lookBackPeriod, int entryTrigger, int exitTrigger, int targetPercentage, int stopLoss)
+        : lookBackPeriod(lookBackPeriod), enterTrigger(entryTrigger), exitTrigger(exitTrigger), targetPercentage(targetPercentage), stopLoss(stopLoss),
+          rollingMax(lookBackPeriod), rollingMin(lookBackPeriod), state(TrendFollowingStrategy::NO_POSITION), tradePrice(0), barIndex(0)
+    {
+        this->strategyName = strategyName;
+    }
+
+    // Constructor that takes parameters already resolved into a TrendFollowingParams struct.
+    IncrementalTrendFollowingStrategy(std::string strategyName, const TrendFollowingParams &params)
+        : IncrementalTrendFollowingStrategy(strategyName, params.lookBackPeriod, params.enterTrigger, params.exitTrigger,
+                                            params.targetPercentage, params.stopLoss)
+    {
+    }
+
+    // Constructor that copies the parameters of a (batch) TrendFollowingStrategy, resolved by TrendFollowingParams::fromMap.
+    explicit IncrementalTrendFollowingStrategy(const Strategy &strategy)
+        : IncrementalTrendFollowingStrategy(strategy.strategyName, TrendFollowingParams::fromMap(strategy.strategyParams))
+    {
+    }
+
+    int8_t onBar(const DataPoint &bar)
+    {
+        float kmaxValue = rollingMax.push(barIndex, bar.closePrice);
+        float kminValue = rollingMin.push(barIndex, bar.closePrice);
+        barIndex++;
+
+        return TrendFollowingStrategy::getNextSignal(state, tradePrice, bar.closePrice, kmaxValue, kminValue,
+                                                     enterTrigger, exitTrigger, targetPercentage, stopLoss);
+    }
+
+    void reset()
+    {
+        rollingMax.reset();
+        rollingMin.reset();
+        state = TrendFollowingStrategy::NO_POSITION;
+        tradePrice = 0;
+        barIndex = 0;
+    }
+};
+
+// Define a C++ struct named 'ReplayReport' to store the outcome of replaying one symbol through a streaming strategy.
+struct ReplayReport
+{
+    std::string symbolName;
+    int bars;              // Stores the number of bars replayed.
+    int mismatches;        // Stores the number of bars whose streaming signal differs from the batch signal.
+    int firstMismatch;     // Stores the first mismatching bar (-1 when identical).
+    double latencyNs[5];   // Stores the p50, p90, p99, p99.9 and max per-bar latency in nanoseconds.
+};
+
+// Define a C++ class named 'ReplayHarness' that feeds a loaded Data bar by bar through an IncrementalStrategy,
+// compares every signal with the batch getTradeSignals output and records the per-bar latency.
+class ReplayHarness
+{
+public:
+    static ReplayReport replay(const Data &data, Strategy &batchStrategy, IncrementalStrategy &streamingStrategy)
+    {
+        ReplayReport report;
+        report.symbolName = data.symbolName;
+        report.bars = data.numberOfRows;
+        report.mismatches = 0;
+        report.firstMismatch = -1;
+
+        std::unique_ptr<int8_t[]> batchSignals(batchStrategy.getTradeSignals(data));
+        std::vector<int64_t> latencies(size_t(data.numberOfRows));
+
+        streamingStrategy.reset();
+        for (int i = 0; i < data.numberOfRows; i++)
+        {
+            DataPoint bar = data.getRow(i);
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            int8_t signal = streamingStrategy.onBar(bar);
+            latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+            if (signal != batchSignals[i])
+            {
+                if (report.firstMismatch < 0)
+                    report.firstMismatch = i;
+                report.mismatches++;
+            }
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        const double quantiles[5] = {0.5, 0.9, 0.99, 0.999, 1.0};
+        for (int q = 0; q < 5; q++)
+        {
+            size_t rank = latencies.empty() ? 0 : std::min(latencies.size() - 1, size_t(quantiles[q] * latencies.size()));
+            report.latencyNs[q] = latencies.empty() ? 0 : double(latencies[rank]);
+        }
+
+        return report;
+    }
+};
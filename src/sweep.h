@@ -0,0 +1,486 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "backtest.h"
+#include "batch_signals.h"
+#include "execution.h"
+#include "metrics.h"
+#include "resample.h"
+#include "strategy.h"
+#include "thread_pool.h"
+
+// Define a C++ struct named 'ParameterRange' to describe an inclusive "start:end:step" range of one strategy parameter.
+struct ParameterRange
+{
+    int start; // Stores the first value of the range.
+    int end;   // Stores the last value of the range (inclusive).
+    int step;  // Stores the increment between consecutive values.
+
+    ParameterRange()
+        : start(0), end(0), step(1)
+    {
+    }
+
+    ParameterRange(int start, int end, int step)
+        : start(start), end(end), step(step > 0 ? step : 1)
+    {
+    }
+
+    // Member function to return the number of values in the range.
+    int count() const
+    {
+        return end < start ? 0 : (end - start) / step + 1;
+    }
+
+    // Member function to return the i-th value of the range.
+    int valueAt(int i) const
+    {
+        return start + i * step;
+    }
+
+    // Static function to parse "start:end:step", "start:end" or a single "value".
+    static bool parse(const std::string &text, ParameterRange &range)
+    {
+        int start, end, step;
+        int fields = sscanf(text.c_str(), "%d:%d:%d", &start, &end, &step);
+
+        if (fields == 1)
+            range = ParameterRange(start, start, 1);
+        else if (fields == 2)
+            range = ParameterRange(start, end, 1);
+        else if (fields == 3 && step > 0)
+            range = ParameterRange(start, end, step);
+        else
+            return false;
+
+        return range.count() > 0;
+    }
+};
+
+// Define a C++ struct named 'SweepResult' to store the outcome of one (symbol, parameter set) backtest.
+struct SweepResult
+{
+    int symbolIndex;       // Stores the index of the symbol in the sweep's symbol list.
+    int params[5];         // Stores the parameter set, ordered as in 'ParameterSweep::getParamName'.
+    BacktestResult result; // Stores the evaluated trade statistics.
+    PerformanceMetrics metrics; // Stores the risk metrics (only computed when ranking by one of them).
+};
+
+// Define a C++ class named 'ParameterSweep' that grids TrendFollowingStrategy over many parameter sets per symbol.
+// Each symbol's Data is loaded once and the K-maximum/K-minimum windows are computed once per (symbol, LOOKBACK_PERIOD),
+// then shared by every parameter set with that lookback.
+class ParameterSweep
+{
+public:
+    static const int NUM_OF_PARAMS = 5;
+
+    // Parameter sets evaluated per pass over a symbol's close column.
+    typedef BatchSignals<8> BatchLanes;
+
+private:
+    int NUM_OF_THREADS;
+    std::vector<std::pair<std::string, std::string>> symbolInputs; // Stores (symbol name, csv file) pairs.
+    ParameterRange ranges[NUM_OF_PARAMS];                          // Stores the range of each parameter.
+    long long sampleSize;                                          // Stores the random sample size (0 means full grid).
+    unsigned int seed;                                             // Stores the seed used for random sampling.
+    bool scalarReference;                                          // Stores whether to skip the SIMD kernel.
+    ExecutionSettings execution;                                   // Stores the execution model (close-only by default).
+    Timeframe timeframe;                                           // Stores the bar size the csv files are resampled to.
+    MetricsRank rank;                                              // Stores the statistic the results are ranked by.
+
+    std::vector<std::shared_ptr<Data>> symbolData; // Stores the loaded data, one entry per symbol input.
+    std::vector<std::vector<int>> parameterSets;   // Stores the parameter sets, sorted so equal lookbacks are adjacent.
+    std::vector<std::pair<int, int>> lookbackGroups; // Stores [begin, end) ranges of 'parameterSets' sharing a lookback.
+    std::vector<SweepResult> results;              // Stores one result per (symbol, parameter set).
+    std::vector<WorkerStats> workerStats;          // Stores the per-worker statistics of the last run.
+
+public:
+    ParameterSweep()
+        : NUM_OF_THREADS(std::max(1u, std::thread::hardware_concurrency())), sampleSize(0), seed(42), scalarReference(false),
+          rank(RANK_PROFIT)
+    {
+        // Default grid centred around the parameters used by the single-run backtest.
+        ranges[0] = ParameterRange(30, 120, 30);
+        ranges[1] = ParameterRange(3, 7, 1);
+        ranges[2] = ParameterRange(3, 7, 1);
+        ranges[3] = ParameterRange(10, 30, 5);
+        ranges[4] = ParameterRange(5, 15, 5);
+    }
+
+    // Static function to return the strategyParams key of the i-th sweep parameter.
+    static const char *getParamName(int i)
+    {
+        static const char *names[NUM_OF_PARAMS] = {"LOOKBACK_PERIOD", "ENTER_TRIGGER_PERCENTAGE", "EXIT_TRIGGER_PERCENTAGE",
+                                                   "TARGET_PERCENTAGE", "STOP_LOSS_PERCENTAGE"};
+        return names[i];
+    }
+
+    void setNumOfThreads(int numOfThreads)
+    {
+        NUM_OF_THREADS = numOfThreads > 0 ? numOfThreads : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    void setSymbolInputs(const std::vector<std::pair<std::string, std::string>> &symbolInputs)
+    {
+        this->symbolInputs = symbolInputs;
+    }
+
+    void setRange(int param, const ParameterRange &range)
+    {
+        ranges[param] = range;
+    }
+
+    // Function 'setScalarReference' evaluates parameter sets one at a time with the scalar state machine instead of
+    // the SIMD kernel; the results are identical, so this only exists to check and measure the kernel.
+    void setScalarReference(bool scalarReference)
+    {
+        this->scalarReference = scalarReference;
+    }
+
+    // Function 'setExecution' sets how trades are filled. The SIMD lanes only model close fills without costs, so
+    // any other model evaluates each parameter set with one ExecutionEngine pass over the shared windows.
+    void setExecution(const ExecutionSettings &execution)
+    {
+        this->execution = execution;
+    }
+
+    // Function 'setTimeframe' resamples every loaded csv file to 'timeframe' (native keeps the file's bars).
+    void setTimeframe(const Timeframe &timeframe)
+    {
+        this->timeframe = timeframe;
+    }
+
+    // Function 'setRank' ranks the results by a risk-adjusted statistic instead of total profit. Every parameter set
+    // then gets one MetricsEngine pass (signals, trades and metrics fused) in place of its SIMD lane; the metrics
+    // assume close fills, so this is only offered with the close-only execution model.
+    void setRank(MetricsRank rank)
+    {
+        this->rank = rank;
+    }
+
+    void setSampling(long long sampleSize, unsigned int seed)
+    {
+        this->sampleSize = sampleSize;
+        this->seed = seed;
+    }
+
+    // Function 'getGridSize' returns the number of parameter sets in the full Cartesian grid.
+
+    long long getGridSize() const
+    {
+        long long gridSize = 1;
+        for (int p = 0; p < NUM_OF_PARAMS; p++)
+            gridSize *= ranges[p].count();
+        return gridSize;
+    }
+
+    const std::vector<std::pair<std::string, std::string>> &getSymbolInputs() const
+    {
+        return symbolInputs;
+    }
+
+    const Timeframe &getTimeframe() const
+    {
+        return timeframe;
+    }
+
+    const ExecutionSettings &getExecution() const
+    {
+        return execution;
+    }
+
+    MetricsRank getRank() const
+    {
+        return rank;
+    }
+
+    // Function 'getLookbackGroups' returns the [begin, end) ranges of 'getParameterSets' that share a lookback.
+    const std::vector<std::pair<int, int>> &getLookbackGroups() const
+    {
+        return lookbackGroups;
+    }
+
+    const std::vector<std::vector<int>> &getParameterSets() const
+    {
+        return parameterSets;
+    }
+
+    const std::vector<SweepResult> &getResults() const
+    {
+        return results;
+    }
+
+    // Function 'buildParameterSets' enumerates the full grid, or draws 'sampleSize' distinct grid points
+    // using Floyd's sampling algorithm so the grid itself never has to be materialized.
+    // Grid indices are decoded with LOOKBACK_PERIOD as the most significant digit, so sorting the indices
+    // leaves parameter sets with the same lookback next to each other.
+
+    void buildParameterSets()
+    {
+        long long gridSize = getGridSize();
+        std::vector<long long> gridIndices;
+
+        if (sampleSize <= 0 || sampleSize >= gridSize)
+        {
+            for (long long i = 0; i < gridSize; i++)
+                gridIndices.push_back(i);
+        }
+        else
+        {
+            std::mt19937_64 generator(seed);
+            std::set<long long> chosen;
+
+            for (long long j = gridSize - sampleSize; j < gridSize; j++)
+            {
+                long long candidate = std::uniform_int_distribution<long long>(0, j)(generator);
+                chosen.insert(chosen.count(candidate) ? j : candidate);
+            }
+
+            gridIndices.assign(chosen.begin(), chosen.end());
+        }
+
+        parameterSets.clear();
+        lookbackGroups.clear();
+
+        for (size_t i = 0; i < gridIndices.size(); i++)
+        {
+            std::vector<int> params(NUM_OF_PARAMS);
+            long long index = gridIndices[i];
+
+            for (int p = NUM_OF_PARAMS - 1; p >= 0; p--)
+            {
+                params[p] = ranges[p].valueAt(int(index % ranges[p].count()));
+                index /= ranges[p].count();
+            }
+
+            if (parameterSets.empty() || parameterSets.back()[0] != params[0])
+                lookbackGroups.push_back(std::make_pair(int(parameterSets.size()), int(parameterSets.size())));
+
+            parameterSets.push_back(params);
+            lookbackGroups.back().second = int(parameterSets.size());
+        }
+    }
+
+    // Function 'evaluateSets' backtests parameter sets [setBegin, setEnd) of one lookback group on 'data' into
+    // out[0, setEnd - setBegin), using K-maximum and K-minimum windows computed once for the whole group.
+    // The sets are evaluated BatchLanes::NUM_OF_LANES at a time in SIMD lanes (or one at a time in scalar reference mode).
+    // It only reads the sweep's settings, so other processes (ShardCoordinator workers) can call it on their own data.
+
+    void evaluateSets(const Data &data, int symbolIndex, int setBegin, int setEnd, const float *kmax, const float *kmin, SweepResult *out) const
+    {
+        ThresholdSet sets[BatchLanes::NUM_OF_LANES];
+        BacktestResult batchResults[BatchLanes::NUM_OF_LANES];
+
+        for (int batchBegin = setBegin; batchBegin < setEnd; batchBegin += BatchLanes::NUM_OF_LANES)
+        {
+            int count = std::min(setEnd - batchBegin, int(BatchLanes::NUM_OF_LANES));
+            SweepResult *batchOut = out + (batchBegin - setBegin);
+            for (int lane = 0; lane < count; lane++)
+            {
+                const std::vector<int> &params = parameterSets[batchBegin + lane];
+                sets[lane].enterTrigger = params[1];
+                sets[lane].exitTrigger = params[2];
+                sets[lane].targetPercentage = params[3];
+                sets[lane].stopLoss = params[4];
+            }
+
+            if (rank != RANK_PROFIT)
+            {
+                for (int lane = 0; lane < count; lane++)
+                {
+                    const std::vector<int> &params = parameterSets[batchBegin + lane];
+                    TrendFollowingParams laneParams = {params[0], params[1], params[2], params[3], params[4]};
+                    batchOut[lane].metrics = MetricsEngine::computeTrendFollowing(data, laneParams, kmax, kmin);
+                    batchResults[lane] = batchOut[lane].metrics.trades;
+                }
+            }
+            else if (!execution.isCloseOnly())
+            {
+                ExecutionEngine engine(execution);
+                for (int lane = 0; lane < count; lane++)
+                {
+                    const std::vector<int> &params = parameterSets[batchBegin + lane];
+                    TrendFollowingParams laneParams = {params[0], params[1], params[2], params[3], params[4]};
+                    batchResults[lane] = engine.run(data, laneParams, kmax, kmin);
+                }
+            }
+            else if (scalarReference)
+                BatchLanes::evaluateScalar(data, kmax, kmin, sets, count, batchResults);
+            else
+                BatchLanes::evaluate(data, kmax, kmin, sets, count, batchResults);
+
+            for (int lane = 0; lane < count; lane++)
+            {
+                const std::vector<int> &params = parameterSets[batchBegin + lane];
+                batchOut[lane].symbolIndex = symbolIndex;
+                std::copy(params.begin(), params.end(), batchOut[lane].params);
+                batchOut[lane].result = batchResults[lane];
+            }
+        }
+    }
+
+    // Function 'evaluateParameterSets' evaluates parameter sets [setBegin, setEnd) on one loaded symbol.
+    // Each (symbol, parameter set) owns a fixed slot, so workers never contend on the results vector.
+
+    void evaluateParameterSets(int symbolIndex, int setBegin, int setEnd, const float *kmax, const float *kmin)
+    {
+        evaluateSets(*symbolData[symbolIndex], symbolIndex, setBegin, setEnd, kmax, kmin,
+                     &results[size_t(symbolIndex) * parameterSets.size() + setBegin]);
+    }
+
+    // Function 'evaluateLookbackGroup' computes the K-maximum and K-minimum windows of one (symbol, lookback group)
+    // and splits the group's parameter sets into tasks of 'PARAMETER_SETS_PER_TASK' that share those windows.
+    // The tasks land on the current worker's deque, so idle workers can steal parts of a large group.
+
+    void evaluateLookbackGroup(WorkStealingPool &pool, int symbolIndex, int groupIndex)
+    {
+        static const int PARAMETER_SETS_PER_TASK = 32;
+
+        const Data &data = *symbolData[symbolIndex];
+        int groupBegin = lookbackGroups[groupIndex].first;
+        int groupEnd = lookbackGroups[groupIndex].second;
+        int lookback = parameterSets[groupBegin][0];
+
+        // One buffer holds both windows: K-maximum in the first half, K-minimum in the second.
+        std::shared_ptr<float> windows(new float[2 * size_t(data.numberOfRows) + 1], std::default_delete<float[]>());
+        TrendFollowingStrategy::getKMaxMin(data, lookback, windows.get(), windows.get() + data.numberOfRows);
+
+        for (int setBegin = groupBegin; setBegin < groupEnd; setBegin += PARAMETER_SETS_PER_TASK)
+        {
+            int setEnd = std::min(groupEnd, setBegin + PARAMETER_SETS_PER_TASK);
+            int numberOfRows = data.numberOfRows;
+            pool.submit([this, symbolIndex, setBegin, setEnd, windows, numberOfRows]()
+                        { evaluateParameterSets(symbolIndex, setBegin, setEnd, windows.get(), windows.get() + numberOfRows); });
+        }
+    }
+
+    // Function 'run' loads every symbol once, evaluates all (symbol, parameter set) pairs on a work-stealing pool
+    // and ranks the results by total profit percentage (or by the statistic chosen with 'setRank').
+
+    void run()
+    {
+        buildParameterSets();
+        WorkStealingPool pool(NUM_OF_THREADS);
+
+        // Load each symbol exactly once; as soon as a symbol is loaded its lookback groups are queued.
+        symbolData.assign(symbolInputs.size(), std::shared_ptr<Data>());
+        results.assign(symbolInputs.size() * parameterSets.size(), SweepResult());
+
+        for (int i = 0; i < int(symbolInputs.size()); i++)
+        {
+            pool.submit([this, &pool, i]()
+                        {
+                            symbolData[i] = Resampler::load(symbolInputs[i].first, symbolInputs[i].second, timeframe);
+                            for (int g = 0; g < int(lookbackGroups.size()); g++)
+                                pool.submit([this, &pool, i, g]()
+                                            { evaluateLookbackGroup(pool, i, g); });
+                        });
+        }
+
+        pool.wait();
+        workerStats = pool.getStats();
+        rankResults();
+    }
+
+    // Function 'setResults' takes results evaluated elsewhere (one per (symbol, parameter set), symbol-major in
+    // 'getParameterSets' order, as 'run' produces them) and ranks them, so they can be written like a local run's.
+
+    void setResults(const std::vector<SweepResult> &results)
+    {
+        this->results = results;
+        rankResults();
+    }
+
+    // Function 'rankResults' sorts the results by total profit percentage (or by the statistic chosen with 'setRank').
+    // The sort is stable, so equal results keep their symbol-major, parameter set order.
+
+    void rankResults()
+    {
+        const MetricsRank rank = this->rank;
+        std::stable_sort(results.begin(), results.end(), [rank](const SweepResult &a, const SweepResult &b)
+                         {
+                             if (rank != RANK_PROFIT && MetricsEngine::getRankValue(a.metrics, rank) != MetricsEngine::getRankValue(b.metrics, rank))
+                                 return MetricsEngine::getRankValue(a.metrics, rank) > MetricsEngine::getRankValue(b.metrics, rank);
+                             if (a.result.totalProfitPercent != b.result.totalProfitPercent)
+                                 return a.result.totalProfitPercent > b.result.totalProfitPercent;
+                             return a.result.averageProfitPercent() > b.result.averageProfitPercent();
+                         });
+    }
+
+    const std::vector<WorkerStats> &getWorkerStats() const
+    {
+        return workerStats;
+    }
+
+    // Function 'writeResults' writes the ranked results table as CSV. When ranking by a metric, the risk metrics
+    // are appended as extra columns.
+
+    bool writeResults(const std::string &fileName) const
+    {
+        std::ofstream fout(fileName.c_str());
+        if (!fout)
+            return false;
+
+        fout << "rank,symbol";
+        for (int p = 0; p < NUM_OF_PARAMS; p++)
+            fout << "," << getParamName(p);
+        fout << ",total_trades,profitable_trades,total_profit_percent,average_profit_percent";
+        if (rank != RANK_PROFIT)
+            fout << ",cagr_percent,sharpe,sortino,max_drawdown_percent,max_drawdown_bars,calmar,profit_factor,exposure_percent,average_trade_bars";
+        fout << "\n";
+
+        for (size_t r = 0; r < results.size(); r++)
+        {
+            const SweepResult &sweepResult = results[r];
+            fout << r + 1 << "," << symbolInputs[sweepResult.symbolIndex].first;
+            for (int p = 0; p < NUM_OF_PARAMS; p++)
+                fout << "," << sweepResult.params[p];
+            fout << "," << sweepResult.result.totalTrades << "," << sweepResult.result.numOfProfitableTrades << ","
+                 << sweepResult.result.totalProfitPercent << "," << sweepResult.result.averageProfitPercent();
+            if (rank != RANK_PROFIT)
+            {
+                const PerformanceMetrics &metrics = sweepResult.metrics;
+                fout << "," << metrics.cagrPercent << "," << metrics.sharpe << "," << metrics.sortino << "," << metrics.maxDrawdownPercent << ","
+                     << metrics.maxDrawdownBars << "," << metrics.calmar() << "," << metrics.profitFactor << "," << metrics.exposurePercent << ","
+                     << metrics.averageTradeBars;
+            }
+            fout << "\n";
+        }
+
+        return bool(fout);
+    }
+
+    // Function 'printTopResults' prints the first 'count' rows of the ranked table to the standard output.
+
+    void printTopResults(int count) const
+    {
+        std::lock_guard<std::mutex> lock(stdOutMutex);
+        std::cout << "rank symbol lookback enter exit target stop trades profitable total% avg%"
+                  << (rank != RANK_PROFIT ? " cagr% sharpe sortino maxdd%" : "") << "\n";
+
+        for (int r = 0; r < count && r < int(results.size()); r++)
+        {
+            const SweepResult &sweepResult = results[r];
+            std::cout << r + 1 << " " << symbolInputs[sweepResult.symbolIndex].first;
+            for (int p = 0; p < NUM_OF_PARAMS; p++)
+                std::cout << " " << sweepResult.params[p];
+            std::cout << " " << sweepResult.result.totalTrades << " " << sweepResult.result.numOfProfitableTrades << " "
+                      << sweepResult.result.totalProfitPercent << " " << sweepResult.result.averageProfitPercent();
+            if (rank != RANK_PROFIT)
+                std::cout << " " << sweepResult.metrics.cagrPercent << " " << sweepResult.metrics.sharpe << " " << sweepResult.metrics.sortino
+                          << " " << sweepResult.metrics.maxDrawdownPercent;
+            std::cout << "\n";
+        }
+    }
+};
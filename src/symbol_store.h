@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <future>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "common.h"
+#include "data.h"
+#include "resample.h"
+
+// Define a C++ struct named 'SymbolStoreStats' to report how a SymbolStore has been used.
+struct SymbolStoreStats
+{
+    long long hits;           // Stores the requests served by a series already loaded.
+    long long misses;         // Stores the requests that loaded a series.
+    long long inFlightWaits;  // Stores the hits that waited for another thread's load of the same series.
+    long long evictions;      // Stores the series dropped to stay within the memory budget.
+    size_t bytesResident;     // Stores the column bytes of the series held now.
+    size_t peakBytesResident; // Stores the largest 'bytesResident' seen.
+    int entries;              // Stores the number of series held now (including loads in flight).
+
+    SymbolStoreStats()
+        : hits(0), misses(0), inFlightWaits(0), evictions(0), bytesResident(0), peakBytesResident(0), entries(0)
+    {
+    }
+};
+
+// Define a C++ class named 'SymbolStore' that is the process-wide, thread-safe cache of loaded symbol series.
+// Each (symbol, csv file, timeframe) is loaded once and handed out as an immutable shared_ptr<const Data>, so any
+// number of strategies, runs and threads share the same columns. A request for a series that another thread is
+// still loading waits on that load (a shared_future) instead of starting a second one. Loaded series are kept in
+// least-recently-used order and the oldest are dropped once their column bytes exceed the memory budget;
+// holders of a dropped series keep it alive until they release it, the store simply stops handing it out.
+class SymbolStore
+{
+    typedef std::shared_ptr<const Data> DataPtr;
+
+    // Define a struct named 'Entry' for one series: its (possibly pending) load and its place in the LRU list.
+    struct Entry
+    {
+        std::shared_future<DataPtr> data;        // Stores the load, ready or in flight.
+        size_t bytes;                            // Stores the column bytes once loaded (0 while in flight).
+        bool loaded;                             // Stores whether the load has finished.
+        std::list<std::string>::iterator recent; // Stores the entry's position in 'recentKeys'.
+    };
+
+    mutable std::mutex storeMutex;       // Guards every member below.
+    std::map<std::string, Entry> entries; // Stores the series by key.
+    std::list<std::string> recentKeys;    // Stores the keys, most recently used first.
+    size_t memoryBudget;                  // Stores the column bytes kept before evicting (0 means unlimited).
+    SymbolStoreStats stats;
+
+    SymbolStore(const SymbolStore &) = delete;
+    SymbolStore &operator=(const SymbolStore &) = delete;
+
+    // Member function to drop least-recently-used loaded series until the budget is met, sparing 'keep'.
+    // Must be called with 'storeMutex' held.
+    void evict(const std::string &keep)
+    {
+        std::list<std::string>::iterator key = recentKeys.end();
+        while (memoryBudget && stats.bytesResident > memoryBudget && key != recentKeys.begin())
+        {
+            --key;
+            std::map<std::string, Entry>::iterator entry = entries.find(*key);
+            if (*key == keep || !entry->second.loaded)
+                continue; // Loads in flight and the series just handed out are never evicted.
+
+            stats.bytesResident -= entry->second.bytes;
+            stats.evictions++;
+            entries.erase(entry);
+            key = recentKeys.erase(key);
+        }
+        stats.entries = int(entries.size());
+    }
+
+public:
+    explicit SymbolStore(size_t memoryBudget = 0)
+        : memoryBudget(memoryBudget)
+    {
+    }
+
+    // Static function to return the store shared by the whole process.
+    static SymbolStore &getInstance()
+    {
+        static SymbolStore instance;
+        return instance;
+    }
+
+    // Function 'setMemoryBudget' bounds the column bytes kept resident (0 means unlimited) and evicts down to it.
+    void setMemoryBudget(size_t memoryBudget)
+    {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        this->memoryBudget = memoryBudget;
+        evict("");
+    }
+
+    // Function 'get' returns the series of 'fileName' at 'timeframe', loading it on the calling thread when no
+    // other thread has. A failed load (an exception) is not cached, so the next request tries again.
+
+    DataPtr get(const std::string &symbolName, const std::string &fileName, const Timeframe &timeframe = Timeframe())
+    {
+        const std::string key = symbolName + '\n' + fileName + '\n' + timeframe.getName();
+        std::promise<DataPtr> load;
+        std::shared_future<DataPtr> existing;
+        {
+            std::lock_guard<std::mutex> lock(storeMutex);
+            std::map<std::string, Entry>::iterator found = entries.find(key);
+            if (found != entries.end())
+            {
+                stats.hits++;
+                if (!found->second.loaded)
+                    stats.inFlightWaits++;
+                recentKeys.splice(recentKeys.begin(), recentKeys, found->second.recent);
+                existing = found->second.data;
+            }
+            else
+            {
+                stats.misses++;
+                recentKeys.push_front(key);
+                Entry &entry = entries[key];
+                entry.data = load.get_future().share();
+                entry.bytes = 0;
+                entry.loaded = false;
+                entry.recent = recentKeys.begin();
+                stats.entries = int(entries.size());
+            }
+        }
+
+        // Wait outside the lock: the thread loading the series may need it to finish.
+        if (existing.valid())
+            return existing.get();
+
+        DataPtr data;
+        try
+        {
+            data = Resampler::load(symbolName, fileName, timeframe);
+        }
+        catch (...)
+        {
+            load.set_exception(std::current_exception());
+            std::lock_guard<std::mutex> lock(storeMutex);
+            std::map<std::string, Entry>::iterator entry = entries.find(key);
+            recentKeys.erase(entry->second.recent);
+            entries.erase(entry);
+            stats.entries = int(entries.size());
+            throw;
+        }
+        load.set_value(data);
+
+        std::lock_guard<std::mutex> lock(storeMutex);
+        Entry &entry = entries[key];
+        entry.bytes = data->getColumnBytes();
+        entry.loaded = true;
+        stats.bytesResident += entry.bytes;
+        stats.peakBytesResident = std::max(stats.peakBytesResident, stats.bytesResident);
+        evict(key);
+        return data;
+    }
+
+    // Function 'clear' drops every loaded series (loads in flight finish and are kept).
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        for (std::list<std::string>::iterator key = recentKeys.begin(); key != recentKeys.end();)
+        {
+            std::map<std::string, Entry>::iterator entry = entries.find(*key);
+            if (!entry->second.loaded)
+            {
+                ++key;
+                continue;
+            }
+            stats.bytesResident -= entry->second.bytes;
+            entries.erase(entry);
+            key = recentKeys.erase(key);
+        }
+        stats.entries = int(entries.size());
+    }
+
+    SymbolStoreStats getStats() const
+    {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        return stats;
+    }
+
+    // Function 'printStats' prints the hit/miss counters and the resident bytes to the standard output.
+
+    void printStats() const
+    {
+        SymbolStoreStats current = getStats();
+        std::lock_guard<std::mutex> lock(stdOutMutex);
+        std::cout << "\nSymbol store: " << current.hits << " hits (" << current.inFlightWaits << " waited on a load in flight), "
+                  << current.misses << " misses, " << current.evictions << " evictions, " << current.entries << " series, "
+                  << current.bytesResident / 1048576.0 << " MB resident (peak " << current.peakBytesResident / 1048576.0 << " MB)\n";
+    }
+};
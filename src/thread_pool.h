@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "instrumentation.h"
+
+// Define a C++ struct named 'WorkerStats' to report how one pool worker spent its time.
+struct WorkerStats
+{
+    long long tasksExecuted; // Stores the number of tasks the worker ran.
+    long long tasksStolen;   // Stores how many of those tasks were taken from another worker's deque.
+    double busySeconds;      // Stores the time spent inside tasks.
+    double utilization;      // Stores busySeconds divided by the pool's wall time.
+};
+
+// Define a C++ class named 'WorkStealingPool' that runs tasks on a fixed set of worker threads.
+// Every worker owns a deque: tasks submitted from inside a task go to the submitting worker's deque and are
+// taken back LIFO (cache-warm), while idle workers steal FIFO from the other end of someone else's deque.
+// Workers with nothing to do sleep on a condition variable; no queue is ever read without its lock.
+class WorkStealingPool
+{
+    struct Worker
+    {
+        std::mutex dequeMutex;                   // Guards 'tasks'.
+        std::deque<std::function<void()>> tasks; // Stores the worker's pending tasks.
+        long long tasksExecuted;
+        long long tasksStolen;
+        long long busyNanoseconds;
+
+        Worker()
+            : tasksExecuted(0), tasksStolen(0), busyNanoseconds(0)
+        {
+        }
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex idleMutex;                    // Guards sleeping and waking of idle workers.
+    std::condition_variable idleCondition;   // Signalled when a task is queued or the pool stops.
+    std::atomic<long long> queuedTasks;      // Stores the number of tasks sitting in some deque.
+    bool stopping;                           // Set (under idleMutex) when the pool shuts down.
+
+    std::mutex doneMutex;                    // Guards waiting for completion.
+    std::condition_variable doneCondition;   // Signalled when 'pendingTasks' drops to zero.
+    std::atomic<long long> pendingTasks;     // Stores the number of submitted tasks that have not finished.
+    std::atomic<unsigned> nextWorker;        // Round-robin target for tasks submitted from outside the pool.
+
+    std::chrono::steady_clock::time_point startTime;
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // Static function returning the calling thread's worker slot: (pool, index) or (nullptr, -1) outside a pool.
+    static std::pair<const WorkStealingPool *, int> &currentWorker()
+    {
+        static thread_local std::pair<const WorkStealingPool *, int> slot(nullptr, -1);
+        return slot;
+    }
+
+    // Member function to take a task: own deque first (newest), then steal from the others (oldest).
+    bool takeTask(int self, std::function<void()> &task)
+    {
+        {
+            ContendedLockGuard lock(workers[self]->dequeMutex);
+            if (!workers[self]->tasks.empty())
+            {
+                task = std::move(workers[self]->tasks.back());
+                workers[self]->tasks.pop_back();
+                queuedTasks--;
+                return true;
+            }
+        }
+
+        int numOfWorkers = int(workers.size());
+        for (int offset = 1; offset < numOfWorkers; offset++)
+        {
+            Worker &victim = *workers[(self + offset) % numOfWorkers];
+            ContendedLockGuard lock(victim.dequeMutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queuedTasks--;
+                workers[self]->tasksStolen++;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Member function that is the body of every worker thread.
+    void runWorker(int self)
+    {
+        currentWorker() = std::make_pair(this, self);
+        std::function<void()> task;
+
+        while (true)
+        {
+            if (takeTask(self, task))
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                task();
+                task = nullptr;
+                workers[self]->busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                workers[self]->tasksExecuted++;
+
+                if (--pendingTasks == 0)
+                {
+                    std::lock_guard<std::mutex> lock(doneMutex);
+                    doneCondition.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idleCondition.wait(lock, [this]()
+                               { return stopping || queuedTasks > 0; });
+            if (stopping && queuedTasks <= 0)
+                return;
+        }
+    }
+
+public:
+    // Constructor that starts 'numOfThreads' workers (0 means one per hardware thread).
+    explicit WorkStealingPool(int numOfThreads = 0)
+        : queuedTasks(0), stopping(false), pendingTasks(0), nextWorker(0), startTime(std::chrono::steady_clock::now())
+    {
+        if (numOfThreads <= 0)
+            numOfThreads = std::max(1u, std::thread::hardware_concurrency());
+
+        for (int i = 0; i < numOfThreads; i++)
+            workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        for (int i = 0; i < numOfThreads; i++)
+            threads.push_back(std::thread(&WorkStealingPool::runWorker, this, i));
+    }
+
+    int getNumOfThreads() const
+    {
+        return int(workers.size());
+    }
+
+    // Member function to queue a task. Called from one of this pool's workers the task lands on that worker's
+    // deque; otherwise the workers are filled round robin.
+    void submit(std::function<void()> task)
+    {
+        std::pair<const WorkStealingPool *, int> caller = currentWorker();
+        int target = caller.first == this ? caller.second : int(nextWorker++ % workers.size());
+
+        pendingTasks++;
+        {
+            ContendedLockGuard lock(workers[target]->dequeMutex);
+            workers[target]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            queuedTasks++;
+        }
+        idleCondition.notify_one();
+    }
+
+    // Member function to block until every submitted task (including tasks submitted by tasks) has finished.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [this]()
+                           { return pendingTasks == 0; });
+    }
+
+    // Member function to return per-worker statistics. Call it after 'wait' for consistent numbers.
+    std::vector<WorkerStats> getStats() const
+    {
+        double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::vector<WorkerStats> stats;
+
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            WorkerStats workerStats;
+            workerStats.tasksExecuted = workers[i]->tasksExecuted;
+            workerStats.tasksStolen = workers[i]->tasksStolen;
+            workerStats.busySeconds = workers[i]->busyNanoseconds * 1e-9;
+            workerStats.utilization = wallSeconds > 0 ? workerStats.busySeconds / wallSeconds : 0;
+            stats.push_back(workerStats);
+        }
+
+        return stats;
+    }
+
+    // Static function to print one utilization line per worker.
+    static void printStats(const std::vector<WorkerStats> &stats)
+    {
+        std::lock_guard<std::mutex> lock(stdOutMutex);
+
+        for (size_t i = 0; i < stats.size(); i++)
+        {
+            printf("worker %2zu: %8lld tasks (%6lld stolen), busy %9.3f s, utilization %5.1f%%\n", i,
+                   stats[i].tasksExecuted, stats[i].tasksStolen, stats[i].busySeconds, stats[i].utilization * 100);
+        }
+        fflush(stdout);
+    }
+
+    ~WorkStealingPool()
+    {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            stopping = true;
+        }
+        idleCondition.notify_all();
+
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "csv_parser.h"
+
+// Define a C++ struct named 'SymbolLoadReport' to record what loading one symbol produced.
+struct SymbolLoadReport
+{
+    std::string symbolName; // Stores the symbol name.
+    std::string fileName;   // Stores the csv file it was loaded from.
+    int rows;               // Stores the number of rows loaded.
+    int skippedRows;        // Stores the number of malformed rows skipped.
+
+    SymbolLoadReport()
+        : rows(0), skippedRows(0)
+    {
+    }
+};
+
+// Define a C++ class named 'SymbolUniverse' that discovers the (symbol name, csv file) pairs of a universe.
+// A universe is given as a directory (every *.csv in it), a glob pattern ("data/*.csv"), a single csv file,
+// or a manifest file listing one "SYMBOL,path", "SYMBOL=path" or "path" per line ('#' starts a comment; relative
+// paths are relative to the manifest). Without an explicit name a symbol is named after its file ("data/NFLX.csv"
+// is NFLX). Every file is validated before the run, so a missing, empty or unreadable file is reported up front
+// instead of failing a worker halfway through.
+class SymbolUniverse
+{
+    // Static function to return whether 'path' is a directory.
+    static bool isDirectory(const std::string &path)
+    {
+        struct stat status;
+        return stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+    }
+
+    // Static function to join a directory and a relative path ("" or an absolute path are returned as is).
+    static std::string joinPath(const std::string &directory, const std::string &path)
+    {
+        if (directory.empty() || path.empty() || path[0] == '/')
+            return path;
+        return directory[directory.size() - 1] == '/' ? directory + path : directory + "/" + path;
+    }
+
+    // Static function to trim spaces, tabs and carriage returns from both ends of 'text'.
+    static std::string trim(const std::string &text)
+    {
+        size_t begin = text.find_first_not_of(" \t\r");
+        size_t end = text.find_last_not_of(" \t\r");
+        return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+    }
+
+    // Static function to append every *.csv file of 'directory' to 'files', in name order.
+    static void listDirectory(const std::string &directory, std::vector<std::string> &files)
+    {
+        DIR *handle = opendir(directory.c_str());
+        if (!handle)
+            return;
+
+        std::vector<std::string> names;
+        while (struct dirent *entry = readdir(handle))
+        {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".csv") == 0)
+                names.push_back(name);
+        }
+        closedir(handle);
+
+        std::sort(names.begin(), names.end());
+        for (size_t i = 0; i < names.size(); i++)
+            files.push_back(joinPath(directory, names[i]));
+    }
+
+    // Static function to append the files matching the glob 'pattern' to 'files', in name order.
+    static void expandGlob(const std::string &pattern, std::vector<std::string> &files)
+    {
+        glob_t matches;
+        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+        {
+            for (size_t i = 0; i < matches.gl_pathc; i++)
+                files.push_back(matches.gl_pathv[i]);
+        }
+        globfree(&matches);
+    }
+
+    // Static function to read the (symbol name, csv file) pairs of a manifest. Returns false when it cannot be read.
+    static bool readManifest(const std::string &fileName, std::vector<std::pair<std::string, std::string>> &symbolInputs,
+                             std::vector<std::string> &problems)
+    {
+        std::ifstream manifest(fileName.c_str());
+        if (!manifest)
+            return false;
+
+        std::string directory = fileName.rfind('/') == std::string::npos ? std::string() : fileName.substr(0, fileName.rfind('/') + 1);
+        std::string line;
+        for (int lineNumber = 1; std::getline(manifest, line); lineNumber++)
+        {
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty())
+                continue;
+
+            size_t separator = line.find_first_of(",=");
+            std::string symbolName = separator == std::string::npos ? std::string() : trim(line.substr(0, separator));
+            std::string path = trim(separator == std::string::npos ? line : line.substr(separator + 1));
+            if (path.empty())
+            {
+                problems.push_back(fileName + ":" + std::to_string(lineNumber) + ": no csv file given");
+                continue;
+            }
+            path = joinPath(directory, path);
+            symbolInputs.push_back(std::make_pair(symbolName.empty() ? getSymbolName(path) : symbolName, path));
+        }
+        return true;
+    }
+
+public:
+    // Static function to return the symbol name of a csv file: its file name without directory and extension.
+    static std::string getSymbolName(const std::string &fileName)
+    {
+        size_t begin = fileName.rfind('/') == std::string::npos ? 0 : fileName.rfind('/') + 1;
+        size_t end = fileName.rfind('.');
+        return fileName.substr(begin, end == std::string::npos || end < begin ? std::string::npos : end - begin);
+    }
+
+    // Function 'validate' checks that 'fileName' is a readable, non-empty regular file whose first lines
+    // contain at least one row CsvParser accepts. On failure it sets 'problem' and returns false.
+    // Only the head of the file is read; malformed rows further down are skipped and counted by the loader.
+
+    static bool validate(const std::string &fileName, std::string &problem)
+    {
+        static const size_t HEAD_BYTES = 1 << 16;
+
+        struct stat status;
+        if (stat(fileName.c_str(), &status) != 0)
+        {
+            problem = "not found";
+            return false;
+        }
+        if (!S_ISREG(status.st_mode))
+        {
+            problem = "not a regular file";
+            return false;
+        }
+        if (status.st_size == 0)
+        {
+            problem = "empty";
+            return false;
+        }
+
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            problem = "cannot be opened";
+            return false;
+        }
+        std::vector<char> head(HEAD_BYTES);
+        ssize_t bytes = read(fd, head.data(), head.size());
+        close(fd);
+        if (bytes <= 0)
+        {
+            problem = "cannot be read";
+            return false;
+        }
+
+        const char *cursor = head.data();
+        const char *end = cursor + bytes;
+        while (cursor < end)
+        {
+            const char *lineEnd = CsvParser::nextLine(cursor, end);
+            if (lineEnd == end && bytes == ssize_t(head.size()))
+                break; // The last line was cut off by the head buffer.
+            const char *contentEnd = lineEnd[-1] == '\n' ? lineEnd - 1 : lineEnd;
+
+            CsvRow row;
+            if (CsvParser::parseRow(cursor, contentEnd, row))
+                return true;
+            cursor = lineEnd;
+        }
+
+        problem = "no Date,Open,High,Low,Close,Adj Close,Volume row in its first " + std::to_string(HEAD_BYTES >> 10) + " KB";
+        return false;
+    }
+
+    // Function 'discover' returns the validated (symbol name, csv file) pairs of the universe 'spec' (a directory,
+    // glob pattern, csv file or manifest, see above). Files that fail validation and symbol names listed twice are
+    // left out and described in 'problems'.
+
+    static std::vector<std::pair<std::string, std::string>> discover(const std::string &spec, std::vector<std::string> &problems)
+    {
+        std::vector<std::pair<std::string, std::string>> candidates;
+        std::vector<std::string> files;
+
+        if (spec.find_first_of("*?[") != std::string::npos)
+            expandGlob(spec, files);
+        else if (isDirectory(spec))
+            listDirectory(spec, files);
+        else if (spec.size() > 4 && spec.compare(spec.size() - 4, 4, ".csv") == 0)
+            files.push_back(spec);
+        else if (!readManifest(spec, candidates, problems))
+            problems.push_back(spec + ": not a directory, glob pattern, csv file or readable manifest");
+
+        for (size_t i = 0; i < files.size(); i++)
+            candidates.push_back(std::make_pair(getSymbolName(files[i]), files[i]));
+
+        std::vector<std::pair<std::string, std::string>> symbolInputs;
+        std::set<std::string> symbolNames;
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            std::string problem;
+            if (!symbolNames.insert(candidates[i].first).second)
+                problems.push_back(candidates[i].second + ": symbol " + candidates[i].first + " is already listed");
+            else if (!validate(candidates[i].second, problem))
+                problems.push_back(candidates[i].second + ": " + problem);
+            else
+                symbolInputs.push_back(candidates[i]);
+        }
+
+        if (symbolInputs.empty() && problems.empty())
+            problems.push_back(spec + ": no csv files found");
+        return symbolInputs;
+    }
+
+    // Function 'printReport' prints the rows and malformed rows loaded per universe, listing the symbols that
+    // had malformed rows skipped or loaded no rows at all.
+
+    static void printReport(const std::vector<SymbolLoadReport> &reports)
+    {
+        long long rows = 0, skippedRows = 0;
+        for (size_t i = 0; i < reports.size(); i++)
+        {
+            rows += reports[i].rows;
+            skippedRows += reports[i].skippedRows;
+        }
+
+        std::lock_guard<std::mutex> lock(stdOutMutex);
+        std::cout << "\nLoaded " << reports.size() << " symbols: " << rows << " rows, " << skippedRows << " malformed rows skipped\n";
+        for (size_t i = 0; i < reports.size(); i++)
+        {
+            if (reports[i].skippedRows || reports[i].rows == 0)
+                std::cout << "  " << reports[i].symbolName << " (" << reports[i].fileName << "): " << reports[i].rows << " rows, "
+                          << reports[i].skippedRows << " malformed rows skipped\n";
+        }
+    }
+};
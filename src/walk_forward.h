@@ -0,0 +1,415 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "backtest.h"
+#include "batch_signals.h"
+#include "data.h"
+#include "resample.h"
+#include "strategy.h"
+#include "sweep.h"
+#include "thread_pool.h"
+
+// Define a C++ struct named 'WalkForwardSettings' that describes how a series is split into train/test windows.
+struct WalkForwardSettings
+{
+    int trainBars; // Stores the length of each train window (walk-forward).
+    int testBars;  // Stores the length of each test window (walk-forward).
+    int stepBars;  // Stores how far consecutive windows move (0 means testBars, i.e. back-to-back test windows).
+    bool anchored; // Stores whether train windows all start at the first bar (expanding) instead of rolling.
+    int folds;     // Stores the number of k-fold cross-validation folds (0 selects walk-forward).
+
+    WalkForwardSettings()
+        : trainBars(1000), testBars(250), stepBars(0), anchored(false), folds(0)
+    {
+    }
+};
+
+// Define a C++ struct named 'WalkForwardSplit' holding the bar ranges [first, second) of one split.
+// Walk-forward splits have one train range; a k-fold split trains on the (up to two) ranges around its test fold.
+struct WalkForwardSplit
+{
+    std::vector<std::pair<int, int>> trainRanges;
+    std::pair<int, int> testRange;
+};
+
+// Define a C++ struct named 'WalkForwardResult' to store the outcome of one (symbol, split).
+struct WalkForwardResult
+{
+    int symbolIndex;
+    int splitIndex;
+    WalkForwardSplit split;
+    int params[ParameterSweep::NUM_OF_PARAMS]; // Stores the parameter set chosen on the train ranges.
+    BacktestResult train;                      // Stores the in-sample result of that parameter set.
+    BacktestResult test;                       // Stores its out-of-sample result on the test range.
+};
+
+// Define a C++ class named 'WalkForward' that optimizes TrendFollowingStrategy on train windows and evaluates the
+// winner on the following (or held-out) test window, for walk-forward analysis and k-fold cross-validation.
+// Windows are Data slices that reference the loaded columns (Data::getSlice), and the K-maximum/K-minimum arrays are
+// computed once per (symbol, LOOKBACK_PERIOD) over the whole series and shared by every window: a window starting
+// at bar b simply reads them from offset b. Indicators at the start of a window therefore look back into earlier
+// bars, while the trade state starts flat in every window. A k-fold train range that follows its test fold would
+// look back into the fold, so it starts LOOKBACK_PERIOD - 1 bars later (getTrainRanges) and no train window ever
+// reads a test bar.
+// Train evaluations run as (symbol, lookback group, split) tasks on a WorkStealingPool, each evaluating its
+// parameter sets 8 at a time with BatchSignals; test evaluations run as one task per symbol.
+class WalkForward
+{
+    typedef BatchSignals<8> BatchLanes;
+
+    ParameterSweep grid; // Stores the parameter ranges and builds the parameter sets.
+    WalkForwardSettings settings;
+    int NUM_OF_THREADS;
+    Timeframe timeframe; // Stores the bar size the csv files are resampled to.
+    std::vector<std::pair<std::string, std::string>> symbolInputs;
+
+    std::vector<std::shared_ptr<Data>> symbolData;
+    std::vector<std::vector<int>> parameterSets;
+    std::vector<std::pair<int, int>> lookbackGroups;              // Stores [begin, end) ranges of equal lookback.
+    std::vector<std::vector<WalkForwardSplit>> symbolSplits;      // Stores the splits of each symbol.
+    std::vector<std::vector<std::vector<BacktestResult>>> trainResults; // Stores [symbol][split][parameter set].
+    std::vector<std::vector<WalkForwardResult>> results;          // Stores [symbol][split].
+    std::vector<WorkerStats> workerStats;
+
+    // Static function to rank two results the way ParameterSweep does (total profit, then average profit).
+    static bool isBetter(const BacktestResult &a, const BacktestResult &b)
+    {
+        if (a.totalProfitPercent != b.totalProfitPercent)
+            return a.totalProfitPercent > b.totalProfitPercent;
+        return a.averageProfitPercent() > b.averageProfitPercent();
+    }
+
+    static void addResult(BacktestResult &total, const BacktestResult &result)
+    {
+        total.totalTrades += result.totalTrades;
+        total.numOfProfitableTrades += result.numOfProfitableTrades;
+        total.totalProfitPercent += result.totalProfitPercent;
+    }
+
+    // Function 'evaluateOnRanges' backtests 'count' threshold sets on each range and sums the results.
+
+    static void evaluateOnRanges(const Data &data, const float *kmax, const float *kmin, const std::vector<std::pair<int, int>> &ranges,
+                                 const ThresholdSet *sets, int count, BacktestResult *totals)
+    {
+        BacktestResult rangeResults[BatchLanes::NUM_OF_LANES];
+        for (int lane = 0; lane < count; lane++)
+            totals[lane] = BacktestResult();
+
+        for (size_t r = 0; r < ranges.size(); r++)
+        {
+            int begin = ranges[r].first, rows = ranges[r].second - ranges[r].first;
+            if (rows <= 0)
+                continue;
+
+            Data slice = data.getSlice(begin, rows);
+            BatchLanes::evaluate(slice, kmax + begin, kmin + begin, sets, count, rangeResults);
+            for (int lane = 0; lane < count; lane++)
+                addResult(totals[lane], rangeResults[lane]);
+        }
+    }
+
+    // Static function to return the train ranges of 'split' for windows of 'lookBackPeriod' bars. A range starting
+    // right after the test fold (k-fold) drops its first lookBackPeriod - 1 bars, whose windows span test bars.
+
+    static std::vector<std::pair<int, int>> getTrainRanges(const WalkForwardSplit &split, int lookBackPeriod)
+    {
+        std::vector<std::pair<int, int>> ranges = split.trainRanges;
+        for (size_t r = 0; r < ranges.size(); r++)
+        {
+            if (split.testRange.second > split.testRange.first && ranges[r].first == split.testRange.second)
+                ranges[r].first = std::min(ranges[r].second, ranges[r].first + std::max(0, lookBackPeriod - 1));
+        }
+        return ranges;
+    }
+
+    // Function 'trainLookbackGroup' evaluates every parameter set of one lookback group on the train ranges of
+    // every split of one symbol, using one K-maximum/K-minimum computation for all of them.
+
+    void trainLookbackGroup(WorkStealingPool &pool, int symbolIndex, int groupIndex)
+    {
+        const Data &data = *symbolData[symbolIndex];
+        int groupBegin = lookbackGroups[groupIndex].first, groupEnd = lookbackGroups[groupIndex].second;
+
+        std::shared_ptr<float> windows(new float[2 * size_t(data.numberOfRows) + 1], std::default_delete<float[]>());
+        TrendFollowingStrategy::getKMaxMin(data, parameterSets[groupBegin][0], windows.get(), windows.get() + data.numberOfRows);
+
+        for (int s = 0; s < int(symbolSplits[symbolIndex].size()); s++)
+        {
+            pool.submit([this, symbolIndex, groupBegin, groupEnd, s, windows]()
+                        {
+                            const Data &data = *symbolData[symbolIndex];
+                            const float *kmax = windows.get(), *kmin = windows.get() + data.numberOfRows;
+                            ThresholdSet sets[BatchLanes::NUM_OF_LANES];
+                            std::vector<std::pair<int, int>> trainRanges = getTrainRanges(symbolSplits[symbolIndex][s], parameterSets[groupBegin][0]);
+
+                            for (int batchBegin = groupBegin; batchBegin < groupEnd; batchBegin += BatchLanes::NUM_OF_LANES)
+                            {
+                                int count = std::min(groupEnd - batchBegin, int(BatchLanes::NUM_OF_LANES));
+                                for (int lane = 0; lane < count; lane++)
+                                    sets[lane] = getThresholds(parameterSets[batchBegin + lane]);
+
+                                evaluateOnRanges(data, kmax, kmin, trainRanges, sets, count, &trainResults[symbolIndex][s][batchBegin]);
+                            }
+                        });
+        }
+    }
+
+    // Function 'testSymbol' picks the best train parameter set of every split of one symbol and evaluates it on the
+    // split's test range. The windows of each chosen lookback are computed once for all splits that chose it.
+
+    void testSymbol(int symbolIndex)
+    {
+        const Data &data = *symbolData[symbolIndex];
+        std::vector<WalkForwardSplit> &splits = symbolSplits[symbolIndex];
+        std::vector<int> chosen(splits.size(), 0);
+        results[symbolIndex].assign(splits.size(), WalkForwardResult());
+
+        for (size_t s = 0; s < splits.size(); s++)
+        {
+            const std::vector<BacktestResult> &candidates = trainResults[symbolIndex][s];
+            for (size_t p = 1; p < candidates.size(); p++)
+            {
+                if (isBetter(candidates[p], candidates[chosen[s]]))
+                    chosen[s] = int(p);
+            }
+        }
+
+        std::vector<float> kmax(size_t(data.numberOfRows) + 1), kmin(size_t(data.numberOfRows) + 1);
+        for (size_t g = 0; g < lookbackGroups.size(); g++)
+        {
+            bool windowsReady = false;
+            for (size_t s = 0; s < splits.size(); s++)
+            {
+                if (chosen[s] < lookbackGroups[g].first || chosen[s] >= lookbackGroups[g].second)
+                    continue;
+
+                if (!windowsReady)
+                {
+                    TrendFollowingStrategy::getKMaxMin(data, parameterSets[chosen[s]][0], kmax.data(), kmin.data());
+                    windowsReady = true;
+                }
+
+                WalkForwardResult &result = results[symbolIndex][s];
+                result.symbolIndex = symbolIndex;
+                result.splitIndex = int(s);
+                result.split = splits[s];
+                std::copy(parameterSets[chosen[s]].begin(), parameterSets[chosen[s]].end(), result.params);
+                result.train = trainResults[symbolIndex][s][chosen[s]];
+
+                ThresholdSet set = getThresholds(parameterSets[chosen[s]]);
+                std::vector<std::pair<int, int>> testRanges(1, splits[s].testRange);
+                evaluateOnRanges(data, kmax.data(), kmin.data(), testRanges, &set, 1, &result.test);
+            }
+        }
+    }
+
+    static ThresholdSet getThresholds(const std::vector<int> &params)
+    {
+        ThresholdSet set = {params[1], params[2], params[3], params[4]};
+        return set;
+    }
+
+public:
+    WalkForward()
+        : NUM_OF_THREADS(0)
+    {
+    }
+
+    void setNumOfThreads(int numOfThreads)
+    {
+        NUM_OF_THREADS = numOfThreads;
+    }
+
+    void setSymbolInputs(const std::vector<std::pair<std::string, std::string>> &symbolInputs)
+    {
+        this->symbolInputs = symbolInputs;
+    }
+
+    // Function 'setTimeframe' resamples every loaded csv file to 'timeframe' (native keeps the file's bars).
+    void setTimeframe(const Timeframe &timeframe)
+    {
+        this->timeframe = timeframe;
+    }
+
+    void setSettings(const WalkForwardSettings &settings)
+    {
+        this->settings = settings;
+    }
+
+    // Function 'getGrid' gives access to the parameter ranges (see ParameterSweep::setRange).
+    ParameterSweep &getGrid()
+    {
+        return grid;
+    }
+
+    // Static function 'buildSplits' cuts 'numberOfRows' bars into train/test splits.
+    // Walk-forward: train [start, start + trainBars) then test the next testBars, moving by stepBars (anchored
+    // windows keep start at 0 and grow). K-fold: 'folds' contiguous test folds, each trained on all other bars (see getTrainRanges).
+
+    static std::vector<WalkForwardSplit> buildSplits(int numberOfRows, const WalkForwardSettings &settings)
+    {
+        std::vector<WalkForwardSplit> splits;
+
+        if (settings.folds > 1)
+        {
+            for (int f = 0; f < settings.folds && numberOfRows >= settings.folds; f++)
+            {
+                int foldBegin = int((long long)numberOfRows * f / settings.folds);
+                int foldEnd = int((long long)numberOfRows * (f + 1) / settings.folds);
+
+                WalkForwardSplit split;
+                if (foldBegin > 0)
+                    split.trainRanges.push_back(std::make_pair(0, foldBegin));
+                if (foldEnd < numberOfRows)
+                    split.trainRanges.push_back(std::make_pair(foldEnd, numberOfRows));
+                split.testRange = std::make_pair(foldBegin, foldEnd);
+                splits.push_back(split);
+            }
+            return splits;
+        }
+
+        if (settings.trainBars <= 0 || settings.testBars <= 0)
+            return splits;
+
+        int step = settings.stepBars > 0 ? settings.stepBars : settings.testBars;
+        for (int trainEnd = settings.trainBars; trainEnd + settings.testBars <= numberOfRows; trainEnd += step)
+        {
+            WalkForwardSplit split;
+            split.trainRanges.push_back(std::make_pair(settings.anchored ? 0 : trainEnd - settings.trainBars, trainEnd));
+            split.testRange = std::make_pair(trainEnd, trainEnd + settings.testBars);
+            splits.push_back(split);
+        }
+        return splits;
+    }
+
+    // Function 'run' loads every symbol once, trains every parameter set on every split in parallel, then picks the
+    // best set per split and evaluates it out of sample.
+
+    void run()
+    {
+        grid.buildParameterSets();
+        parameterSets = grid.getParameterSets();
+        lookbackGroups.clear();
+        for (int p = 0; p < int(parameterSets.size()); p++)
+        {
+            if (lookbackGroups.empty() || parameterSets[lookbackGroups.back().first][0] != parameterSets[p][0])
+                lookbackGroups.push_back(std::make_pair(p, p));
+            lookbackGroups.back().second = p + 1;
+        }
+
+        symbolData.assign(symbolInputs.size(), std::shared_ptr<Data>());
+        symbolSplits.assign(symbolInputs.size(), std::vector<WalkForwardSplit>());
+        trainResults.assign(symbolInputs.size(), std::vector<std::vector<BacktestResult>>());
+        results.assign(symbolInputs.size(), std::vector<WalkForwardResult>());
+
+        WorkStealingPool pool(NUM_OF_THREADS);
+        for (int i = 0; i < int(symbolInputs.size()); i++)
+        {
+            pool.submit([this, &pool, i]()
+                        {
+                            symbolData[i] = Resampler::load(symbolInputs[i].first, symbolInputs[i].second, timeframe);
+                            symbolSplits[i] = buildSplits(symbolData[i]->numberOfRows, settings);
+                            trainResults[i].assign(symbolSplits[i].size(), std::vector<BacktestResult>(parameterSets.size()));
+
+                            for (int g = 0; g < int(lookbackGroups.size()); g++)
+                                pool.submit([this, &pool, i, g]()
+                                            { trainLookbackGroup(pool, i, g); });
+                        });
+        }
+        pool.wait();
+
+        for (int i = 0; i < int(symbolInputs.size()); i++)
+        {
+            pool.submit([this, i]()
+                        { testSymbol(i); });
+        }
+        pool.wait();
+        workerStats = pool.getStats();
+    }
+
+    // Function 'getStitchedResult' returns the out-of-sample results of every split of a symbol added together.
+
+    BacktestResult getStitchedResult(int symbolIndex) const
+    {
+        BacktestResult total;
+        for (size_t s = 0; s < results[symbolIndex].size(); s++)
+            addResult(total, results[symbolIndex][s].test);
+        return total;
+    }
+
+    // Function 'getInSampleResult' returns the train results of the chosen parameter sets added together
+    // (compare with getStitchedResult to see how much of the in-sample edge survives).
+
+    BacktestResult getInSampleResult(int symbolIndex) const
+    {
+        BacktestResult total;
+        for (size_t s = 0; s < results[symbolIndex].size(); s++)
+            addResult(total, results[symbolIndex][s].train);
+        return total;
+    }
+
+    const std::vector<std::vector<WalkForwardResult>> &getResults() const
+    {
+        return results;
+    }
+
+    const std::vector<std::pair<std::string, std::string>> &getSymbolInputs() const
+    {
+        return symbolInputs;
+    }
+
+    const std::vector<WorkerStats> &getWorkerStats() const
+    {
+        return workerStats;
+    }
+
+    size_t getNumOfParameterSets() const
+    {
+        return parameterSets.size();
+    }
+
+    // Function 'writeResults' writes one CSV row per (symbol, split) with the chosen parameters and both results.
+
+    bool writeResults(const std::string &fileName) const
+    {
+        std::ofstream fout(fileName.c_str());
+        if (!fout)
+            return false;
+
+        fout << "symbol,split,train_ranges,test_begin,test_end";
+        for (int p = 0; p < ParameterSweep::NUM_OF_PARAMS; p++)
+            fout << "," << ParameterSweep::getParamName(p);
+        fout << ",train_trades,train_total_profit_percent,test_trades,test_profitable_trades,test_total_profit_percent,test_average_profit_percent\n";
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Data &data = *symbolData[i];
+            for (size_t s = 0; s < results[i].size(); s++)
+            {
+                const WalkForwardResult &result = results[i][s];
+                fout << symbolInputs[i].first << "," << s << ",";
+                for (size_t r = 0; r < result.split.trainRanges.size(); r++)
+                {
+                    fout << (r ? ";" : "") << CsvParser::formatDate(data.dates()[result.split.trainRanges[r].first]) << ">"
+                         << CsvParser::formatDate(data.dates()[result.split.trainRanges[r].second - 1]);
+                }
+                fout << "," << CsvParser::formatDate(data.dates()[result.split.testRange.first]) << ","
+                     << CsvParser::formatDate(data.dates()[result.split.testRange.second - 1]);
+                for (int p = 0; p < ParameterSweep::NUM_OF_PARAMS; p++)
+                    fout << "," << result.params[p];
+                fout << "," << result.train.totalTrades << "," << result.train.totalProfitPercent << "," << result.test.totalTrades
+                     << "," << result.test.numOfProfitableTrades << "," << result.test.totalProfitPercent << ","
+                     << result.test.averageProfitPercent() << "\n";
+            }
+        }
+
+        return bool(fout);
+    }
+};